@@ -0,0 +1,121 @@
+/**
+ * Compares inter-process fifo implementations:
+ *   - process::fifo, guarded by named mutexes and semaphores
+ *   - process::lockfree_fifo, lock-free with in-segment futex wakeups (Linux only)
+ *
+ * Each producer/consumer connects to the fifo through its own handle, exactly as separate processes would.
+ *
+ * Scenarios:
+ *   uncontended: a single thread pushes then pops, so nothing ever blocks
+ *   ping-pong:   two threads hand an item back and forth through two fifos
+ *   streaming:   producers push into a small fifo while consumers pop
+ */
+#include <cpen333/process/fifo.h>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const size_t UNCONTENDED_OPS = 1000000;
+static const size_t PINGPONG_OPS = 100000;
+static const size_t STREAMING_OPS = 1000000;
+static const size_t STREAMING_SIZE = 64;
+
+template<typename Func>
+double time_ns(Func func) {
+  auto start = std::chrono::steady_clock::now();
+  func();
+  auto end = std::chrono::steady_clock::now();
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end-start).count();
+}
+
+void report(const std::string& fifo, const std::string& scenario, double ns, size_t ops) {
+  std::cout << std::left << std::setw(16) << fifo << std::setw(24) << scenario
+            << std::right << std::setw(10) << std::fixed << std::setprecision(1) << ns/ops << " ns/op" << std::endl;
+}
+
+template<typename Fifo>
+void uncontended(const std::string& name) {
+  Fifo fifo("benchmark_fifo_uncontended", 1024);
+  double ns = time_ns([&](){
+    for (size_t i=0; i<UNCONTENDED_OPS; ++i) {
+      fifo.push(i);
+      fifo.pop();
+    }
+  });
+  fifo.unlink();
+  report(name, "uncontended", ns, UNCONTENDED_OPS);
+}
+
+template<typename Fifo>
+void pingpong(const std::string& name) {
+  Fifo ping("benchmark_fifo_ping", 1);
+  Fifo pong("benchmark_fifo_pong", 1);
+  double ns = time_ns([&](){
+    std::thread other([&](){
+      Fifo ping("benchmark_fifo_ping");
+      Fifo pong("benchmark_fifo_pong");
+      for (size_t i=0; i<PINGPONG_OPS; ++i) {
+        pong.push(ping.pop());
+      }
+    });
+    for (size_t i=0; i<PINGPONG_OPS; ++i) {
+      ping.push(i);
+      pong.pop();
+    }
+    other.join();
+  });
+  ping.unlink();
+  pong.unlink();
+  report(name, "ping-pong", ns, PINGPONG_OPS);
+}
+
+template<typename Fifo>
+void streaming(const std::string& name, size_t nthreads) {
+  Fifo fifo("benchmark_fifo_streaming", STREAMING_SIZE);
+  size_t per_thread = STREAMING_OPS/nthreads;
+  double ns = time_ns([&](){
+    std::vector<std::thread> threads;
+    for (size_t i=0; i<nthreads; ++i) {
+      threads.push_back(std::thread([&](){
+        Fifo fifo("benchmark_fifo_streaming");
+        for (size_t j=0; j<per_thread; ++j) {
+          fifo.push(j);
+        }
+      }));
+      threads.push_back(std::thread([&](){
+        Fifo fifo("benchmark_fifo_streaming");
+        for (size_t j=0; j<per_thread; ++j) {
+          fifo.pop();
+        }
+      }));
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  });
+  fifo.unlink();
+  report(name, "streaming " + std::to_string(nthreads) + "x" + std::to_string(nthreads), ns, per_thread*nthreads);
+}
+
+template<typename Fifo>
+void run(const std::string& name) {
+  uncontended<Fifo>(name);
+  pingpong<Fifo>(name);
+  streaming<Fifo>(name, 1);
+  streaming<Fifo>(name, 4);
+}
+
+int main() {
+
+  run<cpen333::process::fifo<size_t>>("fifo");
+
+#ifdef LINUX
+  run<cpen333::process::lockfree_fifo<size_t>>("lockfree_fifo");
+#endif
+
+  return 0;
+}
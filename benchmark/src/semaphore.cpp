@@ -0,0 +1,112 @@
+/**
+ * Compares thread semaphore implementations:
+ *   - basic_semaphore<std::mutex, std::condition_variable>
+ *   - futex_semaphore (Linux only)
+ *
+ * Scenarios:
+ *   uncontended: a single thread notifies then waits, so no thread ever blocks
+ *   ping-pong:   two threads hand a token back and forth through two semaphores
+ *   contended:   several producers notify while several consumers wait
+ */
+#include <cpen333/thread/semaphore.h>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const size_t UNCONTENDED_OPS = 10000000;
+static const size_t PINGPONG_OPS = 200000;
+static const size_t CONTENDED_OPS = 1000000;
+
+template<typename Func>
+double time_ns(Func func) {
+  auto start = std::chrono::steady_clock::now();
+  func();
+  auto end = std::chrono::steady_clock::now();
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end-start).count();
+}
+
+void report(const std::string& sem, const std::string& scenario, double ns, size_t ops) {
+  std::cout << std::left << std::setw(16) << sem << std::setw(24) << scenario
+            << std::right << std::setw(10) << std::fixed << std::setprecision(1) << ns/ops << " ns/op" << std::endl;
+}
+
+template<typename Semaphore>
+void uncontended(const std::string& name) {
+  Semaphore sem(0);
+  double ns = time_ns([&](){
+    for (size_t i=0; i<UNCONTENDED_OPS; ++i) {
+      sem.notify();
+      sem.wait();
+    }
+  });
+  report(name, "uncontended", ns, UNCONTENDED_OPS);
+}
+
+template<typename Semaphore>
+void pingpong(const std::string& name) {
+  Semaphore ping(0);
+  Semaphore pong(0);
+  double ns = time_ns([&](){
+    std::thread other([&](){
+      for (size_t i=0; i<PINGPONG_OPS; ++i) {
+        ping.wait();
+        pong.notify();
+      }
+    });
+    for (size_t i=0; i<PINGPONG_OPS; ++i) {
+      ping.notify();
+      pong.wait();
+    }
+    other.join();
+  });
+  report(name, "ping-pong", ns, PINGPONG_OPS);
+}
+
+template<typename Semaphore>
+void contended(const std::string& name, size_t nthreads) {
+  Semaphore sem(0);
+  size_t per_thread = CONTENDED_OPS/nthreads;
+  double ns = time_ns([&](){
+    std::vector<std::thread> threads;
+    for (size_t i=0; i<nthreads; ++i) {
+      threads.push_back(std::thread([&](){
+        for (size_t j=0; j<per_thread; ++j) {
+          sem.notify();
+        }
+      }));
+      threads.push_back(std::thread([&](){
+        for (size_t j=0; j<per_thread; ++j) {
+          sem.wait();
+        }
+      }));
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  });
+  report(name, "contended " + std::to_string(nthreads) + "x" + std::to_string(nthreads), ns, per_thread*nthreads);
+}
+
+template<typename Semaphore>
+void run(const std::string& name) {
+  uncontended<Semaphore>(name);
+  pingpong<Semaphore>(name);
+  contended<Semaphore>(name, 1);
+  contended<Semaphore>(name, 4);
+}
+
+int main() {
+
+  typedef cpen333::thread::basic_semaphore<std::mutex, std::condition_variable> condvar_semaphore;
+  run<condvar_semaphore>("condvar");
+
+#ifdef LINUX
+  run<cpen333::thread::impl::futex_semaphore>("futex");
+#endif
+
+  return 0;
+}
@@ -0,0 +1,127 @@
+/**
+ * Compares running many short tasks:
+ *   - thread-per-task, using a std::thread for each task
+ *   - thread-per-task, using a thread_object subclass for each task (as in the examples)
+ *   - a shared thread_pool
+ *
+ * Tasks are started in batches and joined, like the examples do, so at most BATCH threads exist at a time.
+ */
+#include <cpen333/thread/thread_object.h>
+#include <cpen333/thread/thread_pool.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const size_t TASKS = 20000;
+static const size_t BATCH = 64;
+
+// a small amount of work per task
+long work(size_t seed, size_t amount) {
+  long sum = 0;
+  for (size_t i=0; i<amount; ++i) {
+    sum += (long)((seed*31 + i) % 7);
+  }
+  return sum;
+}
+
+class work_thread final : public cpen333::thread::thread_object {
+  size_t seed_;
+  size_t amount_;
+  long* result_;
+ public:
+  work_thread(size_t seed, size_t amount, long* result) : seed_(seed), amount_(amount), result_(result) {}
+ protected:
+  int main() {
+    *result_ = work(seed_, amount_);
+    return 0;
+  }
+};
+
+template<typename Func>
+double time_us(Func func) {
+  auto start = std::chrono::steady_clock::now();
+  func();
+  auto end = std::chrono::steady_clock::now();
+  return (double)std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+}
+
+void report(const std::string& style, size_t amount, double us, long check) {
+  std::cout << std::left << std::setw(16) << style << std::setw(12) << amount
+            << std::right << std::setw(12) << std::fixed << std::setprecision(2) << us/TASKS << " us/task"
+            << "  (checksum " << check << ")" << std::endl;
+}
+
+void per_std_thread(size_t amount) {
+  long total = 0;
+  double us = time_us([&](){
+    std::vector<long> results(BATCH);
+    for (size_t i=0; i<TASKS; i+=BATCH) {
+      std::vector<std::thread> threads;
+      for (size_t j=0; j<BATCH && i+j<TASKS; ++j) {
+        threads.push_back(std::thread([&results, i, j, amount](){ results[j] = work(i+j, amount); }));
+      }
+      for (size_t j=0; j<threads.size(); ++j) {
+        threads[j].join();
+        total += results[j];
+      }
+    }
+  });
+  report("std::thread", amount, us, total);
+}
+
+void per_thread_object(size_t amount) {
+  long total = 0;
+  double us = time_us([&](){
+    std::vector<long> results(BATCH);
+    for (size_t i=0; i<TASKS; i+=BATCH) {
+      std::vector<work_thread*> threads;
+      for (size_t j=0; j<BATCH && i+j<TASKS; ++j) {
+        threads.push_back(new work_thread(i+j, amount, &results[j]));
+        threads.back()->start();
+      }
+      for (size_t j=0; j<threads.size(); ++j) {
+        threads[j]->join();
+        total += results[j];
+        delete threads[j];
+      }
+    }
+  });
+  report("thread_object", amount, us, total);
+}
+
+void pooled(cpen333::thread::thread_pool& pool, size_t amount) {
+  long total = 0;
+  double us = time_us([&](){
+    std::vector<std::future<long>> results;
+    results.reserve(TASKS);
+    for (size_t i=0; i<TASKS; ++i) {
+      results.push_back(pool.submit(work, i, amount));
+    }
+    for (auto& result : results) {
+      total += result.get();
+    }
+  });
+  report("thread_pool", amount, us, total);
+}
+
+int main() {
+
+  cpen333::thread::thread_pool pool;
+  std::cout << "Running " << TASKS << " tasks, pool of " << pool.size() << " workers" << std::endl;
+  std::cout << std::left << std::setw(16) << "style" << std::setw(12) << "work" << std::endl;
+
+  size_t amounts[] = {10, 1000, 100000};
+  for (size_t amount : amounts) {
+    per_std_thread(amount);
+    per_thread_object(amount);
+    pooled(pool, amount);
+  }
+
+  return 0;
+}
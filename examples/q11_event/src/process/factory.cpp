@@ -11,14 +11,16 @@
 //
 //   An event is just like a "condition", except that it auto-resets once other threads/processes pass through.  It also
 //   has the option to either let one thread pass, notify_one(), or all currently waiting threads pass, notify_all().
+//   An auto-reset event's set() lets one thread pass, and if none is waiting yet, remembers the signal for the next
+//   to arrive, so the notifier does not have to wait for someone to be waiting.
 //
 
 
 int main() {
 
   // create events and set to unlink when this process terminates
-  cpen333::process::event chassis_ready(CHASSIS_READY_EVENT);
-  cpen333::process::event robot_finished(ROBOT_FINISHED_EVENT);
+  cpen333::process::event chassis_ready(CHASSIS_READY_EVENT, cpen333::process::event_mode::auto_reset);
+  cpen333::process::event robot_finished(ROBOT_FINISHED_EVENT, cpen333::process::event_mode::auto_reset);
 
   // make sure to unlink both named resources, the chassis event and robot event
   cpen333::process::unlinker<decltype(chassis_ready)> cunlink(chassis_ready);
@@ -7,8 +7,8 @@
 int main() {
 
   // load events
-  cpen333::process::event chassis_ready(CHASSIS_READY_EVENT);
-  cpen333::process::event robot_finished(ROBOT_FINISHED_EVENT);
+  cpen333::process::event chassis_ready(CHASSIS_READY_EVENT, cpen333::process::event_mode::auto_reset);
+  cpen333::process::event robot_finished(ROBOT_FINISHED_EVENT, cpen333::process::event_mode::auto_reset);
 
   // make 10 cars
   for (int i=0; i<10; ++i) {
@@ -17,7 +17,7 @@ int main() {
     std::cout << "Robot: Assembling Chassis" << std::endl;
     std::this_thread::sleep_for(std::chrono::seconds(1));   // delay while we assemble car
     std::cout << "Robot: Finished Assembly" << std::endl;
-    robot_finished.notify_one();  // robot has finished assembling car
+    robot_finished.set();   // robot has finished assembling car
   }
 
   return 0 ;
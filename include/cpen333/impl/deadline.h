@@ -0,0 +1,121 @@
+/**
+ * @file
+ * @brief Conversion of absolute time-points to deadlines for POSIX timed waits
+ *
+ * POSIX timed waits take an absolute `timespec` measured against a particular system clock, whereas a
+ * `std::chrono::time_point` may belong to any clock.  Only the remaining time is meaningful across clocks, so
+ * time-points are converted by measuring what remains on their own clock and adding it to the target clock's
+ * current time.
+ */
+#ifndef CPEN333_IMPL_DEADLINE_H
+#define CPEN333_IMPL_DEADLINE_H
+
+#include "../os.h"
+
+#ifdef POSIX
+
+#include <chrono>
+#include <ctime>
+
+/**
+ * @brief Defined if the C library can wait on semaphores and mutexes against CLOCK_MONOTONIC
+ *
+ * `sem_clockwait()` and `pthread_mutex_clocklock()` were added in glibc 2.30.  Without them, timed waits must use
+ * CLOCK_REALTIME deadlines, which shift if the system time is changed during the wait.
+ */
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 30))
+#define CPEN333_HAS_CLOCKWAIT
+#endif
+
+namespace cpen333 {
+namespace impl {
+
+/**
+ * @brief Converts a duration to a timespec
+ * @tparam Rep duration representation
+ * @tparam Period duration period
+ * @param duration non-negative duration
+ * @return timespec holding the duration
+ */
+template<typename Rep, typename Period>
+inline timespec to_timespec(const std::chrono::duration<Rep, Period>& duration) {
+  auto sec = std::chrono::duration_cast<std::chrono::seconds>(duration);
+  timespec ts;
+  ts.tv_sec = (time_t)sec.count();
+  ts.tv_nsec = (long)std::chrono::duration_cast<std::chrono::nanoseconds>(duration-sec).count();
+  return ts;
+}
+
+/**
+ * @brief Deadline a given time from now on a system clock
+ * @tparam Rep duration representation
+ * @tparam Period duration period
+ * @param clock system clock, e.g. CLOCK_MONOTONIC or CLOCK_REALTIME
+ * @param remaining time from now until the deadline, clamped to zero if negative
+ * @return absolute deadline in the clock's time-base
+ */
+template<typename Rep, typename Period>
+inline timespec deadline_after(clockid_t clock, const std::chrono::duration<Rep, Period>& remaining) {
+  timespec now;
+  clock_gettime(clock, &now);
+  auto deadline = std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec);
+  if (remaining.count() > 0) {
+    deadline += std::chrono::duration_cast<std::chrono::nanoseconds>(remaining);
+  }
+  return to_timespec(deadline);
+}
+
+/**
+ * @brief Converts an absolute time-point on any clock to a CLOCK_MONOTONIC timespec
+ *
+ * A deadline on the system clock is not affected by the difference between the two epochs, though it is fixed at
+ * conversion and so will not follow later changes to the system time.
+ *
+ * @tparam Clock timeout clock type
+ * @tparam Duration timeout duration type
+ * @param timeout_time absolute timeout time
+ * @return absolute timeout in the CLOCK_MONOTONIC time-base
+ */
+template<typename Clock, typename Duration>
+inline timespec monotonic_timespec(const std::chrono::time_point<Clock, Duration>& timeout_time) {
+  return deadline_after(CLOCK_MONOTONIC, timeout_time - Clock::now());
+}
+
+#ifdef LINUX
+/**
+ * @brief Specialization for the steady clock, which is already CLOCK_MONOTONIC on Linux
+ * @param timeout_time absolute timeout time
+ * @return absolute timeout in the CLOCK_MONOTONIC time-base
+ */
+template<typename Duration>
+inline timespec monotonic_timespec(const std::chrono::time_point<std::chrono::steady_clock, Duration>& timeout_time) {
+  auto since_epoch = timeout_time.time_since_epoch();
+  if (since_epoch.count() < 0) {
+    since_epoch = Duration::zero();
+  }
+  return to_timespec(since_epoch);
+}
+#endif
+
+/**
+ * @brief Converts an absolute time-point on any clock to a CLOCK_REALTIME timespec
+ *
+ * For waits that only accept CLOCK_REALTIME deadlines.  The remaining time is preserved, but the wait may end
+ * early or late if the system time is changed while waiting.
+ *
+ * @tparam Clock timeout clock type
+ * @tparam Duration timeout duration type
+ * @param timeout_time absolute timeout time
+ * @return absolute timeout in the CLOCK_REALTIME time-base
+ */
+template<typename Clock, typename Duration>
+inline timespec realtime_timespec(const std::chrono::time_point<Clock, Duration>& timeout_time) {
+  return deadline_after(CLOCK_REALTIME, timeout_time - Clock::now());
+}
+
+} // impl
+} // cpen333
+
+#endif // POSIX
+
+#endif //CPEN333_IMPL_DEADLINE_H
@@ -0,0 +1,226 @@
+/**
+ * @file
+ * @brief Thin wrappers around the Linux futex system call
+ *
+ * A futex is a 32-bit word in (possibly shared) memory that threads or processes can sleep on until the
+ * word changes.  The kernel is only entered when a thread actually needs to sleep or wake another, so
+ * primitives built on futexes cost a single atomic instruction when uncontended.  Only available on Linux.
+ */
+#ifndef CPEN333_IMPL_FUTEX_H
+#define CPEN333_IMPL_FUTEX_H
+
+#include "../os.h"
+
+#ifdef LINUX
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cerrno>
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "deadline.h"
+
+namespace cpen333 {
+namespace impl {
+
+/**
+ * @brief Futex word, a 32-bit atomic integer
+ *
+ * Must be lock-free and the same size as a plain 32-bit integer so it can be handed to the kernel and placed
+ * in memory shared between processes.
+ */
+typedef std::atomic<uint32_t> futex_word;
+
+static_assert(sizeof(futex_word) == sizeof(uint32_t), "futex word must be 32 bits");
+
+/**
+ * @brief Sleeps while the futex word still holds an expected value
+ *
+ * Returns immediately if the word no longer holds `expected`.  May also return spuriously, so callers must
+ * re-check their condition.
+ *
+ * @param word futex word
+ * @param expected value the word must hold for the caller to sleep
+ * @param shared `true` if the word may be accessed by multiple processes
+ */
+inline void futex_wait(futex_word* word, uint32_t expected, bool shared) {
+  int op = shared ? FUTEX_WAIT : (FUTEX_WAIT | FUTEX_PRIVATE_FLAG);
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, expected, nullptr, nullptr, 0);
+}
+
+/**
+ * @brief Sleeps while the futex word still holds an expected value, or until an absolute timeout
+ *
+ * The timeout is measured against CLOCK_MONOTONIC, so it is not affected by changes to the system time.
+ *
+ * @param word futex word
+ * @param expected value the word must hold for the caller to sleep
+ * @param timeout absolute CLOCK_MONOTONIC timeout (see monotonic_timespec())
+ * @param shared `true` if the word may be accessed by multiple processes
+ * @return `false` if the timeout was reached, `true` otherwise (woken, value changed, or interrupted)
+ */
+inline bool futex_wait_until(futex_word* word, uint32_t expected, const timespec& timeout, bool shared) {
+  int op = shared ? FUTEX_WAIT_BITSET : (FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG);
+  long status = syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, expected, &timeout, nullptr,
+                        FUTEX_BITSET_MATCH_ANY);
+  return !(status != 0 && errno == ETIMEDOUT);
+}
+
+/**
+ * @brief Wakes threads/processes sleeping on a futex word
+ * @param word futex word
+ * @param count maximum number of sleepers to wake
+ * @param shared `true` if the word may be accessed by multiple processes
+ * @return number of sleepers woken
+ */
+inline int futex_wake(futex_word* word, int count, bool shared) {
+  int op = shared ? FUTEX_WAKE : (FUTEX_WAKE | FUTEX_PRIVATE_FLAG);
+  long woken = syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, count, nullptr, nullptr, 0);
+  return woken < 0 ? 0 : (int)woken;
+}
+
+/**
+ * @brief Wakes some sleepers on a futex word and moves the rest to sleep on another word
+ *
+ * Only does so if the word still holds an expected value, so that callers can tell whether new sleepers may
+ * have arrived since they last looked at it.  Moved sleepers are woken by a later wake on `target` as if they
+ * had been sleeping on it all along, which lets a condition variable hand its waiters straight to a mutex.
+ *
+ * @param word futex word
+ * @param expected value the word must hold for anything to happen
+ * @param wake maximum number of sleepers to wake
+ * @param requeue maximum number of remaining sleepers to move to `target`
+ * @param target futex word to move sleepers to
+ * @param shared `true` if the words may be accessed by multiple processes
+ * @return `false` if the word no longer held `expected` (nothing was done), `true` otherwise
+ */
+inline bool futex_cmp_requeue(futex_word* word, uint32_t expected, int wake, int requeue, futex_word* target,
+                              bool shared) {
+  int op = shared ? FUTEX_CMP_REQUEUE : (FUTEX_CMP_REQUEUE | FUTEX_PRIVATE_FLAG);
+  long status = syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, wake, (void*)(intptr_t)requeue,
+                        reinterpret_cast<uint32_t*>(target), expected);
+  return status >= 0;
+}
+
+/**
+ * @brief Event count for parking threads until a lock-free condition is satisfied
+ *
+ * Plain struct of two futex words with no constructor so it can be placed directly in shared memory (zeroed
+ * memory is a valid initial state).  Waiters register themselves and re-check their condition before sleeping
+ * on the sequence word, and notifiers only bump the sequence and enter the kernel if a waiter is registered.
+ * The predicate may perform the operation being waited on (e.g. try to pop an item).
+ */
+struct futex_eventcount {
+  futex_word seq;      ///< incremented on every notification that finds a waiter
+  futex_word waiters;  ///< number of registered waiters
+
+  /**
+   * @brief Resets the event count, must not be in use
+   */
+  void init() {
+    seq.store(0, std::memory_order_relaxed);
+    waiters.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Blocks until `pred()` returns `true`
+   * @tparam Predicate predicate type, with signature `bool operator()`
+   * @param pred condition to wait for
+   * @param shared `true` if the event count is in memory shared between processes
+   */
+  template<typename Predicate>
+  void wait(Predicate pred, bool shared) {
+    while (!pred()) {
+      uint32_t key = seq.load(std::memory_order_acquire);
+      waiters.fetch_add(1, std::memory_order_seq_cst);
+      if (pred()) {
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        return;
+      }
+      futex_wait(&seq, key, shared);
+      waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Blocks until `pred()` returns `true` or an absolute CLOCK_MONOTONIC timeout is reached
+   * @tparam Predicate predicate type, with signature `bool operator()`
+   * @param timeout absolute timeout (see monotonic_timespec())
+   * @param pred condition to wait for
+   * @param shared `true` if the event count is in memory shared between processes
+   * @return the final value of `pred()`
+   */
+  template<typename Predicate>
+  bool wait_until(const timespec& timeout, Predicate pred, bool shared) {
+    while (!pred()) {
+      uint32_t key = seq.load(std::memory_order_acquire);
+      waiters.fetch_add(1, std::memory_order_seq_cst);
+      if (pred()) {
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+      bool woken = futex_wait_until(&seq, key, timeout, shared);
+      waiters.fetch_sub(1, std::memory_order_relaxed);
+      if (!woken) {
+        return pred();
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief Wakes up to `count` waiters, if any are registered
+   *
+   * Must be called after the state checked by waiters' predicates has been published.
+   *
+   * @param count maximum number of waiters to wake
+   * @param shared `true` if the event count is in memory shared between processes
+   */
+  void notify(int count, bool shared) {
+    // pairs with the waiter's registration: either we see the waiter, or it sees our published state
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) != 0) {
+      seq.fetch_add(1, std::memory_order_seq_cst);
+      futex_wake(&seq, count, shared);
+    }
+  }
+
+  /**
+   * @brief Wakes a single waiter, if any are registered
+   * @param shared `true` if the event count is in memory shared between processes
+   */
+  void notify_one(bool shared) {
+    notify(1, shared);
+  }
+
+  /**
+   * @brief Wakes all waiters, if any are registered
+   * @param shared `true` if the event count is in memory shared between processes
+   */
+  void notify_all(bool shared) {
+    notify(INT_MAX, shared);
+  }
+};
+
+/**
+ * @brief Hint to the processor that we are busy-waiting
+ */
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  __asm__ __volatile__("yield");
+#endif
+}
+
+} // impl
+} // cpen333
+
+#endif // LINUX
+
+#endif //CPEN333_IMPL_FUTEX_H
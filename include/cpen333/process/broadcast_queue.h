@@ -0,0 +1,485 @@
+/**
+ * @file
+ * @brief Single-writer multi-reader broadcast ring in shared memory
+ */
+#ifndef CPEN333_PROCESS_BROADCAST_QUEUE_H
+#define CPEN333_PROCESS_BROADCAST_QUEUE_H
+
+#include "../os.h"
+
+#ifdef LINUX
+
+/**
+ * @brief Suffix for shared memory to guarantee uniqueness
+ */
+#define BROADCAST_QUEUE_SUFFIX "_bq"
+/**
+ * @brief Magic number to test for shared memory initialization
+ */
+#define BROADCAST_QUEUE_INITIALIZED 0x71523904
+
+/**
+ * @brief Subscriber slot state while a new subscriber sets its cursor, not yet visible to the writer
+ */
+#define BROADCAST_QUEUE_SLOT_CLAIMED 1
+
+/**
+ * @brief Subscriber slot state once its cursor is valid and the writer must wait for it
+ */
+#define BROADCAST_QUEUE_SLOT_ACTIVE 2
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "../util.h"
+#include "../impl/futex.h"
+#include "named_resource.h"
+#include "shared_memory.h"
+#include "impl/embedded_sync.h"
+#include "impl/shared_layout.h"
+
+namespace cpen333 {
+namespace process {
+
+/**
+ * @brief Inter-process queue where every subscriber receives every message
+ *
+ * A ring of messages in shared memory with a single writer sequence and a private read cursor per subscriber
+ * (in the style of the LMAX Disruptor).  A message is written once and read in place by every subscriber, rather
+ * than being copied into one queue per reader.
+ *
+ * By default the writer never overwrites a message that some subscriber has not yet read: when the ring is full,
+ * send() blocks until the slowest subscriber catches up.  In lossy mode the writer never blocks and instead
+ * overwrites the oldest messages.  A subscriber that falls more than a ring behind skips ahead to the oldest
+ * message still available, and the number of messages it missed is reported by subscriber::dropped().  Each slot
+ * carries a sequence number, so a message overwritten while being read is detected and dropped rather than
+ * returned torn.
+ *
+ * Only ONE thread or process may send at a time.  `ValueType` must be trivially copyable.  Subscribers only see
+ * messages sent after they subscribe.  Only available on Linux.
+ *
+ * Example:
+ * @code
+ * // publisher
+ * cpen333::process::broadcast_queue<Tick> ticks("ticks", 4096);
+ * ticks.send(tick);
+ *
+ * // each subscriber process
+ * cpen333::process::broadcast_queue<Tick> ticks("ticks", 4096);
+ * cpen333::process::broadcast_queue<Tick>::subscriber sub(ticks);
+ * Tick tick;
+ * sub.receive(&tick);
+ * @endcode
+ *
+ * @tparam ValueType type of messages
+ */
+template<typename ValueType>
+class broadcast_queue : public virtual named_resource {
+
+  static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "broadcast_queue requires lock-free 64-bit atomics");
+
+ public:
+  /**
+   * @brief Message type
+   */
+  typedef ValueType value_type;
+
+ private:
+  struct queue_info {
+    std::atomic<uint32_t> initialized;          // magic initialized marker
+    uint32_t layout;                            // layout version
+    uint32_t lossy;                             // overwrite rather than wait for subscribers
+    size_t size;                                // ring size, power of two
+    size_t max_subscribers;                     // number of subscriber slots
+    char pad0[CPEN333_CACHE_LINE_SIZE];
+    std::atomic<uint64_t> published;            // number of messages sent, only written by the writer
+    cpen333::impl::futex_eventcount readers;    // subscribers waiting for a message
+    char pad1[CPEN333_CACHE_LINE_SIZE];
+    cpen333::impl::futex_eventcount writer;     // writer waiting for the slowest subscriber
+    char pad2[CPEN333_CACHE_LINE_SIZE];
+  };
+
+  struct subscriber_slot {
+    std::atomic<uint32_t> active;               // 0 if free, otherwise claimed or active
+    std::atomic<uint64_t> cursor;               // next sequence the subscriber will read
+    char pad[CPEN333_CACHE_LINE_SIZE];          // keep subscribers' cursors off each other's cache lines
+  };
+
+  struct cell {
+    std::atomic<uint64_t> seq;                  // sequence+1 of the message in the slot, 0 while being written
+    ValueType value;                            // message
+  };
+
+ public:
+  /**
+   * @brief Creates or connects to a named broadcast queue
+   *
+   * @param name name identifier for creating or connecting to an existing inter-process broadcast queue
+   * @param size if creating, the number of messages held by the ring, rounded up to the next power of two
+   * @param max_subscribers if creating, the maximum number of simultaneous subscribers
+   * @param lossy if creating, `true` to let the writer overwrite messages that have not been read by every
+   *        subscriber rather than block
+   */
+  broadcast_queue(const std::string& name, size_t size = 1024, size_t max_subscribers = 16, bool lossy = false) :
+      memory_(name + std::string(BROADCAST_QUEUE_SUFFIX),
+              sizeof(queue_info) + max_subscribers*sizeof(subscriber_slot) + round_up(size)*sizeof(cell)),
+      info_(nullptr), slots_(nullptr), cells_(nullptr), mask_(0), gate_(0) {
+
+    // info is at the start of the memory block, followed by the subscriber slots and the ring
+    info_ = (queue_info*)memory_.get();
+    bool initialized = impl::initialize_once(info_->initialized, BROADCAST_QUEUE_INITIALIZED, [&](){
+      info_->layout = CPEN333_PROCESS_LAYOUT_VERSION;
+      info_->size = round_up(size);
+      info_->max_subscribers = max_subscribers;
+      info_->lossy = lossy ? 1 : 0;
+      info_->published.store(0, std::memory_order_relaxed);
+      info_->readers.init();
+      info_->writer.init();
+    });
+    if (!initialized) {
+      impl::check_layout(info_->layout, name);
+    }
+    slots_ = (subscriber_slot*)memory_.get(sizeof(queue_info));
+    cells_ = (cell*)memory_.get(sizeof(queue_info) + info_->max_subscribers*sizeof(subscriber_slot));
+    mask_ = info_->size-1;
+  }
+
+  /**
+   * @brief Reads messages from a broadcast queue, independently of all other subscribers
+   *
+   * Occupies one of the queue's subscriber slots for its lifetime.  In the default (lossless) mode, the writer
+   * waits for every subscriber, so a subscriber that stops reading eventually blocks the writer.  The same
+   * applies to a process that exits without destroying its subscriber, which also keeps its slot.
+   */
+  class subscriber {
+   public:
+    /**
+     * @brief Subscribes to a queue, starting with the next message sent
+     * @param queue queue to subscribe to, must outlive the subscriber
+     */
+    subscriber(broadcast_queue& queue) : queue_(queue), slot_(nullptr), cursor_(0), dropped_(0) {
+      for (size_t i=0; i<queue_.info_->max_subscribers; ++i) {
+        uint32_t free = 0;
+        if (queue_.slots_[i].active.compare_exchange_strong(free, BROADCAST_QUEUE_SLOT_CLAIMED)) {
+          slot_ = &queue_.slots_[i];
+          break;
+        }
+      }
+      if (slot_ == nullptr) {
+        errno = EUSERS;
+        cpen333::perror(std::string("Too many subscribers to broadcast queue ") + queue_.memory_.name());
+        return;
+      }
+      // the writer ignores the slot until it is active, so set the cursor first
+      cursor_ = queue_.info_->published.load(std::memory_order_seq_cst);
+      slot_->cursor.store(cursor_, std::memory_order_seq_cst);
+      slot_->active.store(BROADCAST_QUEUE_SLOT_ACTIVE, std::memory_order_seq_cst);
+
+      // messages published before the writer could see us may be overwritten without waiting for us, so start
+      // after them
+      cursor_ = queue_.info_->published.load(std::memory_order_seq_cst);
+      slot_->cursor.store(cursor_, std::memory_order_release);
+    }
+
+   private:
+    subscriber(const subscriber&) DELETE_METHOD;
+    subscriber(subscriber&&) DELETE_METHOD;
+    subscriber& operator=(const subscriber&) DELETE_METHOD;
+    subscriber& operator=(subscriber&&) DELETE_METHOD;
+
+   public:
+    /**
+     * @brief Unsubscribes, releasing the writer if it was waiting on this subscriber
+     */
+    ~subscriber() {
+      if (slot_ != nullptr) {
+        slot_->active.store(0, std::memory_order_release);
+        queue_.info_->writer.notify_one(true);
+      }
+    }
+
+    /**
+     * @brief Whether a subscriber slot was available
+     * @return `true` if subscribed
+     */
+    bool subscribed() const {
+      return slot_ != nullptr;
+    }
+
+    /**
+     * @brief Receives the next message, blocking until one is sent
+     * @param out destination.  If `nullptr`, the message is skipped.
+     */
+    void receive(ValueType* out) {
+      if (slot_ == nullptr) {
+        return;
+      }
+      queue_.info_->readers.wait([&](){ return try_read(out); }, true);
+    }
+
+    /**
+     * @brief Receives the next message, blocking until one is sent
+     * @return next message
+     */
+    ValueType receive() {
+      ValueType out;
+      receive(&out);
+      return out;
+    }
+
+    /**
+     * @brief Tries to receive the next message without blocking
+     * @param out destination.  If `nullptr`, the message is skipped.
+     * @return `true` if a message was received, `false` if there are no new messages
+     */
+    bool try_receive(ValueType* out) {
+      return slot_ != nullptr && try_read(out);
+    }
+
+    /**
+     * @brief Tries to receive the next message, will wait for a maximum amount of time before aborting
+     * @param out destination.  If `nullptr`, the message is skipped.
+     * @param rel_time relative timeout time
+     * @return `true` if a message was received, `false` if timeout elapsed
+     */
+    template <typename Rep, typename Period>
+    bool try_receive_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+      return try_receive_until(out, std::chrono::steady_clock::now()+rel_time);
+    }
+
+    /**
+     * @brief Tries to receive the next message, will wait until a timeout time is reached before aborting
+     * @param out destination.  If `nullptr`, the message is skipped.
+     * @param timeout absolute timeout time
+     * @return `true` if a message was received, `false` if timeout
+     */
+    template<typename Clock, typename Duration>
+    bool try_receive_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+      if (slot_ == nullptr) {
+        return false;
+      }
+      timespec ts = cpen333::impl::monotonic_timespec(timeout);
+      return queue_.info_->readers.wait_until(ts, [&](){ return try_read(out); }, true);
+    }
+
+    /**
+     * @brief Number of messages sent but not yet received by this subscriber
+     * @return number of pending messages, at most the queue's capacity
+     */
+    size_t available() const {
+      uint64_t published = queue_.info_->published.load(std::memory_order_acquire);
+      uint64_t pending = published - cursor_;
+      return pending > queue_.info_->size ? queue_.info_->size : (size_t)pending;
+    }
+
+    /**
+     * @brief Total number of messages this subscriber missed because they were overwritten (lossy mode only)
+     * @return number of dropped messages
+     */
+    uint64_t dropped() const {
+      return dropped_;
+    }
+
+   private:
+    bool try_read(ValueType* out) {
+      size_t size = queue_.info_->size;
+      uint64_t published = queue_.info_->published.load(std::memory_order_acquire);
+      while (cursor_ < published) {
+        // lapped by the writer, skip to the oldest message still in the ring
+        if (published - cursor_ > size) {
+          dropped_ += published - size - cursor_;
+          cursor_ = published - size;
+        }
+
+        cell& c = queue_.cells_[cursor_ & queue_.mask_];
+        uint64_t seq = c.seq.load(std::memory_order_acquire);
+        if (seq == cursor_+1) {
+          ValueType value = c.value;
+          std::atomic_thread_fence(std::memory_order_acquire);
+          if (c.seq.load(std::memory_order_relaxed) == seq) {
+            if (out != nullptr) {
+              *out = value;
+            }
+            advance();
+            return true;
+          }
+        }
+
+        // slot is being or has been overwritten
+        ++dropped_;
+        advance();
+        published = queue_.info_->published.load(std::memory_order_acquire);
+      }
+      return false;
+    }
+
+    void advance() {
+      ++cursor_;
+      slot_->cursor.store(cursor_, std::memory_order_release);
+      if (!queue_.info_->lossy) {
+        queue_.info_->writer.notify_one(true);  // only enters the kernel if the writer is waiting on us
+      }
+    }
+
+    broadcast_queue& queue_;
+    subscriber_slot* slot_;    // our cursor in shared memory
+    uint64_t cursor_;          // sequence number of the next message to read
+    uint64_t dropped_;         // messages missed
+  };
+
+  /**
+   * @brief Sends a message to all subscribers
+   *
+   * In lossless mode, blocks while the ring is full of messages not yet read by every subscriber.
+   *
+   * @param val message to send
+   */
+  void send(const ValueType& val) {
+    uint64_t seq = info_->published.load(std::memory_order_relaxed);
+    info_->writer.wait([&](){ return writable(seq); }, true);
+    write(seq, val);
+  }
+
+  /**
+   * @brief Tries to send a message without blocking
+   * @param val message to send
+   * @return `true` if sent, `false` if the ring is full (lossless mode only)
+   */
+  bool try_send(const ValueType& val) {
+    uint64_t seq = info_->published.load(std::memory_order_relaxed);
+    if (!writable(seq)) {
+      return false;
+    }
+    write(seq, val);
+    return true;
+  }
+
+  /**
+   * @brief Tries to send a message, will wait for a maximum amount of time before aborting
+   * @param val message to send
+   * @param rel_time relative timeout time
+   * @return `true` if sent, `false` if the timeout elapsed
+   */
+  template <typename Rep, typename Period>
+  bool try_send_for(const ValueType& val, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_send_until(val, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @brief Tries to send a message, will wait until a timeout time has been reached before aborting
+   * @param val message to send
+   * @param timeout absolute timeout time
+   * @return `true` if sent, `false` if the timeout was reached
+   */
+  template<typename Clock, typename Duration>
+  bool try_send_until(const ValueType& val, const std::chrono::time_point<Clock,Duration>& timeout) {
+    uint64_t seq = info_->published.load(std::memory_order_relaxed);
+    timespec ts = cpen333::impl::monotonic_timespec(timeout);
+    if (!info_->writer.wait_until(ts, [&](){ return writable(seq); }, true)) {
+      return false;
+    }
+    write(seq, val);
+    return true;
+  }
+
+  /**
+   * @brief Number of messages held by the ring
+   * @return capacity
+   */
+  size_t capacity() const {
+    return info_->size;
+  }
+
+  /**
+   * @brief Whether the writer overwrites unread messages rather than block
+   * @return `true` if lossy
+   */
+  bool lossy() const {
+    return info_->lossy != 0;
+  }
+
+  /**
+   * @brief Total number of messages sent
+   * @return sequence number of the next message
+   */
+  uint64_t sent() const {
+    return info_->published.load(std::memory_order_acquire);
+  }
+
+  bool unlink() {
+    return memory_.unlink();
+  }
+
+  /**
+   * @copydoc cpen333::process::named_resource::unlink(const std::string&)
+   */
+  static bool unlink(const std::string& name) {
+    return cpen333::process::shared_memory::unlink(name + std::string(BROADCAST_QUEUE_SUFFIX));
+  }
+
+ private:
+
+  static size_t round_up(size_t size) {
+    size_t capacity = 1;
+    while (capacity < size) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  // whether the message with sequence `seq` can be written without overwriting one that a subscriber still needs
+  bool writable(uint64_t seq) {
+    if (info_->lossy || seq < gate_ + info_->size) {
+      return true;
+    }
+    // recompute the slowest subscriber, which only moves forward.  The fence pairs with a new subscriber
+    // activating its slot then reading published: either we see the slot, or it sees everything we published.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t gate = seq;
+    for (size_t i=0; i<info_->max_subscribers; ++i) {
+      if (slots_[i].active.load(std::memory_order_acquire) == BROADCAST_QUEUE_SLOT_ACTIVE) {
+        uint64_t cursor = slots_[i].cursor.load(std::memory_order_acquire);
+        if (cursor < gate) {
+          gate = cursor;
+        }
+      }
+    }
+    gate_ = gate;
+    return seq < gate_ + info_->size;
+  }
+
+  void write(uint64_t seq, const ValueType& val) {
+    cell& c = cells_[seq & mask_];
+    // sequence lock, so a lapped reader can tell the slot changed underneath it
+    c.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    c.value = val;
+    c.seq.store(seq+1, std::memory_order_release);
+    info_->published.store(seq+1, std::memory_order_release);
+    info_->readers.notify_all(true);  // only enters the kernel if a subscriber is waiting
+  }
+
+  cpen333::process::shared_memory memory_;   // actual memory
+  queue_info* info_;                         // pointer to queue information, at start of memory_
+  subscriber_slot* slots_;                   // subscriber cursors, after info_ in memory
+  cell* cells_;                              // ring of messages, after slots_ in memory
+  size_t mask_;                              // capacity-1, for wrapping sequence numbers
+  uint64_t gate_;                            // cached position of the slowest subscriber (writer only)
+
+};
+
+} // process
+} // cpen333
+
+// undef local macros
+#undef BROADCAST_QUEUE_SUFFIX
+#undef BROADCAST_QUEUE_INITIALIZED
+#undef BROADCAST_QUEUE_SLOT_CLAIMED
+#undef BROADCAST_QUEUE_SLOT_ACTIVE
+
+#endif // LINUX
+
+#endif //CPEN333_PROCESS_BROADCAST_QUEUE_H
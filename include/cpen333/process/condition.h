@@ -19,7 +19,9 @@
 #include <chrono>
 
 #include "named_resource.h"
+#include "../os.h"
 #include "impl/condition_base.h"
+#include "impl/condition_compact.h"
 
 namespace cpen333 {
 namespace process {
@@ -103,11 +105,8 @@ class condition : private condition_base, public virtual named_resource {
       return false;
     }
     while (!storage_->value) {
-      if (condition_base::wait_until(lock, timeout_time)) {
-        return storage_->value;
-      }
-      if (std::chrono::steady_clock::now() > timeout_time) {
-        return false;
+      if (!condition_base::wait_until(lock, timeout_time)) {
+        return storage_->value;  // timed out
       }
     }
     return true;
@@ -175,6 +174,19 @@ class condition : private condition_base, public virtual named_resource {
 
 };
 
+/**
+ * @brief Condition with the same interface as cpen333::process::condition, contained in a single shared memory segment
+ *
+ * On Linux, an alias to cpen333::process::impl::condition_compact, which keeps its state and wait queue in one
+ * segment so that attaching takes one open and one map.  On other platforms, falls back to
+ * cpen333::process::condition.
+ */
+#ifdef LINUX
+using compact_condition = impl::condition_compact;
+#else
+using compact_condition = condition;
+#endif
+
 } // process
 } // cpen333
 
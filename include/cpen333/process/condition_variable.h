@@ -106,7 +106,7 @@ class condition_variable : public condition_base, public virtual named_resource
   template<class Clock, class Duration >
   bool wait_until( std::unique_lock<cpen333::process::mutex>& lock,
                    const std::chrono::time_point<Clock, Duration>& timeout_time ) {
-    return condition_base::wait(lock, timeout_time);
+    return condition_base::wait_until(lock, timeout_time);
   }
 
   /**
@@ -181,8 +181,8 @@ class condition_variable : public condition_base, public virtual named_resource
                    const std::chrono::time_point<Clock, Duration>& timeout_time,
                    Predicate pred ) {
     while (!pred()) {
-      if (condition_base::wait_until(lock, timeout_time)) {
-        return pred();
+      if (!condition_base::wait_until(lock, timeout_time)) {
+        return pred();  // timed out
       }
     }
     return true;
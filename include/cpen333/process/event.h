@@ -10,23 +10,50 @@
  */
 #define EVENT_NAME_SUFFIX "_ev"
 
+/**
+ * @brief Magic number of testing initialization
+ */
+#define EVENT_INITIALIZED 0x87621234
+
 #include <string>
 #include <chrono>
 #include <condition_variable>
 
+#include "../os.h"
 #include "named_resource.h"
+
+namespace cpen333 {
+namespace process {
+
+/**
+ * @brief Behaviour of an event when it is set
+ */
+enum class event_mode {
+  manual_reset,  ///< set() lets every waiter through and latches the event open until reset()
+  auto_reset     ///< set() lets a single waiter through, or latches the event for the next waiter only
+};
+
+} // process
+} // cpen333
+
+#ifdef LINUX
+#include "impl/futex/event.h"
+#else
+
 #include "impl/condition_base.h"
 #include "mutex.h"
+#include "shared_memory.h"
 
 namespace cpen333 {
 namespace process {
 
 /**
- * @brief Event primitive, acting like a turnstile
+ * @brief Event primitive, acting like a turnstile that can optionally be latched open
  *
  * A named synchronization primitive that allows multiple threads and processes to wait until the
  * event is notified.  The notifier can either `notify_one()` to let a single waiter through (if any),
- * or `notify_all()` to let everyone currently waiting through.
+ * or `notify_all()` to let everyone currently waiting through.  Alternatively, `set()` triggers the event
+ * according to its mode, latching it if there is no-one for it to release (see cpen333::process::event_mode).
  *
  */
 class event : private condition_base, public virtual named_resource {
@@ -35,22 +62,37 @@ class event : private condition_base, public virtual named_resource {
   /**
    * @brief Creates or connects to a named event
    * @param name name identifier for creating or connecting to an existing inter-process event
+   * @param mode if creating, whether set() latches the event until reset() or only for a single waiter
    */
-  event(const std::string &name) :
+  event(const std::string &name, event_mode mode = event_mode::manual_reset) :
       condition_base(name + std::string(EVENT_NAME_SUFFIX)),
-      mutex_(name + std::string(EVENT_NAME_SUFFIX)) {}
+      mutex_(name + std::string(EVENT_NAME_SUFFIX)),
+      storage_(name + std::string(EVENT_NAME_SUFFIX)) {
+
+    // initialize data if we need to
+    std::lock_guard<decltype(mutex_)> lock(mutex_);
+    if (storage_->initialized != EVENT_INITIALIZED) {
+      storage_->mode = mode;
+      storage_->latched = false;
+      storage_->generation = 0;
+      storage_->waiters = 0;
+      storage_->tokens = 0;
+      storage_->initialized = EVENT_INITIALIZED;
+    }
+  }
 
   /**
    * @brief Waits for the event to be triggered
    *
-   * Causes the current thread to block until either `notify_all()` is called, or `notify_one()` and this thread
-   * happens to be the one awoken.  Note that order of wakes is system-dependent, and not necessarily in order of
-   * arrival.  This event will <em>not</em> exhibit spurious wake-ups.  A thread will be forced
+   * Returns immediately if the event is latched, consuming the latch if it is an auto-reset event.  Otherwise
+   * causes the current thread to block until either `notify_all()` or `set()` is called, or `notify_one()` and this
+   * thread happens to be the one awoken.  Note that order of wakes is system-dependent, and not necessarily in order
+   * of arrival.  This event will <em>not</em> exhibit spurious wake-ups.  A thread will be forced
    * to wait here indefinitely until the event is triggered.
    */
   void wait() {
     std::unique_lock<decltype(mutex_)> lock(mutex_);
-    condition_base::wait(lock);
+    wait(lock, false, std::chrono::steady_clock::now());
   }
 
   /**
@@ -85,32 +127,79 @@ class event : private condition_base, public virtual named_resource {
     if (!lock.try_lock_until(timeout_time)) {
       return false;
     }
-    return condition_base::wait_until(lock, timeout_time);
+    return wait(lock, true, timeout_time);
   }
 
   /**
    * @brief Wake a single thread waiting for the event to be triggered
    *
-   * Note that the choice of thread to be awoken is up to the underlying system.  Threads are not necessarily
-   * notified in order of arrival.
+   * Does not latch the event.  Note that the choice of thread to be awoken is up to the underlying system.  Threads
+   * are not necessarily notified in order of arrival.
    */
   void notify_one() {
+    {
+      std::lock_guard<decltype(mutex_)> lock(mutex_);
+      if (storage_->waiters <= storage_->tokens) {
+        return;
+      }
+      ++(storage_->tokens);
+    }
     condition_base::notify_one();
   }
 
   /**
    * @brief Wake all threads waiting for the event to be triggered
    *
-   * All threads waiting for the event will be awoken and will continue.
+   * All threads waiting for the event will be awoken and will continue.  Does not latch the event.
    */
   void notify_all() {
-    condition_base::notify_all();
+    release_all(false);
+  }
+
+  /**
+   * @brief Triggers the event
+   *
+   * For a manual-reset event, lets all waiting threads through and latches the event so that later waits return
+   * immediately until reset().  For an auto-reset event, lets a single waiting thread through, or if none are
+   * waiting, latches the event for the next thread to wait.
+   */
+  void set() {
+    if (storage_->mode == event_mode::manual_reset) {
+      release_all(true);
+      return;
+    }
+    {
+      std::lock_guard<decltype(mutex_)> lock(mutex_);
+      if (storage_->waiters <= storage_->tokens) {
+        storage_->latched = true;
+        return;
+      }
+      ++(storage_->tokens);
+    }
+    condition_base::notify_one();
+  }
+
+  /**
+   * @brief Clears the latch set by set()
+   */
+  void reset() {
+    std::lock_guard<decltype(mutex_)> lock(mutex_);
+    storage_->latched = false;
+  }
+
+  /**
+   * @brief Reset mode of the event, fixed when it was created
+   * @return event mode
+   */
+  event_mode mode() {
+    return storage_->mode;
   }
 
   virtual bool unlink() {
     bool b1 = condition_base::unlink();
     bool b2 = mutex_.unlink();
-    return (b1 && b2);
+    bool b3 = storage_.unlink();
+    return (b1 && b2 && b3);
   }
 
   /**
@@ -119,18 +208,78 @@ class event : private condition_base, public virtual named_resource {
   static bool unlink(const std::string& name) {
     bool b1 = cpen333::process::condition_base::unlink(name + std::string(EVENT_NAME_SUFFIX));
     bool b2 = cpen333::process::mutex::unlink(name + std::string(EVENT_NAME_SUFFIX));
-    return b1 && b2;
+    bool b3 = cpen333::process::shared_object<shared_data>::unlink(name + std::string(EVENT_NAME_SUFFIX));
+    return b1 && b2 && b3;
   }
 
  private:
+
+  // lets every current waiter through by advancing the generation, optionally latching the event
+  void release_all(bool latch) {
+    {
+      std::lock_guard<decltype(mutex_)> lock(mutex_);
+      if (latch) {
+        storage_->latched = true;
+      }
+      if (storage_->waiters == 0) {
+        return;
+      }
+      ++(storage_->generation);
+      storage_->waiters = 0;
+      storage_->tokens = 0;
+    }
+    condition_base::notify_all();
+  }
+
+  // waits with the lock held, returning true if let through, false on timeout
+  template<class Clock, class Duration>
+  bool wait(std::unique_lock<cpen333::process::mutex>& lock,
+            bool timeout, const std::chrono::time_point<Clock, Duration>& abs_time) {
+    if (storage_->latched) {
+      if (storage_->mode == event_mode::auto_reset) {
+        storage_->latched = false;
+      }
+      return true;
+    }
+
+    size_t generation = storage_->generation;
+    ++(storage_->waiters);
+    for (;;) {
+      bool signalled = condition_base::wait(lock, timeout, abs_time);
+      if (storage_->generation != generation) {
+        return true;   // released along with all others, no longer counted
+      } else if (storage_->tokens > 0) {
+        --(storage_->tokens);
+        --(storage_->waiters);
+        return true;
+      } else if (!signalled) {
+        --(storage_->waiters);
+        return false;
+      }
+    }
+  }
+
+  struct shared_data {
+    size_t initialized;
+    event_mode mode;
+    bool latched;
+    size_t generation;
+    size_t waiters;
+    size_t tokens;
+  };
+
   cpen333::process::mutex mutex_;
+  cpen333::process::shared_object<shared_data> storage_;
 
 };
 
 } // process
 } // cpen333
 
+#endif // LINUX
+
 // undef local macros
 #undef EVENT_NAME_SUFFIX
+#undef EVENT_INITIALIZED
 
 #endif //CPEN333_PROCESS_EVENT_H
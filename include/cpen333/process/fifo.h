@@ -24,11 +24,17 @@
 
 #include <string>
 #include <chrono>
+#include <vector>
 
 #include "named_resource.h"
 #include "shared_memory.h"
 #include "mutex.h"
 #include "semaphore.h"
+#include "impl/shared_layout.h"
+#include "../os.h"
+#include "impl/fifo_compact.h"
+#include "impl/fifo_lockfree.h"
+#include "impl/fifo_robust.h"
 
 namespace cpen333 {
 namespace process {
@@ -38,6 +44,13 @@ namespace process {
  *
  * The buffer can only contain a single type of object.  Push will block until space is available
  * in the queue.  Pop will block until there is an item in the queue.
+ *
+ * For large items, reserve()/commit() and lease()/release() construct and read items directly in the shared
+ * buffer, avoiding the copies into and out of the fifo made by push and pop.
+ *
+ * Batch operations copy their items under a single lock, but the fifo's named semaphores can only be taken one
+ * count at a time, and on POSIX also only posted one at a time, so a batch still makes one semaphore call per item.
+ * cpen333::process::compact_fifo adjusts its embedded semaphores by a whole batch in one step.
  * @tparam ValueType type of data to store in the queue
  */
 template<typename ValueType>
@@ -73,7 +86,10 @@ class fifo : public virtual named_resource {
       info_->pidx = 0;
       info_->cidx = 0;
       info_->size = size;
+      info_->layout = CPEN333_PROCESS_LAYOUT_VERSION;
       info_->initialized = FIFO_INITIALIZED;  // mark initialized
+    } else {
+      impl::check_layout(info_->layout, name);
     }
   }
 
@@ -120,7 +136,7 @@ class fifo : public virtual named_resource {
    * @return `true` if item added within the timeout time, `false` if not added
    */
   template <typename Rep, typename Period>
-  bool try_push_for(const ValueType& val, std::chrono::duration<Rep, Period>& rel_time) {
+  bool try_push_for(const ValueType& val, const std::chrono::duration<Rep, Period>& rel_time) {
     return try_push_until(val, std::chrono::steady_clock::now()+rel_time);
   }
 
@@ -207,7 +223,7 @@ class fifo : public virtual named_resource {
    * @return `true` if item successfully popped, `false` if timeout elapsed
    */
   template <typename Rep, typename Period>
-  bool try_pop_for(ValueType* out, std::chrono::duration<Rep, Period>& rel_time) {
+  bool try_pop_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
     return try_pop_until(out, std::chrono::steady_clock::now()+rel_time);
   }
 
@@ -246,6 +262,7 @@ class fifo : public virtual named_resource {
   void peek(ValueType* out) {
     csem_.wait();      // wait until item available
     peek_item(out);
+    csem_.notify();    // item is still there for the next peek or pop
   }
 
   /**
@@ -278,6 +295,7 @@ class fifo : public virtual named_resource {
       return false;
     }
     peek_item(out);
+    csem_.notify();  // item is still there for the next peek or pop
     return true;
   }
 
@@ -295,7 +313,7 @@ class fifo : public virtual named_resource {
    * @return `true` if item successfully peeked, `false` if timeout elapsed
    */
   template <typename Rep, typename Period>
-  bool try_peek_for(ValueType* out, std::chrono::duration<Rep, Period>& rel_time) {
+  bool try_peek_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
     return try_peek_until(out, std::chrono::steady_clock::now()+rel_time);
   }
 
@@ -319,9 +337,265 @@ class fifo : public virtual named_resource {
       return false;
     }
     peek_item(out);
+    csem_.notify();  // item is still there for the next peek or pop
     return true;
   }
 
+  /**
+   * @brief Adds a batch of items to the fifo
+   *
+   * Items are added in order.  Whenever the fifo is full, this will block until room becomes available,
+   * then claims as many free slots as possible (up to the remainder of the batch) and copies them in under a
+   * single lock.
+   *
+   * @param vals pointer to first item to add
+   * @param n number of items to add
+   */
+  void push_n(const ValueType* vals, size_t n) {
+    while (n > 0) {
+      psem_.wait();                                // wait until room to push
+      size_t count = 1 + try_wait_some(psem_, n-1);  // grab any other free slots
+      push_items(vals, count);
+      csem_.notify(count);                         // let consumers know items are available
+      vals += count;
+      n -= count;
+    }
+  }
+
+  /**
+   * @brief Tries to add a batch of items to the fifo without blocking
+   *
+   * Adds as many items from the front of the batch as there is currently room for.
+   *
+   * @param vals pointer to first item to add
+   * @param n number of items to add
+   * @return number of items added, which may be less than `n`
+   */
+  size_t try_push_n(const ValueType* vals, size_t n) {
+    size_t count = try_wait_some(psem_, n);
+    if (count > 0) {
+      push_items(vals, count);
+      csem_.notify(count);
+    }
+    return count;
+  }
+
+  /**
+   * @brief Removes a batch of items from the fifo
+   *
+   * If there are no items in the fifo, then this will block until one is available.  Then removes as many
+   * items as are available, up to `n`, under a single lock.
+   *
+   * @param out destination array with room for at least `n` items.  If `nullptr`, items are removed but not returned.
+   * @param n maximum number of items to remove
+   * @return number of items removed, between 1 and `n`
+   */
+  size_t pop_n(ValueType* out, size_t n) {
+    if (n == 0) {
+      return 0;
+    }
+    csem_.wait();                                // wait until item available
+    size_t count = 1 + try_wait_some(csem_, n-1);  // grab any other available items
+    pop_items(out, count);
+    psem_.notify(count);                         // let producers know slots are free
+    return count;
+  }
+
+  /**
+   * @brief Tries to remove a batch of items from the fifo without blocking
+   *
+   * @param out destination array with room for at least `n` items.  If `nullptr`, items are removed but not returned.
+   * @param n maximum number of items to remove
+   * @return number of items removed, 0 if the fifo is empty
+   */
+  size_t try_pop_n(ValueType* out, size_t n) {
+    size_t count = try_wait_some(csem_, n);
+    if (count > 0) {
+      pop_items(out, count);
+      psem_.notify(count);
+    }
+    return count;
+  }
+
+  /**
+   * @brief Removes all items currently in the fifo without blocking
+   *
+   * Appends the items to the end of `out` in order.
+   *
+   * @param out destination container
+   * @return number of items removed, 0 if the fifo is empty
+   */
+  size_t try_pop_all(std::vector<ValueType>& out) {
+    size_t count = try_wait_some(csem_, info_->size);
+    if (count > 0) {
+      size_t offset = out.size();
+      out.resize(offset+count);
+      pop_items(&out[offset], count);
+      psem_.notify(count);
+    }
+    return count;
+  }
+
+  /**
+   * @brief Reserves the next free slot for constructing an item in place
+   *
+   * Blocks until a slot is free, then returns a pointer directly into the shared buffer so a (large) item can be
+   * written without an intermediate copy.  The item becomes visible to consumers when commit() is called.  Other
+   * producers are held off between reserve() and commit(), so the slot should be filled promptly.  Every successful
+   * reserve must be followed by exactly one commit() from the same thread.
+   *
+   * @return pointer to the reserved slot
+   */
+  ValueType* reserve() {
+    psem_.wait();        // wait until room to push
+    pmutex_.lock();      // held until commit()
+    return &data_[info_->pidx % info_->size];
+  }
+
+  /**
+   * @brief Tries to reserve the next free slot without blocking
+   *
+   * See reserve().
+   *
+   * @return pointer to the reserved slot, or `nullptr` if the fifo is full or another producer holds a reservation
+   */
+  ValueType* try_reserve() {
+    if (!psem_.try_wait()) {
+      return nullptr;
+    }
+    if (!pmutex_.try_lock()) {
+      psem_.notify();    // give the slot back
+      return nullptr;
+    }
+    return &data_[info_->pidx % info_->size];
+  }
+
+  /**
+   * @brief Tries to reserve the next free slot, will wait for a maximum amount of time before aborting
+   *
+   * See reserve().
+   *
+   * @tparam Rep duration representation
+   * @tparam Period duration period
+   * @param rel_time relative timeout time
+   * @return pointer to the reserved slot, or `nullptr` if the timeout elapsed
+   */
+  template <typename Rep, typename Period>
+  ValueType* try_reserve_for(const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_reserve_until(std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @brief Tries to reserve the next free slot, will wait until a timeout time is reached before aborting
+   *
+   * See reserve().
+   *
+   * @tparam Clock clock type
+   * @tparam Duration clock duration type
+   * @param timeout absolute timeout time
+   * @return pointer to the reserved slot, or `nullptr` if the timeout was reached
+   */
+  template<typename Clock, typename Duration>
+  ValueType* try_reserve_until(const std::chrono::time_point<Clock,Duration>& timeout) {
+    if (!psem_.wait_until(timeout)) {
+      return nullptr;
+    }
+    if (!pmutex_.try_lock_until(timeout)) {
+      psem_.notify();    // give the slot back
+      return nullptr;
+    }
+    return &data_[info_->pidx % info_->size];
+  }
+
+  /**
+   * @brief Publishes the item constructed in the slot returned by the last reserve()
+   */
+  void commit() {
+    ++info_->pidx;
+    pmutex_.unlock();
+    csem_.notify();      // let consumer know a item is available
+  }
+
+  /**
+   * @brief Leases the next item for reading in place
+   *
+   * Blocks until an item is available, then returns a pointer directly into the shared buffer so a (large) item
+   * can be read without an intermediate copy.  The item is removed and its slot handed back to producers when
+   * release() is called.  Other consumers are held off between lease() and release(), so the item should be
+   * processed promptly.  Every successful lease must be followed by exactly one release() from the same thread.
+   *
+   * @return pointer to the next item
+   */
+  const ValueType* lease() {
+    csem_.wait();        // wait until item available
+    cmutex_.lock();      // held until release()
+    return &data_[info_->cidx % info_->size];
+  }
+
+  /**
+   * @brief Tries to lease the next item without blocking
+   *
+   * See lease().
+   *
+   * @return pointer to the next item, or `nullptr` if the fifo is empty or another consumer holds a lease
+   */
+  const ValueType* try_lease() {
+    if (!csem_.try_wait()) {
+      return nullptr;
+    }
+    if (!cmutex_.try_lock()) {
+      csem_.notify();    // give the item back
+      return nullptr;
+    }
+    return &data_[info_->cidx % info_->size];
+  }
+
+  /**
+   * @brief Tries to lease the next item, will wait for a maximum amount of time before aborting
+   *
+   * See lease().
+   *
+   * @tparam Rep duration representation
+   * @tparam Period duration period
+   * @param rel_time relative timeout time
+   * @return pointer to the next item, or `nullptr` if the timeout elapsed
+   */
+  template <typename Rep, typename Period>
+  const ValueType* try_lease_for(const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_lease_until(std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @brief Tries to lease the next item, will wait until a timeout time is reached before aborting
+   *
+   * See lease().
+   *
+   * @tparam Clock clock type
+   * @tparam Duration clock duration type
+   * @param timeout absolute timeout time
+   * @return pointer to the next item, or `nullptr` if the timeout was reached
+   */
+  template<typename Clock, typename Duration>
+  const ValueType* try_lease_until(const std::chrono::time_point<Clock,Duration>& timeout) {
+    if (!csem_.wait_until(timeout)) {
+      return nullptr;
+    }
+    if (!cmutex_.try_lock_until(timeout)) {
+      csem_.notify();    // give the item back
+      return nullptr;
+    }
+    return &data_[info_->cidx % info_->size];
+  }
+
+  /**
+   * @brief Removes the item returned by the last lease(), freeing its slot for producers
+   */
+  void release() {
+    ++info_->cidx;
+    cmutex_.unlock();
+    psem_.notify();      // let producer know that we are done with the slot
+  }
+
   /**
    * @brief Number of items currently in the fifo
    *
@@ -333,10 +607,6 @@ class fifo : public virtual named_resource {
   size_t size() {
     std::lock_guard<cpen333::process::mutex> lock1(pmutex_);
     std::lock_guard<cpen333::process::mutex> lock2(cmutex_);
-
-    if (info_->pidx < info_->cidx) {
-      return info_->size - info_->cidx+info_->pidx;
-    }
     return info_->pidx-info_->cidx;
   }
 
@@ -379,66 +649,72 @@ class fifo : public virtual named_resource {
 
   // only to be called internally, does not wait for semaphore
   void push_item(const ValueType &val) {
-    // lock is fast (only index increment), so will not trigger wait
-    size_t loc = 0;
-    {
-      // look at index, protect memory from multiple simultaneous pushes
-      std::lock_guard<cpen333::process::mutex> lock(pmutex_);
-      loc = info_->pidx;
-      // increment producer index for next item, wrap around if at end
-      if ((++info_->pidx) == info_->size) {
-        info_->pidx = 0;
-      }
-      // lock will unlock here as guard runs out of scope
-    }
+    // copy under the lock, so a consumer can never be handed a slot that is still being filled
+    std::lock_guard<cpen333::process::mutex> lock(pmutex_);
+    data_[info_->pidx % info_->size] = val;
+    ++info_->pidx;
+  }
 
-    // copy data to correct location
-    data_[loc] = val;  // add item to fifo
+  // decrements semaphore as many times as possible without blocking, up to max; named semaphores have no
+  // multi-count wait, so this costs one call per count
+  static size_t try_wait_some(cpen333::process::semaphore& sem, size_t max) {
+    size_t count = 0;
+    while (count < max && sem.try_wait()) {
+      ++count;
+    }
+    return count;
+  }
 
+  // only to be called internally, does not wait for semaphore
+  void push_items(const ValueType* vals, size_t n) {
+    // claim and fill the whole range under a single lock
+    std::lock_guard<cpen333::process::mutex> lock(pmutex_);
+    size_t idx = info_->pidx;
+    for (size_t i=0; i<n; ++i) {
+      data_[(idx+i) % info_->size] = vals[i];
+    }
+    info_->pidx = idx+n;
   }
 
-  void peek_item(ValueType* val) {
-    // lock is fast (only index increment), so will not trigger wait
-    size_t loc = 0;  // will store location of item to take
-    {
-      // look at index, protect memory from multiple simultaneous pops
-      std::lock_guard<cpen333::process::mutex> lock(cmutex_);
-      loc = info_->cidx;
-      // lock will unlock here as guard runs out of scope
+  // only to be called internally, does not wait for semaphore
+  void pop_items(ValueType* vals, size_t n) {
+    // claim and drain the whole range under a single lock
+    std::lock_guard<cpen333::process::mutex> lock(cmutex_);
+    size_t idx = info_->cidx;
+    if (vals != nullptr) {
+      for (size_t i=0; i<n; ++i) {
+        vals[i] = data_[(idx+i) % info_->size];
+      }
     }
+    info_->cidx = idx+n;
+  }
 
-    // copy data to output
+  void peek_item(ValueType* val) {
+    std::lock_guard<cpen333::process::mutex> lock(cmutex_);
     if (val != nullptr) {
-      *val = data_[loc];  // copy item
+      *val = data_[info_->cidx % info_->size];  // copy item
     }
   }
 
   void pop_item(ValueType* val) {
-    // lock is fast (only index increment), so will not trigger wait
-    size_t loc = 0;  // will store location of item to take
-    {
-      // look at index, protect memory from multiple simultaneous pops
-      std::lock_guard<cpen333::process::mutex> lock(cmutex_);
-      loc = info_->cidx;
-
-      // increment consumer index for next item, wrap around if at end
-      if ( (++info_->cidx) == info_->size) {
-        info_->cidx = 0;
-      }
-      // lock will unlock here as guard runs out of scope
-    }
-
-    // copy data to output
+    // copy under the lock, so a producer can never be handed a slot that is still being read
+    std::lock_guard<cpen333::process::mutex> lock(cmutex_);
     if (val != nullptr) {
-      *val = data_[loc];  // copy item
+      *val = data_[info_->cidx % info_->size];  // copy item
     }
+    ++info_->cidx;
   }
 
+  // producer and consumer indices are each on their own cache line so the two sides do not false-share
   struct fifo_info {
-    size_t pidx;      // producer index
-    size_t cidx;      // consumer index
-    size_t size;      // size (in counts of ValueType)
-    size_t initialized;  // magic initialized marker
+    uint32_t initialized;  // magic initialized marker
+    uint32_t layout;       // layout version
+    size_t size;           // size (in counts of ValueType)
+    char pad0[CPEN333_CACHE_LINE_SIZE-2*sizeof(uint32_t)-sizeof(size_t)];
+    size_t pidx;           // producer index, only ever increases
+    char pad1[CPEN333_CACHE_LINE_SIZE-sizeof(size_t)];
+    size_t cidx;           // consumer index, only ever increases
+    char pad2[CPEN333_CACHE_LINE_SIZE-sizeof(size_t)];
   };
 
   cpen333::process::shared_memory memory_;   // actual memory
@@ -451,6 +727,58 @@ class fifo : public virtual named_resource {
 
 };
 
+/**
+ * @brief Fifo with the same interface as cpen333::process::fifo, contained in a single shared memory segment
+ *
+ * On Linux, an alias to cpen333::process::impl::fifo_compact, whose locks and semaphores are embedded in the
+ * fifo's own segment so that attaching takes one open and one map.  On other platforms, falls back to
+ * cpen333::process::fifo.
+ *
+ * @tparam ValueType type of data to store in the queue
+ */
+#ifdef LINUX
+template<typename ValueType>
+using compact_fifo = impl::fifo_compact<ValueType>;
+#else
+template<typename ValueType>
+using compact_fifo = fifo<ValueType>;
+#endif
+
+/**
+ * @brief Lock-free fifo with the same interface as cpen333::process::fifo
+ *
+ * On Linux, an alias to cpen333::process::impl::fifo_lockfree, which keeps its indices and futex wait
+ * queues inside the shared memory segment so that the kernel is only entered when a process must sleep
+ * or wake another.  On other platforms, falls back to cpen333::process::fifo.
+ *
+ * @tparam ValueType type of data to store in the queue
+ */
+#ifdef LINUX
+template<typename ValueType>
+using lockfree_fifo = impl::fifo_lockfree<ValueType>;
+#else
+template<typename ValueType>
+using lockfree_fifo = fifo<ValueType>;
+#endif
+
+/**
+ * @brief Fifo with the same interface as cpen333::process::fifo that survives processes dying while using it
+ *
+ * On Linux, an alias to cpen333::process::impl::fifo_robust, whose producer and consumer locks are robust
+ * process-shared mutexes: if a process dies while holding one, the next process to lock it repairs the fifo and
+ * traffic resumes without having to manually remove the stale locks.  On other platforms, falls back to
+ * cpen333::process::fifo.
+ *
+ * @tparam ValueType type of data to store in the queue
+ */
+#ifdef LINUX
+template<typename ValueType>
+using robust_fifo = impl::fifo_robust<ValueType>;
+#else
+template<typename ValueType>
+using robust_fifo = fifo<ValueType>;
+#endif
+
 } // process
 } // cpen333
 
@@ -30,6 +30,7 @@
 #include "../mutex.h"
 #include "../semaphore.h"
 #include "../shared_memory.h"
+#include "shared_layout.h"
 
 // simulated pipe using shared memory and semaphores
 namespace cpen333 {
@@ -66,7 +67,10 @@ class basic_pipe : public virtual named_resource {
       info_->reof = 0;            // marks 1 past the final written index
       info_->weof = 0;            // marks 1 past the final read index
       info_->closed = false;
+      info_->layout = CPEN333_PROCESS_LAYOUT_VERSION;
       info_->initialized = BASIC_PIPE_INITIALIZED; // mark as initialized
+    } else {
+      impl::check_layout(info_->layout, name);
     }
   }
 
@@ -330,14 +334,19 @@ class basic_pipe : public virtual named_resource {
   }
 
  private:
+  // writer and reader positions are each on their own cache line so the two ends do not false-share
   struct pipe_info {
-    int initialized;
-    size_t read;
-    size_t write;
+    uint32_t initialized;
+    uint32_t layout;
     size_t size;
-    size_t reof;
-    size_t weof;
     bool closed;
+    char pad0[CPEN333_CACHE_LINE_SIZE-2*sizeof(uint32_t)-2*sizeof(size_t)];
+    size_t write;
+    size_t weof;
+    char pad1[CPEN333_CACHE_LINE_SIZE-2*sizeof(size_t)];
+    size_t read;
+    size_t reof;
+    char pad2[CPEN333_CACHE_LINE_SIZE-2*sizeof(size_t)];
   };
 
   cpen333::process::mutex wmutex_;
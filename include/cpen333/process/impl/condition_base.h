@@ -31,10 +31,17 @@
 #include <chrono>
 #include <condition_variable>
 
+#include "../../os.h"
 #include "../named_resource.h"
 #include "../mutex.h"
 #include "../semaphore.h"
 #include "../shared_memory.h"  // for keeping a "waiters" count needed for notify_all()
+#include "shared_layout.h"
+
+#ifdef LINUX
+// futex implementation replaces the semaphore-based one below
+#include "futex/condition_base.h"
+#endif
 
 namespace cpen333 {
 namespace process {
@@ -80,6 +87,8 @@ class lock_inverter {
   }
 };
 
+#ifndef LINUX
+
 //
 // Implementation based on boost's boost/interpress/sync/detail/condition_algorithm_8a.hpp
 // Their implementation guarantees not to have spurious wake-ups
@@ -109,7 +118,10 @@ class condition_base : public virtual named_resource {
       waiters_->blocked = 0;
       waiters_->unblock = 0;
       waiters_->gone = 0;
+      waiters_->layout = CPEN333_PROCESS_LAYOUT_VERSION;
       waiters_->initialized = CONDITION_BASE_INITIALIZED;
+    } else {
+      impl::check_layout(waiters_->layout, name);
     }
 
   }
@@ -342,11 +354,17 @@ class condition_base : public virtual named_resource {
   }
 
  private:
+  // counters are each on their own cache line, they are updated by waiters and notifiers in different processes
   struct shared_data {
-    long blocked;   // number of waiters blocked
-    long unblock;   // number of waiters to unblock
-    long gone;      // number of waiters gone
     int initialized;  // magic initialized number
+    uint32_t layout;  // layout version
+    char pad0[CPEN333_CACHE_LINE_SIZE-sizeof(int)-sizeof(uint32_t)];
+    long blocked;     // number of waiters blocked
+    char pad1[CPEN333_CACHE_LINE_SIZE-sizeof(long)];
+    long unblock;     // number of waiters to unblock
+    char pad2[CPEN333_CACHE_LINE_SIZE-sizeof(long)];
+    long gone;        // number of waiters gone
+    char pad3[CPEN333_CACHE_LINE_SIZE-sizeof(long)];
   };
 
   cpen333::process::shared_object<shared_data> waiters_;
@@ -356,6 +374,8 @@ class condition_base : public virtual named_resource {
 
 };
 
+#endif // LINUX
+
 } // process
 } // cpen333
 
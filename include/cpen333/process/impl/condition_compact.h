@@ -0,0 +1,143 @@
+/**
+ * @file
+ * @brief Condition synchronization primitive contained entirely in a single shared memory segment
+ */
+#ifndef CPEN333_PROCESS_CONDITION_COMPACT_H
+#define CPEN333_PROCESS_CONDITION_COMPACT_H
+
+#include "../../os.h"
+
+#ifdef LINUX
+
+/**
+ * @brief Suffix to append to shared memory names for uniqueness
+ */
+#define CONDITION_COMPACT_SUFFIX "_cons"
+
+/**
+ * @brief Magic number of testing initialization
+ */
+#define CONDITION_COMPACT_INITIALIZED 0x87621233
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "../named_resource.h"
+#include "../shared_memory.h"
+#include "../../impl/futex.h"
+#include "embedded_sync.h"
+#include "shared_layout.h"
+
+namespace cpen333 {
+namespace process {
+namespace impl {
+
+/**
+ * @brief Condition whose state and wait queue live in its own shared memory segment
+ *
+ * Same interface as cpen333::process::condition, but instead of a separate shared value, mutex, and
+ * condition_base (a further three semaphores, a mutex and a counter block), the value and a futex wait queue sit
+ * together in one small segment.  Creating or attaching takes one open and one map.  Setting the condition
+ * releases every waiter with a single wake call, and only if someone is waiting.  Only available on Linux.
+ */
+class condition_compact : public virtual named_resource {
+ public:
+
+  /**
+   * @brief Creates or connects to the named condition
+   * @param name name identifier for creating or connecting to an existing inter-process condition
+   * @param value initial state, as either set (`true`) or reset (`false`)
+   */
+  condition_compact(const std::string &name, bool value = false) :
+      storage_(name + std::string(CONDITION_COMPACT_SUFFIX)) {
+    bool initialized = initialize_once(storage_->initialized, CONDITION_COMPACT_INITIALIZED, [&](){
+      storage_->layout = CPEN333_PROCESS_LAYOUT_VERSION;
+      storage_->value.store(value ? 1 : 0, std::memory_order_relaxed);
+      storage_->waiters.init();
+    });
+    if (!initialized) {
+      check_layout(storage_->layout, name);
+    }
+  }
+
+  /**
+   * @copydoc cpen333::process::condition::wait()
+   */
+  void wait() {
+    storage_->waiters.wait([&](){ return is_set(); }, true);
+  }
+
+  /**
+   * @copydoc cpen333::process::condition::wait_for()
+   */
+  template<class Rep, class Period>
+  bool wait_for(const std::chrono::duration<Rep, Period>& rel_time) {
+    return wait_until(std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::process::condition::wait_until()
+   */
+  template< class Clock, class Duration >
+  bool wait_until( const std::chrono::time_point<Clock, Duration>& timeout_time ) {
+    if (is_set()) {
+      return true;
+    }
+    timespec ts = cpen333::impl::monotonic_timespec(timeout_time);
+    return storage_->waiters.wait_until(ts, [&](){ return is_set(); }, true);
+  }
+
+  /**
+   * @copydoc cpen333::process::condition::notify()
+   */
+  void notify() {
+    storage_->value.store(1, std::memory_order_release);
+    storage_->waiters.notify_all(true);
+  }
+
+  /**
+   * @copydoc cpen333::process::condition::reset()
+   */
+  void reset() {
+    storage_->value.store(0, std::memory_order_release);
+  }
+
+  virtual bool unlink() {
+    return storage_.unlink();
+  }
+
+  /**
+   * @copydoc cpen333::process::condition::unlink(const std::string&)
+   */
+  static bool unlink(const std::string& name) {
+    return cpen333::process::shared_object<shared_data>::unlink(name + std::string(CONDITION_COMPACT_SUFFIX));
+  }
+
+ private:
+  bool is_set() {
+    return storage_->value.load(std::memory_order_acquire) != 0;
+  }
+
+  struct shared_data {
+    std::atomic<uint32_t> initialized;          // magic initialized marker
+    uint32_t layout;                            // layout version
+    std::atomic<uint32_t> value;                // set (1) or reset (0)
+    cpen333::impl::futex_eventcount waiters;    // processes waiting for the condition to be set
+  };
+  cpen333::process::shared_object<shared_data> storage_;
+
+};
+
+} // impl
+} // process
+} // cpen333
+
+// undefine local macros
+#undef CONDITION_COMPACT_SUFFIX
+#undef CONDITION_COMPACT_INITIALIZED
+
+#endif // LINUX
+
+#endif //CPEN333_PROCESS_CONDITION_COMPACT_H
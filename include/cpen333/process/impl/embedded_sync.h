@@ -0,0 +1,354 @@
+/**
+ * @file
+ * @brief Synchronization primitives that live directly inside a shared memory segment
+ *
+ * Composite inter-process primitives normally build on named mutexes and semaphores, each of which is a separate
+ * kernel object that needs its own name hash, open and map.  The primitives here are plain structs of futex
+ * words with no constructor, meant to be embedded in the control block of a shared memory segment: zeroed memory
+ * is a valid initial state, and attaching to the segment attaches to every primitive in it.  Only available on
+ * Linux.
+ */
+#ifndef CPEN333_PROCESS_IMPL_EMBEDDED_SYNC_H
+#define CPEN333_PROCESS_IMPL_EMBEDDED_SYNC_H
+
+#include "../../os.h"
+
+#ifdef LINUX
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "../../util.h"
+#include "../../impl/futex.h"
+
+namespace cpen333 {
+namespace process {
+namespace impl {
+
+/**
+ * @brief Maximum number of times a contended embedded_mutex spins before sleeping
+ */
+#define EMBEDDED_MUTEX_MAX_SPIN 100
+
+/**
+ * @brief Mutual exclusion lock embedded in shared memory
+ *
+ * A three-state futex mutex (unlocked, locked, locked with possible sleepers).  Locking and unlocking cost a
+ * single atomic instruction when uncontended, and unlocking only enters the kernel if another thread or process
+ * may be sleeping.  On a multi-core machine, a contended lock first spins briefly in case the holder is about to
+ * release it; the spin length adapts to how long recent lockers had to spin.  Zeroed memory is an unlocked mutex.
+ * Meets the TimedLockable requirements, so it can be used with std::lock_guard and std::unique_lock.
+ */
+struct embedded_mutex {
+  cpen333::impl::futex_word state;   ///< 0: unlocked, 1: locked, 2: locked with possible sleepers
+  cpen333::impl::futex_word spins;   ///< running estimate of how long to spin before sleeping
+
+  /**
+   * @brief Resets the mutex to unlocked, must not be in use
+   */
+  void init() {
+    state.store(0, std::memory_order_relaxed);
+    spins.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Locks the mutex, blocking if necessary
+   */
+  void lock() {
+    uint32_t c = 0;
+    if (state.compare_exchange_strong(c, 1, std::memory_order_acquire)) {
+      return;
+    }
+    if (spin_lock()) {
+      return;
+    }
+    c = state.load(std::memory_order_relaxed);
+    // mark contended and sleep until we are the one to swap out an unlocked state
+    if (c != 2) {
+      c = state.exchange(2, std::memory_order_acquire);
+    }
+    while (c != 0) {
+      cpen333::impl::futex_wait(&state, 2, true);
+      c = state.exchange(2, std::memory_order_acquire);
+    }
+  }
+
+  /**
+   * @brief Tries to lock the mutex without blocking
+   * @return `true` if locked
+   */
+  bool try_lock() {
+    uint32_t c = 0;
+    return state.compare_exchange_strong(c, 1, std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Tries to lock the mutex until a relative timeout has elapsed
+   * @param rel_time maximum time to block for
+   * @return `true` if locked, `false` on timeout
+   */
+  template<typename Rep, typename Period>
+  bool try_lock_for(const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_lock_until(std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @brief Tries to lock the mutex until an absolute timeout has been reached
+   * @param timeout_time absolute timeout time
+   * @return `true` if locked, `false` on timeout
+   */
+  template<typename Clock, typename Duration>
+  bool try_lock_until(const std::chrono::time_point<Clock, Duration>& timeout_time) {
+    uint32_t c = 0;
+    if (state.compare_exchange_strong(c, 1, std::memory_order_acquire)) {
+      return true;
+    }
+    timespec ts = cpen333::impl::monotonic_timespec(timeout_time);
+    if (c != 2) {
+      c = state.exchange(2, std::memory_order_acquire);
+    }
+    while (c != 0) {
+      if (!cpen333::impl::futex_wait_until(&state, 2, ts, true)) {
+        // one last attempt, the mutex may have been released just as we timed out
+        c = 0;
+        return state.compare_exchange_strong(c, 2, std::memory_order_acquire);
+      }
+      c = state.exchange(2, std::memory_order_acquire);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Locks the mutex assuming others may be sleeping on it
+   *
+   * For threads that were moved onto the mutex's futex while sleeping elsewhere (see
+   * cpen333::impl::futex_cmp_requeue()).  Leaves the mutex marked as having sleepers, so the next unlock wakes
+   * any others that were moved along with this one.
+   */
+  void lock_contended() {
+    while (state.exchange(2, std::memory_order_acquire) != 0) {
+      cpen333::impl::futex_wait(&state, 2, true);
+    }
+  }
+
+  /**
+   * @brief Makes sure that threads just moved onto the mutex's futex will be woken
+   *
+   * If the mutex is locked, marks it as having sleepers so that unlock() wakes one.  If it is unlocked, wakes one
+   * now.
+   */
+  void wake_moved() {
+    uint32_t c = state.load(std::memory_order_relaxed);
+    for (;;) {
+      if (c == 2) {
+        return;
+      } else if (c == 0) {
+        cpen333::impl::futex_wake(&state, 1, true);
+        return;
+      } else if (state.compare_exchange_weak(c, 2, std::memory_order_relaxed)) {
+        return;
+      }
+    }
+  }
+
+  /**
+   * @brief Unlocks the mutex, waking a sleeper if there may be one
+   */
+  void unlock() {
+    if (state.exchange(0, std::memory_order_release) == 2) {
+      cpen333::impl::futex_wake(&state, 1, true);
+    }
+  }
+
+ private:
+  // spins for up to twice the recent average before giving up, since sleeping and waking cost far more than a
+  // short wait for a holder running on another core.  Pointless on a single core, where the holder cannot run.
+  bool spin_lock() {
+    static const bool multicore = std::thread::hardware_concurrency() > 1;
+    if (!multicore) {
+      return false;
+    }
+    int32_t estimate = (int32_t)spins.load(std::memory_order_relaxed);
+    int32_t limit = 2*estimate + 10;
+    if (limit > EMBEDDED_MUTEX_MAX_SPIN) {
+      limit = EMBEDDED_MUTEX_MAX_SPIN;
+    }
+    int32_t n = 0;
+    bool locked = false;
+    while (n < limit) {
+      ++n;
+      cpen333::impl::cpu_relax();
+      uint32_t c = state.load(std::memory_order_relaxed);
+      if (c == 0 && state.compare_exchange_weak(c, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+        locked = true;
+        break;
+      }
+    }
+    spins.store((uint32_t)(estimate + (n - estimate)/8), std::memory_order_relaxed);
+    return locked;
+  }
+};
+
+/**
+ * @brief Counting semaphore embedded in shared memory
+ *
+ * The count is a futex word, so waiting on a positive count and notifying when nobody sleeps cost a single atomic
+ * instruction.  Zeroed memory is a semaphore with a count of zero; use init() to start with a different count.
+ */
+struct embedded_semaphore {
+  cpen333::impl::futex_word count;    ///< current count
+  cpen333::impl::futex_word waiters;  ///< number of threads/processes that may be sleeping
+
+  /**
+   * @brief Resets the semaphore, must not be in use
+   * @param value initial count
+   */
+  void init(uint32_t value) {
+    count.store(value, std::memory_order_relaxed);
+    waiters.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Decrements the count, blocking while it is zero
+   */
+  void wait() {
+    while (!try_wait()) {
+      waiters.fetch_add(1, std::memory_order_seq_cst);
+      cpen333::impl::futex_wait(&count, 0, true);
+      waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Decrements the count if it is positive, without blocking
+   * @return `true` if decremented
+   */
+  bool try_wait() {
+    uint32_t c = count.load(std::memory_order_relaxed);
+    while (c > 0) {
+      if (count.compare_exchange_weak(c, c-1, std::memory_order_acquire, std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief Decrements the count by up to `n` without blocking
+   * @param n maximum amount to decrement by
+   * @return amount decremented, 0 if the count was zero
+   */
+  uint32_t try_wait_some(uint32_t n) {
+    uint32_t c = count.load(std::memory_order_relaxed);
+    while (c > 0 && n > 0) {
+      uint32_t take = c < n ? c : n;
+      if (count.compare_exchange_weak(c, c-take, std::memory_order_acquire, std::memory_order_relaxed)) {
+        return take;
+      }
+    }
+    return 0;
+  }
+
+  /**
+   * @brief Decrements the count, blocking while it is zero until a relative timeout has elapsed
+   * @param rel_time maximum time to block for
+   * @return `true` if decremented, `false` on timeout
+   */
+  template<typename Rep, typename Period>
+  bool wait_for(const std::chrono::duration<Rep, Period>& rel_time) {
+    return wait_until(std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @brief Decrements the count, blocking while it is zero until an absolute timeout has been reached
+   * @param timeout_time absolute timeout time
+   * @return `true` if decremented, `false` on timeout
+   */
+  template<typename Clock, typename Duration>
+  bool wait_until(const std::chrono::time_point<Clock, Duration>& timeout_time) {
+    if (try_wait()) {
+      return true;
+    }
+    timespec ts = cpen333::impl::monotonic_timespec(timeout_time);
+    for (;;) {
+      waiters.fetch_add(1, std::memory_order_seq_cst);
+      bool woken = cpen333::impl::futex_wait_until(&count, 0, ts, true);
+      waiters.fetch_sub(1, std::memory_order_relaxed);
+      if (try_wait()) {
+        return true;
+      } else if (!woken) {
+        return false;
+      }
+    }
+  }
+
+  /**
+   * @brief Increments the count, waking sleepers if there are any
+   * @param n amount to increment by
+   */
+  void notify(uint32_t n = 1) {
+    count.fetch_add(n, std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_seq_cst) != 0) {
+      cpen333::impl::futex_wake(&count, n < (uint32_t)INT_MAX ? (int)n : INT_MAX, true);
+    }
+  }
+
+  /**
+   * @brief Current count, may be stale by the time it is used
+   * @return count
+   */
+  uint32_t value() const {
+    return count.load(std::memory_order_relaxed);
+  }
+};
+
+/**
+ * @brief Initializes a shared control block exactly once across all attached processes
+ *
+ * The first process to attach to a freshly zeroed segment swaps in an `initializing` marker, runs `init`,
+ * then publishes `magic`.  Everyone else waits until `magic` is visible.  No named lock is needed.  If the
+ * initializer dies part way through, waiters give up after CPEN333_ATTACH_TIMEOUT_MS with a std::system_error,
+ * failing construction of the resource.
+ *
+ * @tparam Func initialization function type, with signature `void operator()`
+ * @param state initialization word at the start of the control block
+ * @param magic value marking a fully-initialized block
+ * @param init initialization function, called by one process only
+ * @return `true` if this call performed the initialization
+ */
+template<typename Func>
+inline bool initialize_once(std::atomic<uint32_t>& state, uint32_t magic, Func init) {
+  uint32_t expected = 0;
+  if (state.compare_exchange_strong(expected, 1, std::memory_order_acquire)) {
+    init();
+    state.store(magic, std::memory_order_release);
+    return true;
+  }
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CPEN333_ATTACH_TIMEOUT_MS);
+  while (state.load(std::memory_order_acquire) != magic) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      std::string msg("Timed out waiting for shared memory to be initialized");
+      cpen333::error(msg);
+      throw std::system_error(ETIMEDOUT, std::generic_category(), msg);
+    }
+    std::this_thread::yield();
+  }
+  return false;
+}
+
+} // impl
+} // process
+} // cpen333
+
+// undef local macros
+#undef EMBEDDED_MUTEX_MAX_SPIN
+
+#endif // LINUX
+
+#endif //CPEN333_PROCESS_IMPL_EMBEDDED_SYNC_H
@@ -0,0 +1,502 @@
+/**
+ * @file
+ * @brief First-in-first-out shared buffer contained entirely in a single shared memory segment
+ */
+#ifndef CPEN333_PROCESS_FIFO_COMPACT_H
+#define CPEN333_PROCESS_FIFO_COMPACT_H
+
+#include "../../os.h"
+
+#ifdef LINUX
+
+/**
+ * @brief Suffix for shared memory to guarantee uniqueness
+ */
+#define FIFO_COMPACT_SUFFIX "_ffs"
+/**
+ * @brief Magic number to test for shared memory initialization
+ */
+#define FIFO_COMPACT_INITIALIZED 0x88372614
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../named_resource.h"
+#include "../shared_memory.h"
+#include "embedded_sync.h"
+#include "shared_layout.h"
+
+namespace cpen333 {
+namespace process {
+namespace impl {
+
+/**
+ * @brief Multi-process first-in-first-out queue whose locks and semaphores live in its own shared memory segment
+ *
+ * Same circular buffer and interface as cpen333::process::fifo, but the producer/consumer mutexes and semaphores
+ * are embedded in the segment's control block rather than being separate named kernel objects.  Creating or
+ * attaching to the fifo therefore hashes one name and performs one open and one map, instead of five of each.
+ * Only available on Linux.
+ *
+ * @tparam ValueType type of data to store in the queue
+ */
+template<typename ValueType>
+class fifo_compact : public virtual named_resource {
+
+ public:
+  /**
+   * @brief data type stored in buffer
+   */
+  typedef ValueType value_type;
+
+  /**
+   * @brief Creates or connects to an existing named fifo
+   * @param name name identifier for creating or connecting to an existing inter-process fifo
+   * @param size if creating, the maximum number of elements that can be stored in the queue without blocking
+   */
+  fifo_compact(const std::string& name, size_t size = 1024) :
+      memory_(name + std::string(FIFO_COMPACT_SUFFIX), sizeof(fifo_info)+size*sizeof(ValueType)),
+      info_(nullptr), data_(nullptr) {
+
+    // info is at start of memory block, followed by the actual data in the fifo
+    info_ = (fifo_info*)memory_.get();
+    data_ = (ValueType*)memory_.get(sizeof(fifo_info));
+
+    bool initialized = initialize_once(info_->initialized, FIFO_COMPACT_INITIALIZED, [&](){
+      info_->layout = CPEN333_PROCESS_LAYOUT_VERSION;
+      info_->pidx = 0;
+      info_->cidx = 0;
+      info_->size = size;
+      info_->pmutex.init();
+      info_->cmutex.init();
+      info_->psem.init((uint32_t)size);
+      info_->csem.init(0);
+    });
+    if (!initialized) {
+      check_layout(info_->layout, name);
+    }
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::push()
+   */
+  void push(const ValueType &val) {
+    info_->psem.wait();
+    push_items(&val, 1);
+    info_->csem.notify();
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_push()
+   */
+  bool try_push(const ValueType &val) {
+    if (!info_->psem.try_wait()) {
+      return false;
+    }
+    push_items(&val, 1);
+    info_->csem.notify();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_push_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_push_for(const ValueType& val, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_push_until(val, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_push_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_push_until(const ValueType& val, const std::chrono::time_point<Clock,Duration>& timeout) {
+    if (!info_->psem.wait_until(timeout)) {
+      return false;
+    }
+    push_items(&val, 1);
+    info_->csem.notify();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::pop(ValueType*)
+   */
+  void pop(ValueType* out) {
+    info_->csem.wait();
+    pop_items(out, 1);
+    info_->psem.notify();
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::pop()
+   */
+  ValueType pop() {
+    ValueType out;
+    pop(&out);
+    return out;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_pop()
+   */
+  bool try_pop(ValueType* out) {
+    if (!info_->csem.try_wait()) {
+      return false;
+    }
+    pop_items(out, 1);
+    info_->psem.notify();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_pop_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_pop_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_pop_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_pop_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_pop_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    if (!info_->csem.wait_until(timeout)) {
+      return false;
+    }
+    pop_items(out, 1);
+    info_->psem.notify();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::peek(ValueType*)
+   */
+  void peek(ValueType* out) {
+    info_->csem.wait();
+    peek_item(out);
+    info_->csem.notify();  // item is still there for the next peek or pop
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::peek()
+   */
+  ValueType peek() {
+    ValueType out;
+    peek(&out);
+    return out;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_peek()
+   */
+  bool try_peek(ValueType* out) {
+    if (!info_->csem.try_wait()) {
+      return false;
+    }
+    peek_item(out);
+    info_->csem.notify();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_peek_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_peek_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_peek_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_peek_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_peek_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    if (!info_->csem.wait_until(timeout)) {
+      return false;
+    }
+    peek_item(out);
+    info_->csem.notify();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::push_n()
+   */
+  void push_n(const ValueType* vals, size_t n) {
+    while (n > 0) {
+      info_->psem.wait();
+      size_t count = 1 + info_->psem.try_wait_some(clamp(n-1));
+      push_items(vals, count);
+      info_->csem.notify((uint32_t)count);  // single wakeup call for the whole batch
+      vals += count;
+      n -= count;
+    }
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_push_n()
+   */
+  size_t try_push_n(const ValueType* vals, size_t n) {
+    size_t count = info_->psem.try_wait_some(clamp(n));
+    if (count > 0) {
+      push_items(vals, count);
+      info_->csem.notify((uint32_t)count);
+    }
+    return count;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::pop_n()
+   */
+  size_t pop_n(ValueType* out, size_t n) {
+    if (n == 0) {
+      return 0;
+    }
+    info_->csem.wait();
+    size_t count = 1 + info_->csem.try_wait_some(clamp(n-1));
+    pop_items(out, count);
+    info_->psem.notify((uint32_t)count);
+    return count;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_pop_n()
+   */
+  size_t try_pop_n(ValueType* out, size_t n) {
+    size_t count = info_->csem.try_wait_some(clamp(n));
+    if (count > 0) {
+      pop_items(out, count);
+      info_->psem.notify((uint32_t)count);
+    }
+    return count;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_pop_all()
+   */
+  size_t try_pop_all(std::vector<ValueType>& out) {
+    size_t count = info_->csem.try_wait_some(clamp(info_->size));
+    if (count > 0) {
+      size_t offset = out.size();
+      out.resize(offset+count);
+      pop_items(&out[offset], count);
+      info_->psem.notify((uint32_t)count);
+    }
+    return count;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::reserve()
+   */
+  ValueType* reserve() {
+    info_->psem.wait();
+    info_->pmutex.lock();      // held until commit()
+    return &data_[info_->pidx % info_->size];
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_reserve()
+   */
+  ValueType* try_reserve() {
+    if (!info_->psem.try_wait()) {
+      return nullptr;
+    }
+    if (!info_->pmutex.try_lock()) {
+      info_->psem.notify();    // give the slot back
+      return nullptr;
+    }
+    return &data_[info_->pidx % info_->size];
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_reserve_for()
+   */
+  template <typename Rep, typename Period>
+  ValueType* try_reserve_for(const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_reserve_until(std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_reserve_until()
+   */
+  template<typename Clock, typename Duration>
+  ValueType* try_reserve_until(const std::chrono::time_point<Clock,Duration>& timeout) {
+    if (!info_->psem.wait_until(timeout)) {
+      return nullptr;
+    }
+    if (!info_->pmutex.try_lock_until(timeout)) {
+      info_->psem.notify();    // give the slot back
+      return nullptr;
+    }
+    return &data_[info_->pidx % info_->size];
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::commit()
+   */
+  void commit() {
+    ++info_->pidx;
+    info_->pmutex.unlock();
+    info_->csem.notify();
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::lease()
+   */
+  const ValueType* lease() {
+    info_->csem.wait();
+    info_->cmutex.lock();      // held until release()
+    return &data_[info_->cidx % info_->size];
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_lease()
+   */
+  const ValueType* try_lease() {
+    if (!info_->csem.try_wait()) {
+      return nullptr;
+    }
+    if (!info_->cmutex.try_lock()) {
+      info_->csem.notify();    // give the item back
+      return nullptr;
+    }
+    return &data_[info_->cidx % info_->size];
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_lease_for()
+   */
+  template <typename Rep, typename Period>
+  const ValueType* try_lease_for(const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_lease_until(std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_lease_until()
+   */
+  template<typename Clock, typename Duration>
+  const ValueType* try_lease_until(const std::chrono::time_point<Clock,Duration>& timeout) {
+    if (!info_->csem.wait_until(timeout)) {
+      return nullptr;
+    }
+    if (!info_->cmutex.try_lock_until(timeout)) {
+      info_->csem.notify();    // give the item back
+      return nullptr;
+    }
+    return &data_[info_->cidx % info_->size];
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::release()
+   */
+  void release() {
+    ++info_->cidx;
+    info_->cmutex.unlock();
+    info_->psem.notify();
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::size()
+   */
+  size_t size() {
+    std::lock_guard<embedded_mutex> lock1(info_->pmutex);
+    std::lock_guard<embedded_mutex> lock2(info_->cmutex);
+    return info_->pidx - info_->cidx;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::empty()
+   */
+  bool empty() {
+    return size() == 0;
+  }
+
+  bool unlink() {
+    return memory_.unlink();
+  }
+
+  /**
+   * @copydoc cpen333::process::named_resource::unlink(const std::string&)
+   */
+  static bool unlink(const std::string& name) {
+    return cpen333::process::shared_memory::unlink(name + std::string(FIFO_COMPACT_SUFFIX));
+  }
+
+ private:
+
+  // semaphore counts are 32-bit
+  static uint32_t clamp(size_t n) {
+    return n < (size_t)UINT32_MAX ? (uint32_t)n : UINT32_MAX;
+  }
+
+  // only to be called internally, does not wait for semaphore
+  void push_items(const ValueType* vals, size_t n) {
+    // claim and fill the whole range under a single lock
+    std::lock_guard<embedded_mutex> lock(info_->pmutex);
+    size_t idx = info_->pidx;
+    for (size_t i=0; i<n; ++i) {
+      data_[(idx+i) % info_->size] = vals[i];
+    }
+    info_->pidx = idx+n;
+  }
+
+  // only to be called internally, does not wait for semaphore
+  void pop_items(ValueType* vals, size_t n) {
+    // claim and drain the whole range under a single lock
+    std::lock_guard<embedded_mutex> lock(info_->cmutex);
+    size_t idx = info_->cidx;
+    if (vals != nullptr) {
+      for (size_t i=0; i<n; ++i) {
+        vals[i] = data_[(idx+i) % info_->size];
+      }
+    }
+    info_->cidx = idx+n;
+  }
+
+  void peek_item(ValueType* val) {
+    std::lock_guard<embedded_mutex> lock(info_->cmutex);
+    if (val != nullptr) {
+      *val = data_[info_->cidx % info_->size];
+    }
+  }
+
+  struct fifo_info {
+    std::atomic<uint32_t> initialized;  // magic initialized marker
+    uint32_t layout;                    // layout version
+    size_t size;                        // size (in counts of ValueType)
+    char pad0[CPEN333_CACHE_LINE_SIZE];
+    size_t pidx;                        // producer index, only ever increases
+    embedded_mutex pmutex;              // protects producer index
+    char pad1[CPEN333_CACHE_LINE_SIZE];
+    size_t cidx;                        // consumer index, only ever increases
+    embedded_mutex cmutex;              // protects consumer index
+    char pad2[CPEN333_CACHE_LINE_SIZE];
+    embedded_semaphore psem;            // free slots, taken by producers and given back by consumers
+    char pad3[CPEN333_CACHE_LINE_SIZE];
+    embedded_semaphore csem;            // available items, taken by consumers and given back by producers
+    char pad4[CPEN333_CACHE_LINE_SIZE];
+  };
+
+  cpen333::process::shared_memory memory_;   // actual memory
+  fifo_info* info_;                          // pointer to fifo information, at start of memory_
+  ValueType* data_;                          // pointer to data in fifo, after info_ in memory
+
+};
+
+} // impl
+} // process
+} // cpen333
+
+// undef local macros
+#undef FIFO_COMPACT_SUFFIX
+#undef FIFO_COMPACT_INITIALIZED
+
+#endif // LINUX
+
+#endif //CPEN333_PROCESS_FIFO_COMPACT_H
@@ -0,0 +1,467 @@
+/**
+ * @file
+ * @brief Lock-free first-in-first-out shared buffer for inter-process communication
+ */
+#ifndef CPEN333_PROCESS_FIFO_LOCKFREE_H
+#define CPEN333_PROCESS_FIFO_LOCKFREE_H
+
+#include "../../os.h"
+
+#ifdef LINUX
+
+/**
+ * @brief Suffix for shared memory to guarantee uniqueness
+ */
+#define FIFO_LOCKFREE_SUFFIX "_fflf"
+/**
+ * @brief Magic number to test for shared memory initialization
+ */
+#define FIFO_LOCKFREE_INITIALIZED 0x88372613
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../../util.h"
+#include "../../impl/futex.h"
+#include "../named_resource.h"
+#include "../shared_memory.h"
+#include "embedded_sync.h"
+#include "shared_layout.h"
+
+namespace cpen333 {
+namespace process {
+namespace impl {
+
+/**
+ * @brief Lock-free multi-process multi-producer multi-consumer first-in-first-out queue
+ *
+ * The whole queue lives in a single shared memory segment: a header holding the producer and consumer indices
+ * as atomics, followed by a ring of slots that each carry a sequence number telling producers and consumers
+ * whether the slot is free or full for the current lap (D. Vyukov's bounded MPMC queue).  A push or pop
+ * claims a slot with a single compare-and-swap, so no kernel mutex or semaphore is involved.
+ *
+ * Processes that find the queue full or empty park on process-shared futexes stored in the same segment.
+ * The kernel is only entered when a process actually has to sleep, or when a push/pop finds a process
+ * parked on the other side.
+ *
+ * The interface mirrors cpen333::process::fifo.  The capacity is rounded up to the next power of two.  As with
+ * cpen333::process::fifo, `ValueType` must be trivially copyable.  Only available on Linux.
+ *
+ * Note: with multiple consumers, `peek` is only a hint: the peeked item may be popped by another consumer
+ * immediately afterwards.
+ *
+ * @tparam ValueType type of data to store in the queue
+ */
+template<typename ValueType>
+class fifo_lockfree : public virtual named_resource {
+
+  static_assert(ATOMIC_LONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+                "fifo_lockfree requires lock-free atomics to share them between processes");
+
+ public:
+  /**
+   * @brief data type stored in buffer
+   */
+  typedef ValueType value_type;
+
+  /**
+   * @brief Creates or connects to an existing named fifo
+   * @param name name identifier for creating or connecting to an existing inter-process fifo
+   * @param size if creating, the minimum number of elements that can be stored in the queue without blocking,
+   *        rounded up to the next power of two
+   */
+  fifo_lockfree(const std::string& name, size_t size = 1024) :
+      memory_(name + std::string(FIFO_LOCKFREE_SUFFIX), sizeof(fifo_info)+round_up(size)*sizeof(cell)),
+      info_(nullptr), cells_(nullptr), mask_(0) {
+
+    // info is at start of memory block, followed by the ring of slots
+    info_ = (fifo_info*)memory_.get();
+    cells_ = (cell*)memory_.get(sizeof(fifo_info));
+
+    bool initialized = initialize_once(info_->initialized, FIFO_LOCKFREE_INITIALIZED, [&](){
+      size_t capacity = round_up(size);
+      info_->layout = CPEN333_PROCESS_LAYOUT_VERSION;
+      info_->size = capacity;
+      info_->pidx.store(0, std::memory_order_relaxed);
+      info_->cidx.store(0, std::memory_order_relaxed);
+      info_->pwait.init();
+      info_->cwait.init();
+      for (size_t i=0; i<capacity; ++i) {
+        cells_[i].seq.store(i, std::memory_order_relaxed);
+      }
+    });
+    if (!initialized) {
+      check_layout(info_->layout, name);
+    }
+    mask_ = info_->size-1;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::push()
+   */
+  void push(const ValueType &val) {
+    info_->pwait.wait([&](){ return try_push_item(val); }, true);
+    info_->cwait.notify_one(true);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_push()
+   */
+  bool try_push(const ValueType &val) {
+    if (!try_push_item(val)) {
+      return false;
+    }
+    info_->cwait.notify_one(true);
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_push_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_push_for(const ValueType& val, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_push_until(val, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_push_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_push_until(const ValueType& val, const std::chrono::time_point<Clock,Duration>& timeout) {
+    timespec ts = cpen333::impl::monotonic_timespec(timeout);
+    if (!info_->pwait.wait_until(ts, [&](){ return try_push_item(val); }, true)) {
+      return false;
+    }
+    info_->cwait.notify_one(true);
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::pop(ValueType*)
+   */
+  void pop(ValueType* out) {
+    info_->cwait.wait([&](){ return try_pop_item(out); }, true);
+    info_->pwait.notify_one(true);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::pop()
+   */
+  ValueType pop() {
+    ValueType out;
+    pop(&out);
+    return out;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_pop()
+   */
+  bool try_pop(ValueType* out) {
+    if (!try_pop_item(out)) {
+      return false;
+    }
+    info_->pwait.notify_one(true);
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_pop_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_pop_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_pop_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_pop_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_pop_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    timespec ts = cpen333::impl::monotonic_timespec(timeout);
+    if (!info_->cwait.wait_until(ts, [&](){ return try_pop_item(out); }, true)) {
+      return false;
+    }
+    info_->pwait.notify_one(true);
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::peek(ValueType*)
+   */
+  void peek(ValueType* out) {
+    info_->cwait.wait([&](){ return try_peek_item(out); }, true);
+    info_->cwait.notify_one(true);  // we may have taken the wakeup meant for a pop, and the item is still there
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::peek()
+   */
+  ValueType peek() {
+    ValueType out;
+    peek(&out);
+    return out;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_peek()
+   */
+  bool try_peek(ValueType* out) {
+    return try_peek_item(out);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_peek_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_peek_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_peek_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_peek_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_peek_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    timespec ts = cpen333::impl::monotonic_timespec(timeout);
+    if (!info_->cwait.wait_until(ts, [&](){ return try_peek_item(out); }, true)) {
+      return false;
+    }
+    info_->cwait.notify_one(true);  // pass on a wakeup that may have been meant for a pop
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::push_n()
+   */
+  void push_n(const ValueType* vals, size_t n) {
+    while (n > 0) {
+      size_t count = 0;
+      info_->pwait.wait([&](){ count = try_push_items(vals, n); return count > 0; }, true);
+      info_->cwait.notify((int)(count < (size_t)INT_MAX ? count : INT_MAX), true);
+      vals += count;
+      n -= count;
+    }
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_push_n()
+   */
+  size_t try_push_n(const ValueType* vals, size_t n) {
+    size_t count = try_push_items(vals, n);
+    if (count > 0) {
+      info_->cwait.notify((int)(count < (size_t)INT_MAX ? count : INT_MAX), true);
+    }
+    return count;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::pop_n()
+   */
+  size_t pop_n(ValueType* out, size_t n) {
+    if (n == 0) {
+      return 0;
+    }
+    size_t count = 0;
+    info_->cwait.wait([&](){ count = try_pop_items(out, n); return count > 0; }, true);
+    info_->pwait.notify((int)(count < (size_t)INT_MAX ? count : INT_MAX), true);
+    return count;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_pop_n()
+   */
+  size_t try_pop_n(ValueType* out, size_t n) {
+    size_t count = try_pop_items(out, n);
+    if (count > 0) {
+      info_->pwait.notify((int)(count < (size_t)INT_MAX ? count : INT_MAX), true);
+    }
+    return count;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_pop_all()
+   */
+  size_t try_pop_all(std::vector<ValueType>& out) {
+    size_t offset = out.size();
+    out.resize(offset+size());
+    size_t count = try_pop_items(out.data()+offset, out.size()-offset);
+    out.resize(offset+count);
+    if (count > 0) {
+      info_->pwait.notify((int)(count < (size_t)INT_MAX ? count : INT_MAX), true);
+    }
+    return count;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::size()
+   */
+  size_t size() {
+    size_t cidx = info_->cidx.load(std::memory_order_acquire);
+    size_t pidx = info_->pidx.load(std::memory_order_acquire);
+    if (pidx < cidx) {
+      return 0;  // consumer index moved in between loads
+    }
+    return pidx - cidx;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::empty()
+   */
+  bool empty() {
+    return size() == 0;
+  }
+
+  /**
+   * @brief Maximum number of items that can be stored in the fifo without blocking
+   * @return capacity of fifo
+   */
+  size_t capacity() const {
+    return mask_+1;
+  }
+
+  bool unlink() {
+    return memory_.unlink();
+  }
+
+  /**
+   * @copydoc cpen333::process::named_resource::unlink(const std::string&)
+   */
+  static bool unlink(const std::string& name) {
+    return cpen333::process::shared_memory::unlink(name + std::string(FIFO_LOCKFREE_SUFFIX));
+  }
+
+ private:
+
+  static size_t round_up(size_t size) {
+    size_t capacity = 1;
+    while (capacity < size) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  // claims the next free slot and copies the item in, returns false if the fifo is full
+  bool try_push_item(const ValueType& val) {
+    size_t pos = info_->pidx.load(std::memory_order_relaxed);
+    for (;;) {
+      cell& c = cells_[pos & mask_];
+      size_t seq = c.seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (info_->pidx.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+          c.value = val;
+          c.seq.store(pos+1, std::memory_order_release);  // publish to consumers
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // slot still holds item from previous lap: full
+      } else {
+        pos = info_->pidx.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // claims the next full slot and copies the item out, returns false if the fifo is empty
+  bool try_pop_item(ValueType* val) {
+    size_t pos = info_->cidx.load(std::memory_order_relaxed);
+    for (;;) {
+      cell& c = cells_[pos & mask_];
+      size_t seq = c.seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)(pos+1);
+      if (diff == 0) {
+        if (info_->cidx.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+          if (val != nullptr) {
+            *val = c.value;
+          }
+          c.seq.store(pos+mask_+1, std::memory_order_release);  // free for producers on next lap
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // slot not yet filled: empty
+      } else {
+        pos = info_->cidx.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool try_peek_item(ValueType* val) {
+    for (;;) {
+      size_t pos = info_->cidx.load(std::memory_order_acquire);
+      cell& c = cells_[pos & mask_];
+      if (c.seq.load(std::memory_order_acquire) != pos+1) {
+        if (info_->cidx.load(std::memory_order_acquire) != pos) {
+          continue;  // popped in between, look at the new head
+        }
+        return false;
+      }
+      // copy, then check the slot was not popped (and possibly refilled) while we were copying it
+      typename std::aligned_storage<sizeof(ValueType), alignof(ValueType)>::type copy;
+      std::memcpy(&copy, &c.value, sizeof(ValueType));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (c.seq.load(std::memory_order_relaxed) == pos+1) {
+        if (val != nullptr) {
+          std::memcpy(val, &copy, sizeof(ValueType));
+        }
+        return true;
+      }
+    }
+  }
+
+  size_t try_push_items(const ValueType* vals, size_t n) {
+    size_t count = 0;
+    while (count < n && try_push_item(vals[count])) {
+      ++count;
+    }
+    return count;
+  }
+
+  size_t try_pop_items(ValueType* vals, size_t n) {
+    size_t count = 0;
+    while (count < n && try_pop_item(vals == nullptr ? nullptr : &vals[count])) {
+      ++count;
+    }
+    return count;
+  }
+
+  struct cell {
+    std::atomic<size_t> seq;  // lap sequence number
+    ValueType value;          // item
+  };
+
+  struct fifo_info {
+    std::atomic<uint32_t> initialized;           // magic initialized marker
+    uint32_t layout;                             // layout version
+    size_t size;                                 // capacity (in counts of ValueType), power of two
+    char pad0[CPEN333_CACHE_LINE_SIZE];
+    std::atomic<size_t> pidx;                    // producer index, only ever increases
+    char pad1[CPEN333_CACHE_LINE_SIZE];
+    std::atomic<size_t> cidx;                    // consumer index, only ever increases
+    char pad2[CPEN333_CACHE_LINE_SIZE];
+    cpen333::impl::futex_eventcount pwait;       // producers waiting for a free slot
+    cpen333::impl::futex_eventcount cwait;       // consumers waiting for an item
+  };
+
+  cpen333::process::shared_memory memory_;   // actual memory
+  fifo_info* info_;                          // pointer to fifo information, at start of memory_
+  cell* cells_;                              // pointer to ring of slots, after info_ in memory
+  size_t mask_;                              // capacity-1, for wrapping indices
+
+};
+
+} // impl
+} // process
+} // cpen333
+
+// undef local macros
+#undef FIFO_LOCKFREE_SUFFIX
+#undef FIFO_LOCKFREE_INITIALIZED
+
+#endif // LINUX
+
+#endif //CPEN333_PROCESS_FIFO_LOCKFREE_H
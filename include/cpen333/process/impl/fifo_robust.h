@@ -0,0 +1,640 @@
+/**
+ * @file
+ * @brief First-in-first-out shared buffer that recovers from processes dying while using it
+ */
+#ifndef CPEN333_PROCESS_FIFO_ROBUST_H
+#define CPEN333_PROCESS_FIFO_ROBUST_H
+
+#include "../../os.h"
+
+#ifdef LINUX
+
+/**
+ * @brief Suffix for shared memory to guarantee uniqueness
+ */
+#define FIFO_ROBUST_SUFFIX "_ffr"
+/**
+ * @brief Magic number to test for shared memory initialization
+ */
+#define FIFO_ROBUST_INITIALIZED 0x88372615
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <pthread.h>
+
+#include "../../util.h"
+#include "../../impl/futex.h"
+#include "../named_resource.h"
+#include "../shared_memory.h"
+#include "embedded_sync.h"
+#include "shared_layout.h"
+
+namespace cpen333 {
+namespace process {
+namespace impl {
+
+/**
+ * @brief Multi-process first-in-first-out queue that keeps working when a producer or consumer dies
+ *
+ * Producers and consumers are each serialized by a robust, process-shared pthread mutex stored in the fifo's
+ * shared memory segment.  If a process dies while holding one of them, the kernel hands the lock to the next
+ * process with an "owner died" notice instead of leaving it locked forever, and the fifo repairs its state before
+ * carrying on.
+ *
+ * There are no separate semaphore counts to get out of step: the number of items is always the difference between
+ * the producer and consumer indices, and each index is only advanced, in a single store, after the item has been
+ * completely copied in or out.  A producer that dies mid-push therefore leaves no trace, and an item whose consumer
+ * dies mid-pop stays in the fifo for the next consumer.  Only the lock holder ever sleeps waiting for room or for
+ * an item, so on recovery any sleeper registered by the dead owner is discarded too.
+ *
+ * If a lock cannot be recovered (e.g. a previous recovery was interrupted, leaving it `ENOTRECOVERABLE`), the
+ * blocking operations throw a std::system_error, and the try variants return as if they had timed out.
+ *
+ * Same interface as cpen333::process::fifo, plus recoveries().  Only available on Linux.
+ *
+ * @tparam ValueType type of data to store in the queue
+ */
+template<typename ValueType>
+class fifo_robust : public virtual named_resource {
+
+ public:
+  /**
+   * @brief data type stored in buffer
+   */
+  typedef ValueType value_type;
+
+  /**
+   * @brief Creates or connects to an existing named fifo
+   * @param name name identifier for creating or connecting to an existing inter-process fifo
+   * @param size if creating, the maximum number of elements that can be stored in the queue without blocking
+   */
+  fifo_robust(const std::string& name, size_t size = 1024) :
+      memory_(name + std::string(FIFO_ROBUST_SUFFIX), sizeof(fifo_info)+size*sizeof(ValueType)),
+      info_(nullptr), data_(nullptr) {
+
+    // info is at start of memory block, followed by the actual data in the fifo
+    info_ = (fifo_info*)memory_.get();
+    data_ = (ValueType*)memory_.get(sizeof(fifo_info));
+
+    bool initialized = initialize_once(info_->initialized, FIFO_ROBUST_INITIALIZED, [&](){
+      info_->layout = CPEN333_PROCESS_LAYOUT_VERSION;
+      info_->size = size;
+      info_->pidx.store(0, std::memory_order_relaxed);
+      info_->cidx.store(0, std::memory_order_relaxed);
+      info_->recoveries.store(0, std::memory_order_relaxed);
+      init_mutex(&info_->pmutex);
+      init_mutex(&info_->cmutex);
+      info_->not_full.init();
+      info_->not_empty.init();
+    });
+    if (!initialized) {
+      check_layout(info_->layout, name);
+    }
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::push()
+   */
+  void push(const ValueType &val) {
+    push_n(&val, 1);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_push()
+   */
+  bool try_push(const ValueType &val) {
+    return try_push_n(&val, 1) == 1;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_push_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_push_for(const ValueType& val, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_push_until(val, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_push_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_push_until(const ValueType& val, const std::chrono::time_point<Clock,Duration>& timeout) {
+    timespec ts = cpen333::impl::monotonic_timespec(timeout);
+    if (!lock_producer_until(ts)) {
+      return false;
+    }
+    bool room = info_->not_full.wait_until(ts, [&](){ return free_slots() > 0; }, true);
+    if (room) {
+      write_items(&val, 1);
+    }
+    unlock(&info_->pmutex);
+    if (room) {
+      info_->not_empty.notify_one(true);
+    }
+    return room;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::pop(ValueType*)
+   */
+  void pop(ValueType* out) {
+    pop_n(out, 1);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::pop()
+   */
+  ValueType pop() {
+    ValueType out;
+    pop(&out);
+    return out;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_pop()
+   */
+  bool try_pop(ValueType* out) {
+    return try_pop_n(out, 1) == 1;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_pop_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_pop_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_pop_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_pop_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_pop_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    timespec ts = cpen333::impl::monotonic_timespec(timeout);
+    if (!lock_consumer_until(ts)) {
+      return false;
+    }
+    bool available = info_->not_empty.wait_until(ts, [&](){ return items() > 0; }, true);
+    if (available) {
+      read_items(out, 1, true);
+    }
+    unlock(&info_->cmutex);
+    if (available) {
+      info_->not_full.notify_one(true);
+    }
+    return available;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::peek(ValueType*)
+   */
+  void peek(ValueType* out) {
+    lock_consumer();
+    info_->not_empty.wait([&](){ return items() > 0; }, true);
+    read_items(out, 1, false);
+    unlock(&info_->cmutex);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::peek()
+   */
+  ValueType peek() {
+    ValueType out;
+    peek(&out);
+    return out;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_peek()
+   */
+  bool try_peek(ValueType* out) {
+    if (!try_lock(&info_->cmutex)) {
+      return false;
+    }
+    bool available = items() > 0;
+    if (available) {
+      read_items(out, 1, false);
+    }
+    unlock(&info_->cmutex);
+    return available;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_peek_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_peek_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_peek_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_peek_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_peek_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    timespec ts = cpen333::impl::monotonic_timespec(timeout);
+    if (!lock_consumer_until(ts)) {
+      return false;
+    }
+    bool available = info_->not_empty.wait_until(ts, [&](){ return items() > 0; }, true);
+    if (available) {
+      read_items(out, 1, false);
+    }
+    unlock(&info_->cmutex);
+    return available;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::push_n()
+   */
+  void push_n(const ValueType* vals, size_t n) {
+    while (n > 0) {
+      lock_producer();
+      info_->not_full.wait([&](){ return free_slots() > 0; }, true);
+      size_t count = free_slots();
+      if (count > n) {
+        count = n;
+      }
+      write_items(vals, count);
+      unlock(&info_->pmutex);
+      info_->not_empty.notify((int)(count < (size_t)INT_MAX ? count : INT_MAX), true);
+      vals += count;
+      n -= count;
+    }
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_push_n()
+   */
+  size_t try_push_n(const ValueType* vals, size_t n) {
+    if (!try_lock(&info_->pmutex)) {
+      return 0;
+    }
+    size_t count = free_slots();
+    if (count > n) {
+      count = n;
+    }
+    write_items(vals, count);
+    unlock(&info_->pmutex);
+    if (count > 0) {
+      info_->not_empty.notify((int)(count < (size_t)INT_MAX ? count : INT_MAX), true);
+    }
+    return count;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::pop_n()
+   */
+  size_t pop_n(ValueType* out, size_t n) {
+    if (n == 0) {
+      return 0;
+    }
+    lock_consumer();
+    info_->not_empty.wait([&](){ return items() > 0; }, true);
+    size_t count = items();
+    if (count > n) {
+      count = n;
+    }
+    read_items(out, count, true);
+    unlock(&info_->cmutex);
+    info_->not_full.notify((int)(count < (size_t)INT_MAX ? count : INT_MAX), true);
+    return count;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_pop_n()
+   */
+  size_t try_pop_n(ValueType* out, size_t n) {
+    if (!try_lock(&info_->cmutex)) {
+      return 0;
+    }
+    size_t count = items();
+    if (count > n) {
+      count = n;
+    }
+    read_items(out, count, true);
+    unlock(&info_->cmutex);
+    if (count > 0) {
+      info_->not_full.notify((int)(count < (size_t)INT_MAX ? count : INT_MAX), true);
+    }
+    return count;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_pop_all()
+   */
+  size_t try_pop_all(std::vector<ValueType>& out) {
+    if (!try_lock(&info_->cmutex)) {
+      return 0;
+    }
+    size_t count = items();
+    size_t offset = out.size();
+    out.resize(offset+count);
+    read_items(count > 0 ? &out[offset] : nullptr, count, true);
+    unlock(&info_->cmutex);
+    if (count > 0) {
+      info_->not_full.notify((int)(count < (size_t)INT_MAX ? count : INT_MAX), true);
+    }
+    return count;
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::reserve()
+   */
+  ValueType* reserve() {
+    lock_producer();          // held until commit()
+    info_->not_full.wait([&](){ return free_slots() > 0; }, true);
+    return &data_[info_->pidx.load(std::memory_order_relaxed) % info_->size];
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_reserve()
+   */
+  ValueType* try_reserve() {
+    if (!try_lock(&info_->pmutex)) {
+      return nullptr;
+    }
+    if (free_slots() == 0) {
+      unlock(&info_->pmutex);
+      return nullptr;
+    }
+    return &data_[info_->pidx.load(std::memory_order_relaxed) % info_->size];
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_reserve_for()
+   */
+  template <typename Rep, typename Period>
+  ValueType* try_reserve_for(const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_reserve_until(std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_reserve_until()
+   */
+  template<typename Clock, typename Duration>
+  ValueType* try_reserve_until(const std::chrono::time_point<Clock,Duration>& timeout) {
+    timespec ts = cpen333::impl::monotonic_timespec(timeout);
+    if (!lock_producer_until(ts)) {
+      return nullptr;
+    }
+    if (!info_->not_full.wait_until(ts, [&](){ return free_slots() > 0; }, true)) {
+      unlock(&info_->pmutex);
+      return nullptr;
+    }
+    return &data_[info_->pidx.load(std::memory_order_relaxed) % info_->size];
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::commit()
+   */
+  void commit() {
+    info_->pidx.fetch_add(1, std::memory_order_release);
+    unlock(&info_->pmutex);
+    info_->not_empty.notify_one(true);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::lease()
+   */
+  const ValueType* lease() {
+    lock_consumer();          // held until release()
+    info_->not_empty.wait([&](){ return items() > 0; }, true);
+    return &data_[info_->cidx.load(std::memory_order_relaxed) % info_->size];
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_lease()
+   */
+  const ValueType* try_lease() {
+    if (!try_lock(&info_->cmutex)) {
+      return nullptr;
+    }
+    if (items() == 0) {
+      unlock(&info_->cmutex);
+      return nullptr;
+    }
+    return &data_[info_->cidx.load(std::memory_order_relaxed) % info_->size];
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_lease_for()
+   */
+  template <typename Rep, typename Period>
+  const ValueType* try_lease_for(const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_lease_until(std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::try_lease_until()
+   */
+  template<typename Clock, typename Duration>
+  const ValueType* try_lease_until(const std::chrono::time_point<Clock,Duration>& timeout) {
+    timespec ts = cpen333::impl::monotonic_timespec(timeout);
+    if (!lock_consumer_until(ts)) {
+      return nullptr;
+    }
+    if (!info_->not_empty.wait_until(ts, [&](){ return items() > 0; }, true)) {
+      unlock(&info_->cmutex);
+      return nullptr;
+    }
+    return &data_[info_->cidx.load(std::memory_order_relaxed) % info_->size];
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::release()
+   */
+  void release() {
+    info_->cidx.fetch_add(1, std::memory_order_release);
+    unlock(&info_->cmutex);
+    info_->not_full.notify_one(true);
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::size()
+   */
+  size_t size() {
+    return items();
+  }
+
+  /**
+   * @copydoc cpen333::process::fifo::empty()
+   */
+  bool empty() {
+    return items() == 0;
+  }
+
+  /**
+   * @brief Number of times a lock was recovered after its owner died
+   *
+   * Counts over the lifetime of the shared fifo, across all attached processes.
+   *
+   * @return number of recoveries
+   */
+  size_t recoveries() {
+    return info_->recoveries.load(std::memory_order_relaxed);
+  }
+
+  bool unlink() {
+    return memory_.unlink();
+  }
+
+  /**
+   * @copydoc cpen333::process::named_resource::unlink(const std::string&)
+   */
+  static bool unlink(const std::string& name) {
+    return cpen333::process::shared_memory::unlink(name + std::string(FIFO_ROBUST_SUFFIX));
+  }
+
+ private:
+
+  static void init_mutex(pthread_mutex_t* mutex) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+  }
+
+  // completes a lock operation, repairing shared state if the previous owner died
+  bool locked(pthread_mutex_t* mutex, cpen333::impl::futex_eventcount& waitq, int status) {
+    if (status == EOWNERDEAD) {
+      // only the lock holder ever sleeps on this side's wait queue, so any registered waiter is the dead owner;
+      // indices only advance after a complete copy, so they need no repair
+      waitq.waiters.store(0, std::memory_order_relaxed);
+      info_->recoveries.fetch_add(1, std::memory_order_relaxed);
+      pthread_mutex_consistent(mutex);
+      return true;
+    } else if (status != 0) {
+      if (status != ETIMEDOUT && status != EBUSY) {
+        errno = status;
+        cpen333::perror(std::string("Failed to lock fifo ") + memory_.name());
+      }
+      return false;
+    }
+    return true;
+  }
+
+  // locks with a CLOCK_MONOTONIC deadline, returning the pthread status
+  static int lock_until(pthread_mutex_t* mutex, const timespec& ts) {
+#ifdef CPEN333_HAS_CLOCKWAIT
+    return pthread_mutex_clocklock(mutex, CLOCK_MONOTONIC, &ts);
+#else
+    // older C libraries only take realtime deadlines, so translate the remaining time
+    timespec now, rts;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    clock_gettime(CLOCK_REALTIME, &rts);
+    long long nsec = (long long)(ts.tv_sec - now.tv_sec)*1000000000LL + (ts.tv_nsec - now.tv_nsec);
+    if (nsec < 0) {
+      nsec = 0;
+    }
+    nsec += rts.tv_nsec;
+    rts.tv_sec += (time_t)(nsec / 1000000000LL);
+    rts.tv_nsec = (long)(nsec % 1000000000LL);
+    return pthread_mutex_timedlock(mutex, &rts);
+#endif
+  }
+
+  // blocking operations cannot report failure, so throw rather than touch the indices without the lock
+  void lock(pthread_mutex_t* mutex, cpen333::impl::futex_eventcount& waitq) {
+    int status = pthread_mutex_lock(mutex);
+    if (!locked(mutex, waitq, status)) {
+      throw std::system_error(status, std::generic_category(), std::string("Failed to lock fifo ") + memory_.name());
+    }
+  }
+
+  void lock_producer() {
+    lock(&info_->pmutex, info_->not_full);
+  }
+
+  void lock_consumer() {
+    lock(&info_->cmutex, info_->not_empty);
+  }
+
+  bool lock_producer_until(const timespec& ts) {
+    return locked(&info_->pmutex, info_->not_full, lock_until(&info_->pmutex, ts));
+  }
+
+  bool lock_consumer_until(const timespec& ts) {
+    return locked(&info_->cmutex, info_->not_empty, lock_until(&info_->cmutex, ts));
+  }
+
+  bool try_lock(pthread_mutex_t* mutex) {
+    cpen333::impl::futex_eventcount& waitq = (mutex == &info_->pmutex) ? info_->not_full : info_->not_empty;
+    return locked(mutex, waitq, pthread_mutex_trylock(mutex));
+  }
+
+  static void unlock(pthread_mutex_t* mutex) {
+    pthread_mutex_unlock(mutex);
+  }
+
+  size_t items() {
+    return info_->pidx.load(std::memory_order_acquire) - info_->cidx.load(std::memory_order_acquire);
+  }
+
+  size_t free_slots() {
+    return info_->size - items();
+  }
+
+  // called with the producer lock held, publishes the items in one step after they are all copied
+  void write_items(const ValueType* vals, size_t n) {
+    size_t idx = info_->pidx.load(std::memory_order_relaxed);
+    for (size_t i=0; i<n; ++i) {
+      data_[(idx+i) % info_->size] = vals[i];
+    }
+    info_->pidx.store(idx+n, std::memory_order_release);
+  }
+
+  // called with the consumer lock held, frees the slots in one step after they are all copied
+  void read_items(ValueType* vals, size_t n, bool remove) {
+    size_t idx = info_->cidx.load(std::memory_order_relaxed);
+    if (vals != nullptr) {
+      for (size_t i=0; i<n; ++i) {
+        vals[i] = data_[(idx+i) % info_->size];
+      }
+    }
+    if (remove) {
+      info_->cidx.store(idx+n, std::memory_order_release);
+    }
+  }
+
+  struct fifo_info {
+    std::atomic<uint32_t> initialized;            // magic initialized marker
+    uint32_t layout;                              // layout version
+    size_t size;                                  // size (in counts of ValueType)
+    std::atomic<size_t> recoveries;               // locks recovered from dead owners
+    char pad0[CPEN333_CACHE_LINE_SIZE];
+    std::atomic<size_t> pidx;                     // producer index, only ever increases
+    pthread_mutex_t pmutex;                       // robust lock serializing producers
+    cpen333::impl::futex_eventcount not_full;     // producer waiting for room
+    char pad1[CPEN333_CACHE_LINE_SIZE];
+    std::atomic<size_t> cidx;                     // consumer index, only ever increases
+    pthread_mutex_t cmutex;                       // robust lock serializing consumers
+    cpen333::impl::futex_eventcount not_empty;    // consumer waiting for an item
+    char pad2[CPEN333_CACHE_LINE_SIZE];
+  };
+
+  cpen333::process::shared_memory memory_;   // actual memory
+  fifo_info* info_;                          // pointer to fifo information, at start of memory_
+  ValueType* data_;                          // pointer to data in fifo, after info_ in memory
+
+};
+
+} // impl
+} // process
+} // cpen333
+
+// undef local macros
+#undef FIFO_ROBUST_SUFFIX
+#undef FIFO_ROBUST_INITIALIZED
+
+#endif // LINUX
+
+#endif //CPEN333_PROCESS_FIFO_ROBUST_H
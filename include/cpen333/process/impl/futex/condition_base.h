@@ -0,0 +1,302 @@
+/**
+ * @file
+ * @brief Linux implementation of the base class for condition, condition_variable, and event classes
+ *
+ * Uses a sequence counter and futex in a named shared memory block.
+ */
+#ifndef CPEN333_PROCESS_CONDITION_BASE_FUTEX_H
+#define CPEN333_PROCESS_CONDITION_BASE_FUTEX_H
+
+/**
+ * @brief Suffix to append to shared storage identifier for uniqueness
+ */
+#define CONDITION_BASE_FUTEX_SUFFIX "_cbf"
+
+/**
+ * @brief Magic number for testing initialization
+ */
+#define CONDITION_BASE_FUTEX_INITIALIZED 0x09812313
+
+/**
+ * @brief Longest mutex name that is recorded for handing waiters to the mutex
+ */
+#define CONDITION_BASE_FUTEX_MAX_NAME 255
+
+#include <string>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#include "../../../impl/futex.h"
+#include "../../named_resource.h"
+#include "../../mutex.h"
+#include "../../shared_memory.h"
+#include "../embedded_sync.h"
+#include "../shared_layout.h"
+
+namespace cpen333 {
+namespace process {
+namespace futex {
+
+/**
+ * @brief Base-class for conditions, condition variables, and events
+ *
+ * Like an event, has the ability to wait for ownership of a lock, and for notifying waiting threads.  This
+ * condition base DOES NOT suffer from spurious wake-ups: each notify_one() lets exactly one thread through that was
+ * waiting at the time, and notify_all() lets through every thread that was waiting at the time.
+ *
+ * All state lives in one small shared memory block: a few counts protected by an embedded lock, and a sequence
+ * word that waiters sleep on.  Waking a single waiter takes one futex call.  Rather than waking every waiter only
+ * for all but one to go back to sleep on the external mutex, notify_all() wakes one and moves the rest directly
+ * onto the mutex's futex, so they are released one at a time as the mutex is handed on.  For this, the block
+ * records the name of the mutex waiters are using so that the notifying process can attach to it.
+ */
+class condition_base : public virtual named_resource {
+
+ public:
+  /**
+   * @brief Constructor
+   * @param name unique identifier
+   */
+  condition_base(const std::string &name) :
+      waiters_(name + std::string(CONDITION_BASE_FUTEX_SUFFIX)), target_mutex_(), target_name_(), target_() {
+    bool initialized = impl::initialize_once(waiters_->initialized, CONDITION_BASE_FUTEX_INITIALIZED, [&](){
+      waiters_->layout = CPEN333_PROCESS_LAYOUT_VERSION;   // remaining fields start zeroed
+    });
+    if (!initialized) {
+      impl::check_layout(waiters_->layout, name);
+    }
+  }
+
+ private:
+  // disable copy/move constructors
+  condition_base(const condition_base&) DELETE_METHOD;
+  condition_base(condition_base&&) DELETE_METHOD;
+  condition_base& operator=(const condition_base&) DELETE_METHOD;
+  condition_base& operator=(condition_base&&) DELETE_METHOD;
+
+ public:
+
+  /**
+   * @brief Wait until the thread is notified
+   * @param lock external lock
+   */
+  void wait(std::unique_lock<cpen333::process::mutex>& lock) {
+    wait(lock, false, std::chrono::steady_clock::now());
+  }
+
+  /**
+   * @brief Wait until the thread is notified, or until a timeout period has elapsed
+   * @tparam Rep duration clock representation
+   * @tparam Period duration clock period
+   * @param lock external lock
+   * @param rel_time relative time to wait
+   * @return true if successful, false iftimeout has occured
+   */
+  template<class Rep, class Period>
+  bool wait_for( std::unique_lock<cpen333::process::mutex>& lock,
+                 const std::chrono::duration<Rep, Period>& rel_time) {
+    return wait(lock, true, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @brief Wait until the thread is notified, or until a timeout time has been reached
+   * @tparam Clock timeout clock representation
+   * @tparam Duration timeout duration
+   * @param lock external lock
+   * @param timeout_time absolute timeout time
+   * @return true if wait is successful, false if timeout has been reached
+   */
+  template<class Clock, class Duration >
+  bool wait_until( std::unique_lock<cpen333::process::mutex>& lock,
+                   const std::chrono::time_point<Clock, Duration>& timeout_time ) {
+    return wait(lock, true, timeout_time);
+  }
+
+  /**
+   * @brief Notify one waiting thread
+   *
+   * Wake up a single waiting thread and notify them of a potential change
+   */
+  void notify_one() {
+    notify(false);
+  }
+
+  /**
+   * @brief Notify all waiting threads
+   *
+   * Wake up all waiting threads and notify them of a potential change
+   */
+  void notify_all() {
+    notify(true);
+  }
+
+  virtual bool unlink() {
+    return waiters_.unlink();
+  }
+
+  /**
+  * @copydoc cpen333::process::named_resource::unlink(const std::string&)
+  */
+  static bool unlink(const std::string& name) {
+    return cpen333::process::shared_object<shared_data>::unlink(name + std::string(CONDITION_BASE_FUTEX_SUFFIX));
+  }
+
+ protected:
+
+  /**
+   * @brief Notify (wake-up) waiting threads
+   * @param broadcast if true, wakes up all threads
+   */
+  void notify(bool broadcast) {
+    uint32_t seq;
+    char name[CONDITION_BASE_FUTEX_MAX_NAME+1];
+    {
+      std::lock_guard<impl::embedded_mutex> guard(waiters_->guard);
+      if (waiters_->blocked == 0) {
+        return;
+      }
+      if (broadcast) {
+        waiters_->signals += waiters_->blocked;
+        waiters_->blocked = 0;
+        std::memcpy(name, waiters_->mutex_name, sizeof(name));
+      } else {
+        ++(waiters_->signals);
+        --(waiters_->blocked);
+      }
+      ++(waiters_->generation);   // only threads already waiting may take the signals
+      seq = waiters_->seq.fetch_add(1, std::memory_order_relaxed)+1;
+    }
+
+    if (!broadcast) {
+      cpen333::impl::futex_wake(&waiters_->seq, 1, true);
+      return;
+    }
+
+    // wake one and move the rest onto the mutex, unless a new waiter has arrived (changing seq) and might be moved
+    // along with them
+    impl::embedded_mutex* target = requeue_target(name);
+    if (target != nullptr
+        && cpen333::impl::futex_cmp_requeue(&waiters_->seq, seq, 1, INT_MAX, &target->state, true)) {
+      target->wake_moved();
+    } else {
+      cpen333::impl::futex_wake(&waiters_->seq, INT_MAX, true);
+    }
+  }
+
+  /**
+   * @brief Waits for condition to be notified
+   * @tparam Clock clock type
+   * @tparam Duration duration type
+   * @param lock external lock to ensure no simultaneous waits/notifies
+   * @param timeout whether or not to wait with a timeout
+   * @param abs_time absolute timeout time
+   * @return true if wait was successful, false if timeout occurred
+   */
+  template<class Clock, class Duration>
+  bool wait(std::unique_lock<cpen333::process::mutex>& lock,
+            bool timeout, const std::chrono::time_point<Clock, Duration>& abs_time) {
+
+    timespec ts = cpen333::impl::monotonic_timespec(abs_time);
+    cpen333::process::mutex* external = lock.mutex();
+    uint32_t generation;
+    uint32_t seq;
+    {
+      std::lock_guard<impl::embedded_mutex> guard(waiters_->guard);
+      record_mutex(external->name());
+      generation = waiters_->generation;
+      ++(waiters_->blocked);
+      seq = waiters_->seq.fetch_add(1, std::memory_order_relaxed)+1;  // stops an in-flight notify_all moving us
+    }
+    lock.unlock();
+
+    bool signalled = false;
+    for (;;) {
+      bool woken = true;
+      if (timeout) {
+        woken = cpen333::impl::futex_wait_until(&waiters_->seq, seq, ts, true);
+      } else {
+        cpen333::impl::futex_wait(&waiters_->seq, seq, true);
+      }
+
+      std::lock_guard<impl::embedded_mutex> guard(waiters_->guard);
+      if (waiters_->signals > 0 && waiters_->generation != generation) {
+        --(waiters_->signals);
+        signalled = true;
+        break;
+      } else if (!woken) {
+        --(waiters_->blocked);
+        break;
+      } else if (waiters_->signals > 0) {
+        // woken in place of a thread that was waiting before us, pass it on
+        cpen333::impl::futex_wake(&waiters_->seq, 1, true);
+      }
+      seq = waiters_->seq.load(std::memory_order_relaxed);
+    }
+
+    // we may have been moved onto the mutex along with others, so keep it marked as having sleepers
+    external->lock_contended();
+    lock = std::unique_lock<cpen333::process::mutex>(*external, std::adopt_lock);
+    return signalled;
+  }
+
+ private:
+
+  // records the external mutex's name so a notifier can find it, called with the guard held
+  void record_mutex(const std::string& name) {
+    if (name.size() > CONDITION_BASE_FUTEX_MAX_NAME) {
+      waiters_->mutex_name[0] = 0;  // too long, notify_all will fall back to waking everyone
+    } else if (std::strncmp(waiters_->mutex_name, name.c_str(), sizeof(waiters_->mutex_name)) != 0) {
+      std::memcpy(waiters_->mutex_name, name.c_str(), name.size()+1);
+    }
+  }
+
+  // attaches to the mutex waiters are using, caching it for later notifications
+  impl::embedded_mutex* requeue_target(const char* name) {
+    if (name[0] == 0) {
+      return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(target_mutex_);
+    if (!target_ || target_name_ != name) {
+      target_name_ = name;
+      target_.reset(new cpen333::process::shared_object<impl::embedded_mutex>(target_name_));
+    }
+    return target_->get();
+  }
+
+  struct shared_data {
+    std::atomic<uint32_t> initialized;        // magic initialized number
+    uint32_t layout;                          // layout version
+    impl::embedded_mutex guard;               // protects the counts below
+    cpen333::impl::futex_word seq;            // changed by every wait and notify, waiters sleep on it
+    uint32_t generation;                      // incremented by every notify that lets waiters through
+    uint32_t blocked;                         // number of waiters not yet let through
+    uint32_t signals;                         // number of waiters let through that have not yet left
+    char mutex_name[CONDITION_BASE_FUTEX_MAX_NAME+1];  // name of external mutex used by waiters
+  };
+
+  cpen333::process::shared_object<shared_data> waiters_;
+  std::mutex target_mutex_;                   // protects the cached requeue target
+  std::string target_name_;                   // name of the cached requeue target
+  std::unique_ptr<cpen333::process::shared_object<impl::embedded_mutex>> target_;  // external mutex, attached
+
+};
+
+} // futex
+
+/**
+ * @brief Alias to the futex implementation of the condition base
+ */
+using condition_base = futex::condition_base;
+
+} // process
+} // cpen333
+
+// undefine local macros
+#undef CONDITION_BASE_FUTEX_SUFFIX
+#undef CONDITION_BASE_FUTEX_INITIALIZED
+#undef CONDITION_BASE_FUTEX_MAX_NAME
+
+#endif //CPEN333_PROCESS_CONDITION_BASE_FUTEX_H
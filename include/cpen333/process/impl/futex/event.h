@@ -0,0 +1,337 @@
+/**
+ * @file
+ * @brief Linux implementation of the event synchronization primitive
+ *
+ * Uses a single futex word in a named shared memory block.
+ */
+#ifndef CPEN333_PROCESS_EVENT_FUTEX_H
+#define CPEN333_PROCESS_EVENT_FUTEX_H
+
+/**
+ * @brief Suffix to append to event names for uniqueness
+ */
+#define EVENT_FUTEX_SUFFIX "_evf"
+
+/**
+ * @brief Magic number for testing initialization
+ */
+#define EVENT_FUTEX_INITIALIZED 0x33829115
+
+/**
+ * @brief Bits of the state word counting waiting threads
+ */
+#define EVENT_FUTEX_WAITERS_MASK 0x000003FFu
+
+/**
+ * @brief One token, bits of the state word counting waiters released by notify_one() that have not yet left
+ */
+#define EVENT_FUTEX_TOKEN 0x00000400u
+/**
+ * @brief Bits of the state word counting tokens
+ */
+#define EVENT_FUTEX_TOKENS_MASK 0x000FFC00u
+/**
+ * @brief Shift of the token count in the state word
+ */
+#define EVENT_FUTEX_TOKENS_SHIFT 10
+
+/**
+ * @brief Bit of the state word that is set while the event is latched
+ */
+#define EVENT_FUTEX_LATCHED 0x00100000u
+
+/**
+ * @brief Shift of the generation in the state word, incremented whenever all waiters are released
+ */
+#define EVENT_FUTEX_GENERATION_SHIFT 21
+
+#include <string>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+
+#include "../../../impl/futex.h"
+#include "../../event.h"
+#include "../../named_resource.h"
+#include "../../shared_memory.h"
+#include "../embedded_sync.h"
+#include "../shared_layout.h"
+
+namespace cpen333 {
+namespace process {
+namespace futex {
+
+/**
+ * @brief Event primitive, acting like a turnstile that can optionally be latched open
+ *
+ * The entire state of the event is one futex word in a small named shared memory block: the number of waiters, the
+ * number of them released by notify_one() that have not yet left, whether the event is latched, and a generation
+ * that advances each time all waiters are released.  Every operation is a compare-and-swap on that word, plus a
+ * single wake call if and only if someone is waiting, so releasing all waiters costs one system call no matter how
+ * many processes are waiting.
+ *
+ * At most 1023 threads may wait at once; further arrivals block until there is room.  A waiter must be rescheduled
+ * before 2048 further releases of all waiters (while others keep arriving) to notice its own release.
+ */
+class event : public virtual named_resource {
+ public:
+
+  /**
+   * @brief Creates or connects to a named event
+   * @param name name identifier for creating or connecting to an existing inter-process event
+   * @param mode if creating, whether set() latches the event until reset() or only for a single waiter
+   */
+  event(const std::string &name, event_mode mode = event_mode::manual_reset) :
+      storage_(name + std::string(EVENT_FUTEX_SUFFIX)) {
+    bool initialized = impl::initialize_once(storage_->initialized, EVENT_FUTEX_INITIALIZED, [&](){
+      storage_->layout = CPEN333_PROCESS_LAYOUT_VERSION;
+      storage_->mode = (uint32_t)mode;
+      storage_->state.store(0, std::memory_order_relaxed);
+    });
+    if (!initialized) {
+      impl::check_layout(storage_->layout, name);
+    }
+  }
+
+ private:
+  event(const event&) DELETE_METHOD;
+  event(event&&) DELETE_METHOD;
+  event& operator=(const event&) DELETE_METHOD;
+  event& operator=(event&&) DELETE_METHOD;
+
+ public:
+
+  /**
+   * @brief Waits for the event to be triggered
+   *
+   * Returns immediately if the event is latched, consuming the latch if it is an auto-reset event.  Otherwise blocks
+   * until `notify_all()` or `set()` is called, or `notify_one()` and this thread happens to be the one let through.
+   * This event will <em>not</em> exhibit spurious wake-ups.
+   */
+  void wait() {
+    wait(false, timespec{});
+  }
+
+  /**
+   * @brief Waits for the event to be triggered or for a timeout period to elapse
+   * @tparam Rep timeout duration representation
+   * @tparam Period timeout clock period
+   * @param rel_time maximum relative time to wait for the event
+   * @return `true` if event is triggered, `false` if timeout has elapsed without event being triggered
+   */
+  template<class Rep, class Period>
+  bool wait_for(const std::chrono::duration<Rep, Period>& rel_time) {
+    return wait_until(std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @brief Waits for the event to be triggered or for a time-point to be reached
+   * @tparam Clock clock type
+   * @tparam Duration clock duration type
+   * @param timeout_time absolute timeout time
+   * @return `true` if event is triggered, `false` if timeout time has been reached without event
+   */
+  template< class Clock, class Duration >
+  bool wait_until( const std::chrono::time_point<Clock, Duration>& timeout_time ) {
+    return wait(true, cpen333::impl::monotonic_timespec(timeout_time));
+  }
+
+  /**
+   * @brief Lets a single waiting thread through, if any
+   *
+   * Does not latch the event.  Note that the choice of thread is up to the underlying system.
+   */
+  void notify_one() {
+    uint32_t s = storage_->state.load(std::memory_order_relaxed);
+    do {
+      if (waiters(s) <= tokens(s)) {
+        return;  // everyone waiting has already been let through
+      }
+    } while (!storage_->state.compare_exchange_weak(s, s + EVENT_FUTEX_TOKEN, std::memory_order_release,
+                                                    std::memory_order_relaxed));
+    cpen333::impl::futex_wake(&storage_->state, 1, true);
+  }
+
+  /**
+   * @brief Lets all currently waiting threads through
+   *
+   * Does not latch the event.
+   */
+  void notify_all() {
+    release_all(false);
+  }
+
+  /**
+   * @brief Triggers the event
+   *
+   * For a manual-reset event, lets all waiting threads through and latches the event so that later waits return
+   * immediately until reset().  For an auto-reset event, lets a single waiting thread through, or if none are
+   * waiting, latches the event for the next thread to wait.
+   */
+  void set() {
+    if (mode() == event_mode::manual_reset) {
+      release_all(true);
+      return;
+    }
+
+    // auto-reset, let one waiter through, or latch for the next to arrive
+    uint32_t s = storage_->state.load(std::memory_order_relaxed);
+    uint32_t next;
+    do {
+      next = waiters(s) > tokens(s) ? s + EVENT_FUTEX_TOKEN : s | EVENT_FUTEX_LATCHED;
+    } while (!storage_->state.compare_exchange_weak(s, next, std::memory_order_release, std::memory_order_relaxed));
+    if ((next & EVENT_FUTEX_LATCHED) == 0) {
+      cpen333::impl::futex_wake(&storage_->state, 1, true);
+    }
+  }
+
+  /**
+   * @brief Clears the latch set by set()
+   */
+  void reset() {
+    storage_->state.fetch_and(~EVENT_FUTEX_LATCHED, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Reset mode of the event, fixed when it was created
+   * @return event mode
+   */
+  event_mode mode() {
+    return (event_mode)storage_->mode;
+  }
+
+  virtual bool unlink() {
+    return storage_.unlink();
+  }
+
+  /**
+   * @copydoc cpen333::process::named_resource::unlink(const std::string&)
+   */
+  static bool unlink(const std::string& name) {
+    return cpen333::process::shared_object<shared_data>::unlink(name + std::string(EVENT_FUTEX_SUFFIX));
+  }
+
+ private:
+
+  static uint32_t waiters(uint32_t s) {
+    return s & EVENT_FUTEX_WAITERS_MASK;
+  }
+
+  static uint32_t tokens(uint32_t s) {
+    return (s & EVENT_FUTEX_TOKENS_MASK) >> EVENT_FUTEX_TOKENS_SHIFT;
+  }
+
+  static uint32_t generation(uint32_t s) {
+    return s >> EVENT_FUTEX_GENERATION_SHIFT;
+  }
+
+  // lets every current waiter through by advancing the generation, optionally latching the event
+  void release_all(bool latch) {
+    uint32_t s = storage_->state.load(std::memory_order_relaxed);
+    uint32_t next;
+    do {
+      if (waiters(s) == 0) {
+        if (!latch || (s & EVENT_FUTEX_LATCHED) != 0) {
+          return;
+        }
+        next = s | EVENT_FUTEX_LATCHED;
+      } else {
+        next = ((generation(s) + 1) << EVENT_FUTEX_GENERATION_SHIFT) | (s & EVENT_FUTEX_LATCHED)
+            | (latch ? EVENT_FUTEX_LATCHED : 0);
+      }
+    } while (!storage_->state.compare_exchange_weak(s, next, std::memory_order_release, std::memory_order_relaxed));
+
+    if (waiters(s) > 0) {
+      cpen333::impl::futex_wake(&storage_->state, INT_MAX, true);
+    }
+  }
+
+  // returns true if let through, false on timeout
+  bool wait(bool timeout, const timespec& ts) {
+    cpen333::impl::futex_word& state = storage_->state;
+    bool automatic = mode() == event_mode::auto_reset;
+
+    // pass straight through if latched, otherwise add ourselves as a waiter
+    uint32_t s = state.load(std::memory_order_acquire);
+    for (;;) {
+      if ((s & EVENT_FUTEX_LATCHED) != 0) {
+        if (!automatic
+            || state.compare_exchange_weak(s, s & ~EVENT_FUTEX_LATCHED, std::memory_order_acquire)) {
+          return true;
+        }
+      } else if (waiters(s) == EVENT_FUTEX_WAITERS_MASK) {
+        // full, wait for a change
+        if (timeout) {
+          if (!cpen333::impl::futex_wait_until(&state, s, ts, true)) {
+            return false;
+          }
+        } else {
+          cpen333::impl::futex_wait(&state, s, true);
+        }
+        s = state.load(std::memory_order_acquire);
+      } else if (state.compare_exchange_weak(s, s + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+
+    uint32_t gen = generation(s);
+    s = s + 1;
+    for (;;) {
+      bool woken = true;
+      if (timeout) {
+        woken = cpen333::impl::futex_wait_until(&state, s, ts, true);
+      } else {
+        cpen333::impl::futex_wait(&state, s, true);
+      }
+
+      s = state.load(std::memory_order_acquire);
+      for (;;) {
+        if (generation(s) != gen) {
+          return true;   // released along with all others, no longer counted
+        } else if (tokens(s) > 0) {
+          if (state.compare_exchange_weak(s, s - EVENT_FUTEX_TOKEN - 1, std::memory_order_acquire)) {
+            return true;
+          }
+        } else if (!woken) {
+          if (state.compare_exchange_weak(s, s - 1, std::memory_order_relaxed)) {
+            return false;
+          }
+        } else {
+          break;  // nothing for us, back to sleep
+        }
+      }
+    }
+  }
+
+  struct shared_data {
+    std::atomic<uint32_t> initialized;   // magic initialized number
+    uint32_t layout;                     // layout version
+    uint32_t mode;                       // event_mode, fixed at creation
+    cpen333::impl::futex_word state;     // waiters, tokens, latched bit and generation
+  };
+
+  cpen333::process::shared_object<shared_data> storage_;
+
+};
+
+} // futex
+
+/**
+ * @brief Alias to futex implementation of inter-process event
+ */
+using event = futex::event;
+
+} // process
+} // cpen333
+
+// undef local macros
+#undef EVENT_FUTEX_SUFFIX
+#undef EVENT_FUTEX_INITIALIZED
+#undef EVENT_FUTEX_WAITERS_MASK
+#undef EVENT_FUTEX_TOKEN
+#undef EVENT_FUTEX_TOKENS_MASK
+#undef EVENT_FUTEX_TOKENS_SHIFT
+#undef EVENT_FUTEX_LATCHED
+#undef EVENT_FUTEX_GENERATION_SHIFT
+
+#endif //CPEN333_PROCESS_EVENT_FUTEX_H
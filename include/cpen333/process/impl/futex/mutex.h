@@ -0,0 +1,169 @@
+/**
+ * @file
+ * @brief Linux implementation of an inter-process named mutex
+ *
+ * Uses a futex word in a named shared memory block.
+ */
+#ifndef CPEN333_PROCESS_MUTEX_FUTEX_H
+#define CPEN333_PROCESS_MUTEX_FUTEX_H
+
+/**
+ * @brief Suffix to append to mutex names for uniqueness
+ */
+#define MUTEX_NAME_SUFFIX "_mux"
+
+#include <string>
+#include <chrono>
+
+#include "../../../util.h"
+#include "../../shared_memory.h"
+#include "../named_resource_base.h"
+#include "../embedded_sync.h"
+#ifdef CPEN333_PROFILE_LOCKS
+#include "../lock_profile.h"
+#endif
+
+namespace cpen333 {
+namespace process {
+namespace futex {
+
+/**
+ * @brief Inter-process named mutual exclusion primitive
+ *
+ * Used to limit resource access to one thread at a time
+ *
+ * The state of the mutex is a single word in a small named shared memory block, so an uncontended lock or unlock is
+ * a single atomic instruction with no library or system call.  A contended lock spins briefly on multi-core machines,
+ * then sleeps on a futex until the holder unlocks.  Like the POSIX implementation, this does NOT enforce that the
+ * same thread unlock the mutex, but it should be treated as a true mutex by using std::lock_guard or
+ * std::unique_lock.
+ *
+ * This mutex has KERNEL PERSISTENCE, meaning if not unlink()-ed, will continue to exist in its current state
+ * until the system is shut down (persisting beyond the life of the initiating program)
+ */
+class mutex : public impl::named_resource_base {
+ public:
+  /**
+   * @brief Alias to the underlying native mutex handle, a pointer to the mutex in shared memory
+   */
+  using native_handle_type = impl::embedded_mutex*;
+
+  /**
+   * @copydoc cpen333::process::posix::mutex::mutex()
+   */
+  mutex(const std::string& name) :
+    impl::named_resource_base{name + std::string(MUTEX_NAME_SUFFIX)},
+    storage_{name + std::string(MUTEX_NAME_SUFFIX)} {}  // zeroed memory is an unlocked mutex
+
+ private:
+  mutex(const mutex&) DELETE_METHOD;
+  mutex(mutex&&) DELETE_METHOD;
+  mutex& operator=(const mutex&) DELETE_METHOD;
+  mutex& operator=(mutex&&) DELETE_METHOD;
+
+ public:
+
+  /**
+   * @copydoc cpen333::process::posix::mutex::lock()
+   */
+  void lock() {
+    storage_->lock();
+  }
+
+  /**
+   * @copydoc cpen333::process::posix::mutex::try_lock()
+   */
+  bool try_lock() {
+    return storage_->try_lock();
+  }
+
+  /**
+   * @copydoc cpen333::process::posix::mutex::try_lock_for()
+   */
+  template< class Rep, class Period >
+  bool try_lock_for( const std::chrono::duration<Rep,Period>& timeout_duration ) {
+    return storage_->try_lock_for(timeout_duration);
+  }
+
+  /**
+   * @copydoc cpen333::process::posix::mutex::try_lock_until()
+   */
+  template< class Clock, class Duration >
+  bool try_lock_until( const std::chrono::time_point<Clock,Duration>& timeout_time ) {
+    return storage_->try_lock_until(timeout_time);
+  }
+
+  /**
+   * @brief Locks the mutex after a condition wait, which may have moved other waiters onto it
+   *
+   * Keeps the mutex marked as having sleepers so that unlocking wakes the next of them.
+   */
+  void lock_contended() {
+    storage_->lock_contended();
+  }
+
+  /**
+   * @copydoc cpen333::process::posix::mutex::unlock()
+   */
+  void unlock() {
+    storage_->unlock();
+  }
+
+  /**
+   * @brief Returns a native handle
+   *
+   * In this case, a pointer to the futex mutex in shared memory
+   *
+   * @return native handle to underlying mutex
+   */
+  native_handle_type native_handle() {
+    return storage_.get();
+  }
+
+  bool unlink() {
+    return storage_.unlink();
+  }
+
+  /**
+   * @copydoc cpen333::process::named_resource::unlink(const std::string&)
+   */
+  static bool unlink(const std::string& name) {
+    return cpen333::process::shared_object<impl::embedded_mutex>::unlink(name + std::string(MUTEX_NAME_SUFFIX));
+  }
+
+ private:
+  cpen333::process::shared_object<impl::embedded_mutex> storage_;  // mutex state
+
+};
+
+} // native implementation
+
+#ifdef CPEN333_PROFILE_LOCKS
+/**
+ * @brief Alias to futex implementation of inter-process mutex, recording contention statistics
+ */
+using mutex = impl::profiled_mutex<futex::mutex>;
+
+/**
+ * @brief Alias to futex implementation of inter-process mutex allowing timed waits, recording contention statistics
+ */
+using timed_mutex = impl::profiled_mutex<futex::mutex>;
+#else
+/**
+ * @brief Alias to futex implementation of inter-process mutex
+ */
+using mutex = futex::mutex;
+
+/**
+ * @brief Alias to futex implementation of inter-process mutex allowing timed waits
+ */
+using timed_mutex = futex::mutex;
+#endif
+
+} // process
+} // cpen333
+
+// undef local macros
+#undef MUTEX_NAME_SUFFIX
+
+#endif //CPEN333_PROCESS_MUTEX_FUTEX_H
@@ -0,0 +1,263 @@
+/**
+ * @file
+ * @brief Linux implementation of an inter-process rendezvous
+ *
+ * Uses a generation counter and futex in a named shared memory block.
+ */
+#ifndef CPEN333_PROCESS_RENDEZVOUS_FUTEX_H
+#define CPEN333_PROCESS_RENDEZVOUS_FUTEX_H
+
+/**
+ * @brief Suffix to add to the rendezvous' name for uniqueness
+ */
+#define RENDEZVOUS_FUTEX_SUFFIX "_rdf"
+
+/**
+ * @brief Magic number to ensure rendezvous is initialized
+ */
+#define RENDEZVOUS_FUTEX_INITIALIZED 0x38973824
+
+/**
+ * @brief Bits of the counts word holding the number still to arrive in the current round
+ */
+#define RENDEZVOUS_FUTEX_COUNT_MASK 0x0000FFFFu
+
+/**
+ * @brief Shift of the group size in the counts word
+ */
+#define RENDEZVOUS_FUTEX_SIZE_SHIFT 16
+
+#include <string>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+
+#include "../../../util.h"
+#include "../../../impl/futex.h"
+#include "../../named_resource.h"
+#include "../../shared_memory.h"
+#include "../embedded_sync.h"
+#include "../shared_layout.h"
+
+namespace cpen333 {
+namespace process {
+namespace futex {
+
+/**
+ * @brief Inter-process rendezvous implementation
+ *
+ * A synchronization primitive that allows a certain number of threads/processes to wait for others to arrive, then
+ * proceed together.  The rendezvous can be reused for any number of rounds.
+ *
+ * Each round has a generation number, a futex word that only the last to arrive changes.  Arriving is a single
+ * atomic update of the group's counts; the last to arrive starts the next round and releases everyone with one wake
+ * call.  Since waiters wait for the generation they arrived in to end rather than for a shared count, a fast process
+ * cannot run ahead and steal a release meant for the current round.  Arriving and waiting can be separated (see
+ * arrive() and wait(arrival_token)) so that a process can do useful work while the others catch up.
+ *
+ * Groups are limited to 65535 processes.
+ */
+class rendezvous : public virtual named_resource {
+
+ public:
+  /**
+   * @brief Identifies the round a process arrived in, for waiting for that round to end
+   */
+  using arrival_token = uint32_t;
+
+  /**
+   * @brief Creates or connects to a named rendezvous primitive
+   * @param name  identifier for creating or connecting to an existing inter-process rendezvous
+   * @param size  number of processes in group
+   */
+  rendezvous(const std::string &name, size_t size) :
+      shared_(name + std::string(RENDEZVOUS_FUTEX_SUFFIX)) {
+    bool initialized = impl::initialize_once(shared_->initialized, RENDEZVOUS_FUTEX_INITIALIZED, [&](){
+      if (size > RENDEZVOUS_FUTEX_COUNT_MASK) {
+        cpen333::error(std::string("Rendezvous ") + name + " is too large, limiting to "
+                           + std::to_string(RENDEZVOUS_FUTEX_COUNT_MASK) + " processes");
+        size = RENDEZVOUS_FUTEX_COUNT_MASK;
+      }
+      shared_->layout = CPEN333_PROCESS_LAYOUT_VERSION;
+      shared_->counts.store(pack((uint32_t)size, (uint32_t)size), std::memory_order_relaxed);
+      shared_->generation.store(0, std::memory_order_relaxed);
+    });
+    if (!initialized) {
+      impl::check_layout(shared_->layout, name);
+    }
+  }
+
+ private:
+  rendezvous(const rendezvous&) DELETE_METHOD;
+  rendezvous(rendezvous&&) DELETE_METHOD;
+  rendezvous& operator=(const rendezvous&) DELETE_METHOD;
+  rendezvous& operator=(rendezvous&&) DELETE_METHOD;
+
+ public:
+
+  /**
+   * @brief Waits until all other processes are also waiting
+   *
+   * Will cause the current process to block until all (# size) processes are waiting, then will release so that
+   * the processes are synchronized.  Equivalent to `wait(arrive())`.
+   */
+  void wait() {
+    wait(arrive());
+  }
+
+  /**
+   * @brief Arrives at the rendezvous without waiting for the others
+   *
+   * If this is the last process to arrive, releases all those waiting and starts the next round.
+   *
+   * @return token to pass to wait(arrival_token) to wait for the others
+   */
+  arrival_token arrive() {
+    // our round cannot end before we arrive, so the generation read now is the one we arrive in
+    arrival_token token = shared_->generation.load(std::memory_order_acquire);
+    uint32_t c = shared_->counts.load(std::memory_order_relaxed);
+    uint32_t next;
+    do {
+      if (count(c) == 0) {
+        return token-1;  // empty group, no-one to wait for
+      }
+      next = count(c) == 1 ? pack(size(c), size(c)) : c-1;
+    } while (!shared_->counts.compare_exchange_weak(c, next, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    if (count(c) == 1) {
+      release();
+    }
+    return token;
+  }
+
+  /**
+   * @brief Waits for the round identified by a token to end
+   *
+   * Returns immediately if all processes have already arrived.
+   *
+   * @param token token returned by arrive()
+   */
+  void wait(arrival_token token) {
+    while (shared_->generation.load(std::memory_order_acquire) == token) {
+      cpen333::impl::futex_wait(&shared_->generation, token, true);
+    }
+  }
+
+  /**
+   * @brief Waits for the round identified by a token to end, or for a timeout period to elapse
+   *
+   * A process that times out has still arrived, so the round can still end without it; wait again with the
+   * same token to continue waiting.
+   *
+   * @tparam Rep duration representation
+   * @tparam Period duration period
+   * @param token token returned by arrive()
+   * @param rel_time maximum relative time to wait
+   * @return `true` if the round has ended, `false` on timeout
+   */
+  template<class Rep, class Period>
+  bool wait_for(arrival_token token, const std::chrono::duration<Rep, Period>& rel_time) {
+    return wait_until(token, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @brief Waits for the round identified by a token to end, or for a timeout time to be reached
+   *
+   * A process that times out has still arrived; wait again with the same token to continue waiting.
+   *
+   * @tparam Clock clock type
+   * @tparam Duration clock duration type
+   * @param token token returned by arrive()
+   * @param timeout_time absolute timeout time
+   * @return `true` if the round has ended, `false` on timeout
+   */
+  template<class Clock, class Duration>
+  bool wait_until(arrival_token token, const std::chrono::time_point<Clock, Duration>& timeout_time) {
+    timespec ts = cpen333::impl::monotonic_timespec(timeout_time);
+    while (shared_->generation.load(std::memory_order_acquire) == token) {
+      if (!cpen333::impl::futex_wait_until(&shared_->generation, token, ts, true)) {
+        return shared_->generation.load(std::memory_order_acquire) != token;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief Arrives at the rendezvous and leaves the group
+   *
+   * Counts as an arrival for the current round, but the group is one process smaller in all later rounds.
+   */
+  void arrive_and_drop() {
+    uint32_t c = shared_->counts.load(std::memory_order_relaxed);
+    uint32_t next;
+    do {
+      if (count(c) == 0) {
+        return;
+      }
+      next = count(c) == 1 ? pack(size(c)-1, size(c)-1) : pack(size(c)-1, count(c)-1);
+    } while (!shared_->counts.compare_exchange_weak(c, next, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    if (count(c) == 1) {
+      release();
+    }
+  }
+
+  bool unlink() {
+    return shared_.unlink();
+  }
+
+  /**
+  * @copydoc cpen333::process::named_resource::unlink(const std::string&)
+  */
+  static bool unlink(const std::string& name) {
+    return cpen333::process::shared_object<shared_data>::unlink(name + std::string(RENDEZVOUS_FUTEX_SUFFIX));
+  }
+
+ private:
+
+  static uint32_t pack(uint32_t size, uint32_t count) {
+    return (size << RENDEZVOUS_FUTEX_SIZE_SHIFT) | count;
+  }
+
+  static uint32_t size(uint32_t c) {
+    return c >> RENDEZVOUS_FUTEX_SIZE_SHIFT;
+  }
+
+  static uint32_t count(uint32_t c) {
+    return c & RENDEZVOUS_FUTEX_COUNT_MASK;
+  }
+
+  // ends the current round, called by the last to arrive after resetting the count
+  void release() {
+    shared_->generation.fetch_add(1, std::memory_order_release);
+    cpen333::impl::futex_wake(&shared_->generation, INT_MAX, true);
+  }
+
+  struct shared_data {
+    std::atomic<uint32_t> initialized;   // magic initialized number
+    uint32_t layout;                     // layout version
+    std::atomic<uint32_t> counts;        // group size and number still to arrive in this round
+    char pad0[CPEN333_CACHE_LINE_SIZE-3*sizeof(uint32_t)];
+    cpen333::impl::futex_word generation;  // round number, waiters sleep on it
+  };
+  cpen333::process::shared_object<shared_data> shared_;
+
+};
+
+} // futex
+
+/**
+ * @brief Alias to futex implementation of inter-process rendezvous
+ */
+using rendezvous = futex::rendezvous;
+
+} // process
+} // cpen333
+
+// undef local macros
+#undef RENDEZVOUS_FUTEX_SUFFIX
+#undef RENDEZVOUS_FUTEX_INITIALIZED
+#undef RENDEZVOUS_FUTEX_COUNT_MASK
+#undef RENDEZVOUS_FUTEX_SIZE_SHIFT
+
+#endif //CPEN333_PROCESS_RENDEZVOUS_FUTEX_H
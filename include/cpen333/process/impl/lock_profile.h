@@ -0,0 +1,388 @@
+/**
+ * @file
+ * @brief Lock contention statistics, kept in named shared memory
+ *
+ * Profiling is opt-in: defining CPEN333_PROFILE_LOCKS before including any library header makes
+ * cpen333::process::mutex record, for each named mutex, how often it is acquired, how often an acquisition had to
+ * wait, and histograms of the wait and hold times.  The statistics live in a small shared memory block named after
+ * the lock, so every process attached to the same mutex adds to the same counters, and the `lock_stats` tool can
+ * print or reset them by name while the program runs.  Thread locks can be profiled the same way by wrapping them
+ * in a cpen333::thread::profiled_mutex.  Without CPEN333_PROFILE_LOCKS, none of this is compiled in.
+ */
+#ifndef CPEN333_PROCESS_IMPL_LOCK_PROFILE_H
+#define CPEN333_PROCESS_IMPL_LOCK_PROFILE_H
+
+/**
+ * @brief Suffix to append to lock names for the statistics block
+ */
+#define LOCK_PROFILE_SUFFIX "_lks"
+
+/**
+ * @brief Number of histogram buckets, bucket i counting times in [2^i, 2^(i+1)) ns, the last open-ended
+ */
+#define LOCK_PROFILE_BUCKETS 32
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+#include "../../util.h"
+#include "../shared_memory.h"
+
+namespace cpen333 {
+namespace process {
+namespace impl {
+
+/**
+ * @brief Contention statistics of a single lock, stored in shared memory
+ *
+ * Zeroed memory is an empty set of statistics.  Different locks can share a block (e.g. thread locks with the same
+ * name in different processes), so the counters are only ever updated with atomic adds.
+ */
+struct lock_stats {
+  std::atomic<uint64_t> acquisitions;   ///< number of times the lock was acquired
+  std::atomic<uint64_t> contended;      ///< acquisitions that found the lock held and had to wait
+  std::atomic<uint64_t> failed;         ///< try-locks and timed locks that gave up
+  std::atomic<uint64_t> wait_ns;        ///< total time spent waiting by contended acquisitions
+  std::atomic<uint64_t> hold_ns;        ///< total time the lock was held
+  std::atomic<uint64_t> wait_histogram[LOCK_PROFILE_BUCKETS];  ///< wait times of contended acquisitions
+  std::atomic<uint64_t> hold_histogram[LOCK_PROFILE_BUCKETS];  ///< hold times
+};
+
+/**
+ * @brief Handle to the contention statistics of a named lock
+ *
+ * Creates or connects to the statistics block of the lock with the given name.  This is the name the lock was
+ * constructed with, so the block can be found by anyone who knows that name.
+ */
+class lock_profile {
+ public:
+  /**
+   * @brief Creates or connects to the statistics of a named lock
+   * @param name name of the lock
+   */
+  explicit lock_profile(const std::string& name) :
+      stats_(name + std::string(LOCK_PROFILE_SUFFIX)), held_since_(0) {}
+
+  /**
+   * @brief Current steady-clock time, in nanoseconds
+   * @return time since the steady clock's epoch
+   */
+  static uint64_t now() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /**
+   * @brief Records an acquisition that did not have to wait, must be called while holding the lock
+   */
+  void acquired() {
+    uint64_t t = now();
+    increment(stats_->acquisitions, 1);
+    held_since_ = t;
+  }
+
+  /**
+   * @brief Records a contended acquisition, must be called while holding the lock
+   * @param start time the acquisition started waiting, from now()
+   */
+  void acquired(uint64_t start) {
+    uint64_t t = now();
+    uint64_t waited = t - start;
+    increment(stats_->acquisitions, 1);
+    increment(stats_->contended, 1);
+    increment(stats_->wait_ns, waited);
+    increment(stats_->wait_histogram[bucket(waited)], 1);
+    held_since_ = t;
+  }
+
+  /**
+   * @brief Records a failed try-lock or timed lock
+   */
+  void failed() {
+    increment(stats_->failed, 1);
+  }
+
+  /**
+   * @brief Records the hold time, must be called while still holding the lock
+   */
+  void released() {
+    uint64_t held = now() - held_since_;
+    increment(stats_->hold_ns, held);
+    increment(stats_->hold_histogram[bucket(held)], 1);
+  }
+
+  /**
+   * @brief Clears all statistics
+   *
+   * Updates made at the same time by processes using the lock may be lost.
+   */
+  void reset() {
+    stats_->acquisitions.store(0, std::memory_order_relaxed);
+    stats_->contended.store(0, std::memory_order_relaxed);
+    stats_->failed.store(0, std::memory_order_relaxed);
+    stats_->wait_ns.store(0, std::memory_order_relaxed);
+    stats_->hold_ns.store(0, std::memory_order_relaxed);
+    for (size_t i=0; i<LOCK_PROFILE_BUCKETS; ++i) {
+      stats_->wait_histogram[i].store(0, std::memory_order_relaxed);
+      stats_->hold_histogram[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Prints a summary of the statistics followed by the wait and hold time histograms
+   * @param os output stream
+   */
+  void print(std::ostream& os) {
+    uint64_t acquisitions = stats_->acquisitions.load(std::memory_order_relaxed);
+    uint64_t contended = stats_->contended.load(std::memory_order_relaxed);
+    uint64_t wait_ns = stats_->wait_ns.load(std::memory_order_relaxed);
+    uint64_t hold_ns = stats_->hold_ns.load(std::memory_order_relaxed);
+
+    os << "  acquisitions: " << acquisitions << std::endl;
+    os << "  contended:    " << contended;
+    if (acquisitions > 0) {
+      std::ostringstream percent;
+      percent << std::fixed << std::setprecision(1) << (100.0*contended/acquisitions);
+      os << " (" << percent.str() << "%)";
+    }
+    os << std::endl;
+    os << "  failed:       " << stats_->failed.load(std::memory_order_relaxed) << std::endl;
+    os << "  total wait:   " << duration(wait_ns);
+    if (contended > 0) {
+      os << ", mean " << duration(wait_ns/contended) << " per contended acquisition";
+    }
+    os << std::endl;
+    os << "  total hold:   " << duration(hold_ns);
+    if (acquisitions > 0) {
+      os << ", mean " << duration(hold_ns/acquisitions);
+    }
+    os << std::endl;
+    print_histogram(os, "wait times (contended acquisitions)", stats_->wait_histogram);
+    print_histogram(os, "hold times", stats_->hold_histogram);
+  }
+
+  /**
+   * @brief Unlinks the statistics block
+   * @return true if successful, false otherwise
+   */
+  bool unlink() {
+    return stats_.unlink();
+  }
+
+  /**
+   * @brief Unlinks the statistics of a named lock without needing to connect to them
+   * @param name name of the lock
+   * @return true if successful, false otherwise
+   */
+  static bool unlink(const std::string& name) {
+    return cpen333::process::shared_object<lock_stats>::unlink(name + std::string(LOCK_PROFILE_SUFFIX));
+  }
+
+ private:
+
+  static void increment(std::atomic<uint64_t>& counter, uint64_t amount) {
+    counter.fetch_add(amount, std::memory_order_relaxed);
+  }
+
+  // histogram bucket of a time, floor(log2(ns))
+  static size_t bucket(uint64_t ns) {
+    size_t b = 0;
+    while (ns > 1 && b < LOCK_PROFILE_BUCKETS-1) {
+      ns >>= 1;
+      ++b;
+    }
+    return b;
+  }
+
+  // formats a time with units
+  static std::string duration(uint64_t ns) {
+    static const char* units[] = {"ns", "us", "ms", "s"};
+    double d = (double)ns;
+    size_t u = 0;
+    while (d >= 1000 && u < 3) {
+      d /= 1000;
+      ++u;
+    }
+    std::ostringstream ss;
+    ss << std::setprecision(3) << d << " " << units[u];
+    return ss.str();
+  }
+
+  // prints the non-empty range of a histogram, with bars scaled to the largest bucket
+  static void print_histogram(std::ostream& os, const char* title,
+                              std::atomic<uint64_t> (&histogram)[LOCK_PROFILE_BUCKETS]) {
+    uint64_t counts[LOCK_PROFILE_BUCKETS];
+    uint64_t largest = 0;
+    size_t first = LOCK_PROFILE_BUCKETS;
+    size_t last = 0;
+    for (size_t i=0; i<LOCK_PROFILE_BUCKETS; ++i) {
+      counts[i] = histogram[i].load(std::memory_order_relaxed);
+      if (counts[i] > 0) {
+        first = first < i ? first : i;
+        last = i;
+        largest = largest > counts[i] ? largest : counts[i];
+      }
+    }
+
+    os << "  " << title << ":" << std::endl;
+    if (largest == 0) {
+      os << "    (none)" << std::endl;
+      return;
+    }
+    for (size_t i=first; i<=last; ++i) {
+      std::string range = i == 0 ? std::string("< 2 ns") : std::string(">= ") + duration((uint64_t)1 << i);
+      os << "    " << std::left << std::setw(12) << range << std::right << std::setw(12) << counts[i] << " "
+         << std::string((size_t)((40*counts[i]+largest-1)/largest), '#') << std::endl;
+    }
+  }
+
+  cpen333::process::shared_object<lock_stats> stats_;
+  uint64_t held_since_;  // time the current holder acquired the lock, only touched by the holder of this lock
+};
+
+/**
+ * @brief Wraps a lock to record its contention statistics
+ *
+ * Every acquisition first tries the lock without waiting; only if that fails is the time spent waiting for the
+ * lock measured, so the wait histogram holds contended acquisitions only.  Works with anything with lock(),
+ * try_lock() and unlock(), and forwards try_lock_for() and try_lock_until() if the lock has them.  A lock that is
+ * itself named (such as cpen333::process::mutex) is constructed with the same name as its statistics.
+ *
+ * @tparam Mutex lock type
+ */
+template<typename Mutex>
+class profiled_mutex : public Mutex {
+ public:
+  /**
+   * @brief Constructs the lock, creating or connecting to its statistics
+   * @param name name of the lock, which also names its statistics
+   */
+  explicit profiled_mutex(const std::string& name) :
+      profiled_mutex(name, std::is_constructible<Mutex, const std::string&>{}) {}
+
+  /**
+   * @brief Locks, recording whether the lock had to wait and for how long
+   */
+  void lock() {
+    if (Mutex::try_lock()) {
+      profile_.acquired();
+      return;
+    }
+    uint64_t start = lock_profile::now();
+    Mutex::lock();
+    profile_.acquired(start);
+  }
+
+  /**
+   * @brief Tries to lock without waiting
+   * @return true if locked successfully, false if already locked
+   */
+  bool try_lock() {
+    if (Mutex::try_lock()) {
+      profile_.acquired();
+      return true;
+    }
+    profile_.failed();
+    return false;
+  }
+
+  /**
+   * @brief Tries to lock until a relative time has elapsed
+   * @tparam Rep timer representation
+   * @tparam Period timeout period type
+   * @param timeout_duration maximum relative time to block for
+   * @return true if lock was acquired successfully, false otherwise
+   */
+  template< class Rep, class Period >
+  bool try_lock_for( const std::chrono::duration<Rep,Period>& timeout_duration ) {
+    return try_lock_until(std::chrono::steady_clock::now()+timeout_duration);
+  }
+
+  /**
+   * @brief Tries to lock until an absolute time has passed
+   * @tparam Clock timeout clock type
+   * @tparam Duration timeout duration type
+   * @param timeout_time absolute timeout time
+   * @return true if the lock was acquired successfully, false otherwise
+   */
+  template< class Clock, class Duration >
+  bool try_lock_until( const std::chrono::time_point<Clock,Duration>& timeout_time ) {
+    if (Mutex::try_lock()) {
+      profile_.acquired();
+      return true;
+    }
+    uint64_t start = lock_profile::now();
+    if (!Mutex::try_lock_until(timeout_time)) {
+      profile_.failed();
+      return false;
+    }
+    profile_.acquired(start);
+    return true;
+  }
+
+  /**
+   * @brief Relocks after a condition wait, which is always counted as contended
+   */
+  void lock_contended() {
+    uint64_t start = lock_profile::now();
+    Mutex::lock_contended();
+    profile_.acquired(start);
+  }
+
+  /**
+   * @brief Unlocks, recording how long the lock was held
+   */
+  void unlock() {
+    profile_.released();
+    Mutex::unlock();
+  }
+
+  /**
+   * @brief Statistics of this lock
+   * @return lock profile
+   */
+  lock_profile& profile() {
+    return profile_;
+  }
+
+  /**
+   * @brief Unlinks the lock and its statistics
+   * @return true if successful, false otherwise
+   */
+  bool unlink() {
+    bool b1 = Mutex::unlink();
+    bool b2 = profile_.unlink();
+    return b1 && b2;
+  }
+
+  /**
+   * @copydoc cpen333::process::named_resource::unlink(const std::string&)
+   */
+  static bool unlink(const std::string& name) {
+    bool b1 = Mutex::unlink(name);
+    bool b2 = lock_profile::unlink(name);
+    return b1 && b2;
+  }
+
+ private:
+  profiled_mutex(const std::string& name, std::true_type) : Mutex(name), profile_(name) {}
+  profiled_mutex(const std::string& name, std::false_type) : Mutex(), profile_(name) {}
+
+  lock_profile profile_;
+};
+
+} // impl
+} // process
+} // cpen333
+
+// undef local macros
+#undef LOCK_PROFILE_SUFFIX
+#undef LOCK_PROFILE_BUCKETS
+
+#endif //CPEN333_PROCESS_IMPL_LOCK_PROFILE_H
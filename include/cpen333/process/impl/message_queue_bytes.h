@@ -0,0 +1,448 @@
+/**
+ * @file
+ * @brief Inter-process message queue for variable-length messages, based on a byte ring
+ */
+#ifndef CPEN333_PROCESS_MESSAGE_QUEUE_BYTES_H
+#define CPEN333_PROCESS_MESSAGE_QUEUE_BYTES_H
+
+#include "../../os.h"
+
+#ifdef LINUX
+
+/**
+ * @brief Suffix for shared memory to guarantee uniqueness
+ */
+#define MESSAGE_QUEUE_BYTES_SUFFIX "_mqb"
+/**
+ * @brief Magic number to test for shared memory initialization
+ */
+#define MESSAGE_QUEUE_BYTES_INITIALIZED 0x33198562
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#include "../../util.h"
+#include "../../impl/futex.h"
+#include "../named_resource.h"
+#include "../shared_memory.h"
+#include "embedded_sync.h"
+#include "shared_layout.h"
+
+namespace cpen333 {
+namespace process {
+namespace impl {
+
+/**
+ * @brief Multi-process message queue carrying variable-length messages
+ *
+ * Messages are stored back-to-back in a ring of bytes in shared memory, each as a small length-prefixed record
+ * rounded up to 8 bytes, so a short message only takes up as much room as it needs rather than a slot sized for
+ * the largest message.  When a record would run past the end of the ring, the remainder of the ring is filled
+ * with a padding record that receivers skip, and the message starts again at the beginning.
+ *
+ * Senders are serialized by one lock and receivers by another, both embedded in the segment, and a full or empty
+ * queue is waited on using futexes in the same segment.  Messages are opaque bytes and are delivered in order.
+ * The largest message that can be sent is max_message_size(), half of the ring.  Only available on Linux.
+ */
+class message_queue_bytes : public virtual named_resource {
+
+ public:
+  /**
+   * @brief Constructs or connects to a named message queue
+   *
+   * @param name name identifier for creating or connecting to an existing inter-process message queue
+   * @param capacity if creating, the size of the ring in bytes, rounded up to a multiple of 8
+   */
+  message_queue_bytes(const std::string& name, size_t capacity = 65536) :
+      memory_(name + std::string(MESSAGE_QUEUE_BYTES_SUFFIX), sizeof(queue_info)+round_up(capacity)),
+      info_(nullptr), data_(nullptr) {
+
+    // info is at start of memory block, followed by the ring
+    info_ = (queue_info*)memory_.get();
+    data_ = (uint8_t*)memory_.get(sizeof(queue_info));
+
+    bool initialized = initialize_once(info_->initialized, MESSAGE_QUEUE_BYTES_INITIALIZED, [&](){
+      info_->layout = CPEN333_PROCESS_LAYOUT_VERSION;
+      info_->capacity = round_up(capacity);
+      info_->head.store(0, std::memory_order_relaxed);
+      info_->tail.store(0, std::memory_order_relaxed);
+      info_->messages.store(0, std::memory_order_relaxed);
+      info_->pmutex.init();
+      info_->cmutex.init();
+      info_->not_full.init();
+      info_->not_empty.init();
+    });
+    if (!initialized) {
+      check_layout(info_->layout, name);
+    }
+  }
+
+  /**
+   * @brief Sends a message to the queue
+   *
+   * Blocks until there is room in the ring for the message.
+   *
+   * @param data pointer to message bytes
+   * @param size number of bytes in the message
+   * @return `true` if sent, `false` if the message is larger than max_message_size()
+   */
+  bool send(const void* data, size_t size) {
+    if (!check_size(size)) {
+      return false;
+    }
+    {
+      std::lock_guard<embedded_mutex> lock(info_->pmutex);
+      info_->not_full.wait([&](){ return write_record(data, size); }, true);
+    }
+    info_->not_empty.notify_one(true);
+    return true;
+  }
+
+  /**
+   * @brief Sends a string as a message to the queue
+   *
+   * Blocks until there is room in the ring for the message.
+   *
+   * @param msg message to send
+   * @return `true` if sent, `false` if the message is larger than max_message_size()
+   */
+  bool send(const std::string& msg) {
+    return send(msg.data(), msg.size());
+  }
+
+  /**
+   * @brief Tries to send a message without blocking
+   *
+   * @param data pointer to message bytes
+   * @param size number of bytes in the message
+   * @return `true` if sent, `false` if there is currently no room or the message is too large
+   */
+  bool try_send(const void* data, size_t size) {
+    if (!check_size(size)) {
+      return false;
+    }
+    {
+      std::unique_lock<embedded_mutex> lock(info_->pmutex, std::try_to_lock);
+      if (!lock.owns_lock() || !write_record(data, size)) {
+        return false;
+      }
+    }
+    info_->not_empty.notify_one(true);
+    return true;
+  }
+
+  /**
+   * @brief Tries to send a message, will wait for a maximum amount of time before aborting
+   *
+   * @param data pointer to message bytes
+   * @param size number of bytes in the message
+   * @param rel_time relative timeout time
+   * @return `true` if sent within the timeout period, `false` if not sent
+   */
+  template <typename Rep, typename Period>
+  bool try_send_for(const void* data, size_t size, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_send_until(data, size, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @brief Tries to send a message, will wait until a timeout time has been reached before aborting
+   *
+   * @param data pointer to message bytes
+   * @param size number of bytes in the message
+   * @param timeout absolute timeout time
+   * @return `true` if sent before the timeout time, `false` if not sent
+   */
+  template<typename Clock, typename Duration>
+  bool try_send_until(const void* data, size_t size, const std::chrono::time_point<Clock,Duration>& timeout) {
+    if (!check_size(size)) {
+      return false;
+    }
+    {
+      std::unique_lock<embedded_mutex> lock(info_->pmutex, std::defer_lock);
+      if (!lock.try_lock_until(timeout)) {
+        return false;
+      }
+      timespec ts = cpen333::impl::monotonic_timespec(timeout);
+      if (!info_->not_full.wait_until(ts, [&](){ return write_record(data, size); }, true)) {
+        return false;
+      }
+    }
+    info_->not_empty.notify_one(true);
+    return true;
+  }
+
+  /**
+   * @brief Retrieves and removes the next message from the queue
+   *
+   * Blocks until a message is available.
+   *
+   * @param out destination, replaced by the message bytes.  If `nullptr`, the message is removed but not returned.
+   */
+  void receive(std::string* out) {
+    {
+      std::lock_guard<embedded_mutex> lock(info_->cmutex);
+      info_->not_empty.wait([&](){ return read_record(out, true); }, true);
+    }
+    info_->not_full.notify_one(true);
+  }
+
+  /**
+   * @brief Retrieves and removes the next message from the queue
+   *
+   * Blocks until a message is available.
+   *
+   * @return next message
+   */
+  std::string receive() {
+    std::string out;
+    receive(&out);
+    return out;
+  }
+
+  /**
+   * @brief Tries to receive a message without blocking
+   * @param out destination, replaced by the message bytes.  If `nullptr`, the message is removed but not returned.
+   * @return `true` if a message was received, `false` otherwise
+   */
+  bool try_receive(std::string* out) {
+    {
+      std::unique_lock<embedded_mutex> lock(info_->cmutex, std::try_to_lock);
+      if (!lock.owns_lock() || !read_record(out, true)) {
+        return false;
+      }
+    }
+    info_->not_full.notify_one(true);
+    return true;
+  }
+
+  /**
+   * @brief Tries to receive a message, will wait for a maximum amount of time before aborting
+   * @param out destination, replaced by the message bytes.  If `nullptr`, the message is removed but not returned.
+   * @param rel_time relative timeout time
+   * @return `true` if a message was received, `false` if timeout elapsed
+   */
+  template <typename Rep, typename Period>
+  bool try_receive_for(std::string* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_receive_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @brief Tries to receive a message, will wait for a maximum timeout time to be reached before aborting
+   * @param out destination, replaced by the message bytes.  If `nullptr`, the message is removed but not returned.
+   * @param timeout absolute timeout time
+   * @return `true` if a message was received, `false` if timeout
+   */
+  template<typename Clock, typename Duration>
+  bool try_receive_until(std::string* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    {
+      std::unique_lock<embedded_mutex> lock(info_->cmutex, std::defer_lock);
+      if (!lock.try_lock_until(timeout)) {
+        return false;
+      }
+      timespec ts = cpen333::impl::monotonic_timespec(timeout);
+      if (!info_->not_empty.wait_until(ts, [&](){ return read_record(out, true); }, true)) {
+        return false;
+      }
+    }
+    info_->not_full.notify_one(true);
+    return true;
+  }
+
+  /**
+   * @brief Peeks at the next message without removing it
+   *
+   * Blocks until a message is available.  The message will remain in the queue for the next `peek` or `receive`.
+   *
+   * @param out destination, replaced by the message bytes
+   */
+  void peek(std::string* out) {
+    std::lock_guard<embedded_mutex> lock(info_->cmutex);
+    info_->not_empty.wait([&](){ return read_record(out, false); }, true);
+  }
+
+  /**
+   * @brief Tries to peek at the next message without blocking
+   * @param out destination, replaced by the message bytes
+   * @return `true` if a message was peeked, `false` otherwise
+   */
+  bool try_peek(std::string* out) {
+    std::unique_lock<embedded_mutex> lock(info_->cmutex, std::try_to_lock);
+    return lock.owns_lock() && read_record(out, false);
+  }
+
+  /**
+   * @brief Number of messages currently in the queue
+   *
+   * This method should be used sparingly, since messages could be added/removed during or immediately after the call,
+   * making the result potentially unreliable.
+   *
+   * @return number of messages
+   */
+  size_t size() {
+    return info_->messages.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Check if the message queue is currently empty
+   * @return `true` if empty, `false` otherwise
+   */
+  bool empty() {
+    return size() == 0;
+  }
+
+  /**
+   * @brief Size of the ring, in bytes
+   * @return capacity in bytes
+   */
+  size_t capacity() const {
+    return info_->capacity;
+  }
+
+  /**
+   * @brief Largest message that can be sent, in bytes
+   *
+   * A record never straddles the end of the ring, so only messages up to half the ring are guaranteed to fit.
+   *
+   * @return maximum message size in bytes
+   */
+  size_t max_message_size() const {
+    return info_->capacity/2 - sizeof(record_header);
+  }
+
+  bool unlink() {
+    return memory_.unlink();
+  }
+
+  /**
+   * @copydoc cpen333::process::named_resource::unlink(const std::string&)
+   */
+  static bool unlink(const std::string& name) {
+    return cpen333::process::shared_memory::unlink(name + std::string(MESSAGE_QUEUE_BYTES_SUFFIX));
+  }
+
+ private:
+
+  static size_t round_up(size_t size) {
+    return (size + 7) & ~(size_t)7;
+  }
+
+  // size of a record in the ring, header plus aligned payload
+  static size_t record_size(size_t size) {
+    return sizeof(record_header) + round_up(size);
+  }
+
+  bool check_size(size_t size) {
+    if (size > max_message_size()) {
+      errno = EMSGSIZE;
+      cpen333::perror(std::string("Message too large for message queue ") + memory_.name());
+      return false;
+    }
+    return true;
+  }
+
+  // appends a record if there is room, called with the producer lock held
+  bool write_record(const void* data, size_t size) {
+    size_t capacity = info_->capacity;
+    size_t head = info_->head.load(std::memory_order_relaxed);
+    size_t tail = info_->tail.load(std::memory_order_acquire);
+    size_t rsize = record_size(size);
+    size_t pos = head % capacity;
+    size_t pad = (capacity - pos < rsize) ? capacity - pos : 0;  // wrap if record would run past the end
+
+    if (capacity - (head - tail) < pad + rsize) {
+      return false;
+    }
+
+    if (pad > 0) {
+      record_header* padding = (record_header*)&data_[pos];
+      padding->size = (uint32_t)(pad - sizeof(record_header));
+      padding->type = RECORD_PADDING;
+      head += pad;
+      pos = 0;
+    }
+
+    record_header* header = (record_header*)&data_[pos];
+    header->size = (uint32_t)size;
+    header->type = RECORD_MESSAGE;
+    std::memcpy(&data_[pos+sizeof(record_header)], data, size);
+
+    info_->messages.fetch_add(1, std::memory_order_relaxed);
+    info_->head.store(head + rsize, std::memory_order_release);  // publish to receivers
+    return true;
+  }
+
+  // reads the next message, skipping padding, called with the consumer lock held
+  bool read_record(std::string* out, bool remove) {
+    size_t capacity = info_->capacity;
+    size_t tail = info_->tail.load(std::memory_order_relaxed);
+    size_t head = info_->head.load(std::memory_order_acquire);
+
+    while (tail != head) {
+      size_t pos = tail % capacity;
+      record_header* header = (record_header*)&data_[pos];
+      if (header->type == RECORD_PADDING) {
+        tail += sizeof(record_header) + header->size;
+        info_->tail.store(tail, std::memory_order_release);
+        continue;
+      }
+
+      if (out != nullptr) {
+        out->assign((const char*)&data_[pos+sizeof(record_header)], header->size);
+      }
+      if (remove) {
+        info_->messages.fetch_sub(1, std::memory_order_relaxed);
+        info_->tail.store(tail + record_size(header->size), std::memory_order_release);  // free for senders
+      }
+      return true;
+    }
+    return false;
+  }
+
+  enum record_type : uint32_t {
+    RECORD_MESSAGE = 0,
+    RECORD_PADDING = 1
+  };
+
+  struct record_header {
+    uint32_t size;     // payload size in bytes, excluding header and alignment
+    uint32_t type;     // message or padding
+  };
+
+  struct queue_info {
+    std::atomic<uint32_t> initialized;            // magic initialized marker
+    uint32_t layout;                              // layout version
+    size_t capacity;                              // ring size in bytes, multiple of 8
+    std::atomic<size_t> messages;                 // number of messages in the ring
+    char pad0[CPEN333_CACHE_LINE_SIZE];
+    std::atomic<size_t> head;                     // bytes ever written, only ever increases
+    embedded_mutex pmutex;                        // serializes senders
+    cpen333::impl::futex_eventcount not_full;     // sender waiting for room
+    char pad1[CPEN333_CACHE_LINE_SIZE];
+    std::atomic<size_t> tail;                     // bytes ever consumed, only ever increases
+    embedded_mutex cmutex;                        // serializes receivers
+    cpen333::impl::futex_eventcount not_empty;    // receiver waiting for a message
+    char pad2[CPEN333_CACHE_LINE_SIZE];
+  };
+
+  cpen333::process::shared_memory memory_;   // actual memory
+  queue_info* info_;                         // pointer to queue information, at start of memory_
+  uint8_t* data_;                            // pointer to ring, after info_ in memory
+
+};
+
+} // impl
+} // process
+} // cpen333
+
+// undef local macros
+#undef MESSAGE_QUEUE_BYTES_SUFFIX
+#undef MESSAGE_QUEUE_BYTES_INITIALIZED
+
+#endif // LINUX
+
+#endif //CPEN333_PROCESS_MESSAGE_QUEUE_BYTES_H
@@ -0,0 +1,588 @@
+/**
+ * @file
+ * @brief Inter-process message queue stored in a memory-mapped file, surviving restarts
+ */
+#ifndef CPEN333_PROCESS_MESSAGE_QUEUE_FILE_H
+#define CPEN333_PROCESS_MESSAGE_QUEUE_FILE_H
+
+#include "../../os.h"
+
+#ifdef LINUX
+
+/**
+ * @brief Magic number identifying a message queue file
+ */
+#define MESSAGE_QUEUE_FILE_MAGIC 0x3319856F
+/**
+ * @brief Version of the file layout
+ */
+#define MESSAGE_QUEUE_FILE_VERSION 1
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../../util.h"
+#include "../../impl/futex.h"
+#include "../named_resource.h"
+#include "embedded_sync.h"
+#include "shared_layout.h"
+
+namespace cpen333 {
+namespace process {
+namespace impl {
+
+/**
+ * @brief When a file-backed message queue flushes its contents to disk
+ *
+ * Regardless of policy, the file is written back by the kernel in due course, so messages survive a crash of any
+ * attached process and a clean shutdown.  Explicit flushes with `msync` are what make them survive a power loss.
+ */
+enum class sync_policy {
+  none,       ///< only flush on sync() and when the queue is closed
+  periodic,   ///< flush on send or commit if at least a set period has passed since the last flush
+  batched     ///< flush after a set number of sends and commits
+};
+
+/**
+ * @brief Multi-process message queue whose ring lives in a memory-mapped file
+ *
+ * Unlike the other message queues, which live in shared memory and vanish on reboot, the ring, the producer
+ * position and the consumer's committed position are stored in a regular file.  A received message is only
+ * consumed for good once the consumer calls commit(); when the queue is next opened with no other process attached
+ * (e.g. after a crash or a reboot), reading resumes from the last committed position, replaying anything that was
+ * received but not committed.  Messages must be trivially copyable, since they are stored as raw bytes.
+ *
+ * The read position is shared by all consumers, so it is not rewound when the queue is opened while other processes
+ * still have it open: a consumer that restarts while a producer stays attached resumes after the messages its
+ * previous run received.  To replay the ones that were not committed, a restarted consumer should call rewind()
+ * before receiving.
+ *
+ * Producers are serialized by one lock and consumers by another, both embedded in the file along with the futex
+ * wait queues for a full or empty queue.  Since a process may have died while holding one of them, the first
+ * process to open the file resets them, which it detects by an open-file lock held for as long as the queue is
+ * open.  Producers only reuse a slot once the message in it has been committed, so a consumer that never commits
+ * will eventually block producers.  Only available on Linux.
+ *
+ * A file created by a different version of this library or for a different message type is never reset, since
+ * it may hold undelivered messages: opening it throws a cpen333::process::layout_error and leaves it untouched.
+ *
+ * @tparam MessageType fixed type of messages
+ */
+template<typename MessageType>
+class message_queue_file : public virtual named_resource {
+
+  static_assert(std::is_trivially_copyable<MessageType>::value,
+                "message_queue_file requires a trivially copyable message type");
+
+ public:
+  /**
+   * @brief Message type
+   */
+  typedef MessageType message_type;
+
+  /**
+   * @brief Opens or creates a file-backed message queue
+   *
+   * Throws a cpen333::process::layout_error if the file holds an incompatible queue, or a std::system_error if it
+   * cannot be opened or mapped.
+   *
+   * @param filename path of the file to store the queue in
+   * @param size if creating, the maximum number of uncommitted messages that can be stored without blocking
+   * @param policy when this process flushes the file to disk
+   * @param batch for sync_policy::batched, number of sends and commits between flushes
+   * @param period for sync_policy::periodic, minimum time between flushes
+   */
+  message_queue_file(const std::string& filename, size_t size = 1024, sync_policy policy = sync_policy::none,
+                     size_t batch = 64, std::chrono::milliseconds period = std::chrono::milliseconds(100)) :
+      filename_(filename), fid_(-1), map_(nullptr), map_size_(0), info_(nullptr), data_(nullptr),
+      policy_(policy), batch_(batch > 0 ? batch : 1), period_(period) {
+    open(size);
+  }
+
+ private:
+  message_queue_file(const message_queue_file&) DELETE_METHOD;
+  message_queue_file(message_queue_file&&) DELETE_METHOD;
+  message_queue_file& operator=(const message_queue_file&) DELETE_METHOD;
+  message_queue_file& operator=(message_queue_file&&) DELETE_METHOD;
+
+ public:
+
+  /**
+   * @brief Closes the queue, flushing it to disk first unless the policy is sync_policy::none
+   */
+  ~message_queue_file() {
+    if (map_ != nullptr) {
+      if (policy_ != sync_policy::none) {
+        sync();
+      }
+      if (munmap(map_, map_size_) != 0) {
+        cpen333::perror(std::string("Cannot unmap message queue file ") + filename_);
+      }
+    }
+    if (fid_ != -1) {
+      ::close(fid_);  // also releases our open-file lock
+    }
+  }
+
+  /**
+   * @brief Sends a message to the queue
+   *
+   * Blocks while the queue is full of uncommitted messages.
+   *
+   * @param msg message to send
+   */
+  void send(const MessageType& msg) {
+    info_->not_full.wait([&](){ return push_message(msg); }, true);
+    info_->not_empty.notify_one(true);
+    maybe_sync();
+  }
+
+  /**
+   * @brief Tries to send a message without blocking
+   * @param msg message to send
+   * @return `true` if message sent successfully, `false` if the queue is full
+   */
+  bool try_send(const MessageType& msg) {
+    if (!push_message(msg)) {
+      return false;
+    }
+    info_->not_empty.notify_one(true);
+    maybe_sync();
+    return true;
+  }
+
+  /**
+   * @brief Tries to send a message, will wait for a maximum amount of time before aborting
+   *
+   * @tparam Rep timeout duration representation
+   * @tparam Period timeout duration period
+   * @param msg message to send
+   * @param rel_time relative timeout time
+   * @return `true` if the message is sent successfully within the timeout period, `false` if not sent
+   */
+  template <typename Rep, typename Period>
+  bool try_send_for(const MessageType& msg, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_send_until(msg, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @brief Tries to send a message, will wait until a timeout time has been reached before aborting
+   *
+   * @tparam Clock timeout clock type
+   * @tparam Duration timeout duration type
+   * @param msg message to send
+   * @param timeout absolute timeout time
+   * @return `true` if message sent successfully before timeout time has passed, `false` if message not sent
+   */
+  template<typename Clock, typename Duration>
+  bool try_send_until(const MessageType& msg, const std::chrono::time_point<Clock,Duration>& timeout) {
+    timespec ts = cpen333::impl::monotonic_timespec(timeout);
+    if (!info_->not_full.wait_until(ts, [&](){ return push_message(msg); }, true)) {
+      return false;
+    }
+    info_->not_empty.notify_one(true);
+    maybe_sync();
+    return true;
+  }
+
+  /**
+   * @brief Retrieves the next message from the queue
+   *
+   * If there are currently no messages in the queue, then the current thread will block until one becomes
+   * available.  The message is not consumed for good until commit() is called.
+   *
+   * @return the next message in the queue
+   */
+  MessageType receive() {
+    MessageType out;
+    receive(&out);
+    return out;
+  }
+
+  /**
+   * @brief Retrieves the next message from the queue
+   *
+   * If there are currently no messages in the queue, then the current thread will block until one becomes
+   * available.  The message is not consumed for good until commit() is called.
+   *
+   * @param out destination.  If `nullptr`, the message is skipped but not returned
+   */
+  void receive(MessageType* out) {
+    info_->not_empty.wait([&](){ return pop_message(out); }, true);
+  }
+
+  /**
+   * @brief Tries to receive a message without blocking
+   * @param out destination.  If `nullptr`, the message is skipped but not returned.
+   * @return `true` if a message is returned, `false` if there are no messages
+   */
+  bool try_receive(MessageType* out) {
+    return pop_message(out);
+  }
+
+  /**
+   * @brief Tries to receive a message, will wait for a maximum amount of time before aborting
+   *
+   * @tparam Rep duration representation
+   * @tparam Period duration period
+   * @param out destination.  If `nullptr`, the next message is skipped but not returned
+   * @param rel_time relative timeout time
+   * @return `true` if message successfully returned, `false` if timeout elapsed
+   */
+  template <typename Rep, typename Period>
+  bool try_receive_for(MessageType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_receive_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @brief Tries to receive a message, will wait until a timeout time has been reached before aborting
+   *
+   * @tparam Clock clock type
+   * @tparam Duration clock duration type
+   * @param out destination.  If `nullptr`, the next message is skipped but not returned
+   * @param timeout absolute timeout time
+   * @return `true` if message successfully returned, `false` if timeout
+   */
+  template<typename Clock, typename Duration>
+  bool try_receive_until(MessageType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    timespec ts = cpen333::impl::monotonic_timespec(timeout);
+    return info_->not_empty.wait_until(ts, [&](){ return pop_message(out); }, true);
+  }
+
+  /**
+   * @brief Commits every message received so far, freeing their slots for producers
+   *
+   * After a restart, reading resumes from the last committed message.
+   */
+  void commit() {
+    bool advanced = false;
+    {
+      std::lock_guard<embedded_mutex> lock(info_->cmutex);
+      uint64_t ridx = info_->ridx.load(std::memory_order_relaxed);
+      if (info_->cidx.load(std::memory_order_relaxed) != ridx) {
+        info_->cidx.store(ridx, std::memory_order_release);
+        advanced = true;
+      }
+    }
+    if (advanced) {
+      info_->not_full.notify_all(true);
+      maybe_sync();
+    }
+  }
+
+  /**
+   * @brief Rewinds reading to the last committed message, so received but uncommitted messages are received again
+   *
+   * Call on startup of a consumer that may be replacing one that crashed while the queue stayed open in another
+   * process.  Only rewind when no other consumer is receiving, since they would receive the messages again too.
+   */
+  void rewind() {
+    std::lock_guard<embedded_mutex> lock(info_->cmutex);
+    info_->ridx.store(info_->cidx.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Flushes the queue to disk, blocking until written
+   *
+   * Only messages sent and positions committed before the call are guaranteed to survive a power loss.  The kernel
+   * also writes pages back on its own schedule, so positions may reach the disk ahead of messages sent since the last
+   * sync, which can then be lost or read back garbled after a power loss.
+   */
+  void sync() {
+    if (msync(data_, map_size_-info_->data_offset, MS_SYNC) != 0
+        || msync(map_, info_->data_offset, MS_SYNC) != 0) {
+      cpen333::perror(std::string("Failed to sync message queue file ") + filename_);
+    }
+  }
+
+  /**
+   * @brief Number of messages waiting to be received
+   *
+   * This method should be used sparingly, since messages could be added/removed during or immediately after the call,
+   * making the result potentially unreliable.
+   *
+   * @return number of messages
+   */
+  size_t size() {
+    return (size_t)(info_->pidx.load(std::memory_order_acquire) - info_->ridx.load(std::memory_order_acquire));
+  }
+
+  /**
+   * @brief Check if there are currently no messages waiting to be received
+   * @return `true` if empty, `false` otherwise
+   */
+  bool empty() {
+    return size() == 0;
+  }
+
+  /**
+   * @brief Number of received messages that have not yet been committed
+   * @return number of uncommitted messages
+   */
+  size_t uncommitted() {
+    return (size_t)(info_->ridx.load(std::memory_order_acquire) - info_->cidx.load(std::memory_order_acquire));
+  }
+
+  /**
+   * @brief Maximum number of uncommitted messages the queue can hold
+   * @return capacity in messages
+   */
+  size_t capacity() {
+    return (size_t)info_->size;
+  }
+
+  /**
+   * @brief Removes the queue's file
+   *
+   * Processes that already have the queue open can continue to use it.
+   *
+   * @return `true` if removed
+   */
+  bool unlink() {
+    return unlink(filename_);
+  }
+
+  /**
+   * @copydoc cpen333::process::named_resource::unlink(const std::string&)
+   */
+  static bool unlink(const std::string& filename) {
+    if (::unlink(filename.c_str()) != 0) {
+      cpen333::perror(std::string("Failed to unlink message queue file ") + filename);
+      return false;
+    }
+    return true;
+  }
+
+ private:
+
+  void open(size_t size) {
+    fid_ = ::open(filename_.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+    if (fid_ < 0) {
+      fail("Cannot open message queue file ");
+    }
+
+    // every process keeps a read lock on the first byte while open, so being able to write-lock it means no one
+    // else has the queue open and any lock or waiter state in the file is left over from a previous run
+    struct flock fl;
+    std::memset(&fl, 0, sizeof(fl));
+    fl.l_whence = SEEK_SET;
+    fl.l_start = 0;
+    fl.l_len = 1;
+    fl.l_type = F_WRLCK;
+    bool sole = fcntl(fid_, F_OFD_SETLK, &fl) == 0;
+    if (sole) {
+      prepare(size);
+    }
+    fl.l_type = F_RDLCK;  // atomically downgrades our write lock, or waits for the opener holding it
+    if (fcntl(fid_, F_OFD_SETLKW, &fl) != 0) {
+      cpen333::perror(std::string("Cannot lock message queue file ") + filename_);
+    }
+    if (!sole) {
+      map();
+      if (map_size_ < sizeof(queue_info) || info_->magic == 0) {
+        errno = EINVAL;
+        fail("Message queue file was not initialized ");  // its creator failed before finishing
+      }
+      check_header();
+    }
+    data_ = (MessageType*)((char*)map_ + info_->data_offset);
+  }
+
+  // sole opener: creates the layout if the file is new, otherwise resets state that only lives while open
+  void prepare(size_t size) {
+    struct stat st;
+    if (fstat(fid_, &st) != 0) {
+      fail("Cannot stat message queue file ");
+    }
+
+    // the magic number is written last, so a file without it never held a message
+    bool fresh = (size_t)st.st_size < sizeof(queue_info);
+    if (!fresh) {
+      map();
+      if (info_->magic == 0) {
+        unmap();
+        fresh = true;
+      } else {
+        check_header();
+      }
+    }
+
+    if (fresh) {
+      size_t page = (size_t)sysconf(_SC_PAGESIZE);
+      size_t offset = (sizeof(queue_info)+page-1)/page*page;  // messages start on a page for msync
+      if (ftruncate(fid_, 0) != 0 || ftruncate(fid_, (off_t)(offset+size*sizeof(MessageType))) != 0) {
+        fail("Cannot allocate message queue file ");
+      }
+      map();
+      info_->version = MESSAGE_QUEUE_FILE_VERSION;
+      info_->item_size = sizeof(MessageType);
+      info_->data_offset = offset;
+      info_->size = size;
+      info_->pidx.store(0, std::memory_order_relaxed);
+      info_->cidx.store(0, std::memory_order_relaxed);
+    } else if (info_->cidx.load(std::memory_order_relaxed) > info_->pidx.load(std::memory_order_relaxed)) {
+      info_->cidx.store(info_->pidx.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    // replay from the last committed message, and drop any lock or waiter held by a process that is gone
+    info_->ridx.store(info_->cidx.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    info_->pmutex.init();
+    info_->cmutex.init();
+    info_->not_full.init();
+    info_->not_empty.init();
+    info_->unsynced.store(0, std::memory_order_relaxed);
+    info_->last_sync.store(0, std::memory_order_relaxed);
+
+    if (fresh) {
+      // header must be on disk before anything can refer to it
+      std::atomic_thread_fence(std::memory_order_release);
+      info_->magic = MESSAGE_QUEUE_FILE_MAGIC;
+      msync(map_, map_size_, MS_SYNC);
+    }
+  }
+
+  // refuses a file written by another version or for another message type, leaving its messages untouched
+  void check_header() {
+    if (info_->magic != MESSAGE_QUEUE_FILE_MAGIC || info_->version != MESSAGE_QUEUE_FILE_VERSION
+        || info_->item_size != sizeof(MessageType)
+        || info_->data_offset + info_->size*sizeof(MessageType) > map_size_) {
+      std::string msg = std::string("Incompatible message queue file ") + filename_;
+      cpen333::error(msg);
+      close();
+      throw cpen333::process::layout_error(msg);
+    }
+  }
+
+  void map() {
+    struct stat st;
+    if (fstat(fid_, &st) != 0) {
+      fail("Cannot stat message queue file ");
+    }
+    map_size_ = (size_t)st.st_size;
+    map_ = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fid_, 0);
+    if (map_ == MAP_FAILED) {
+      map_ = nullptr;
+      fail("Cannot map message queue file ");
+    }
+    info_ = (queue_info*)map_;
+  }
+
+  void unmap() {
+    munmap(map_, map_size_);
+    map_ = nullptr;
+    info_ = nullptr;
+  }
+
+  // releases everything opened so far, since the destructor does not run if construction fails
+  void close() {
+    if (map_ != nullptr) {
+      unmap();
+    }
+    if (fid_ != -1) {
+      ::close(fid_);
+      fid_ = -1;
+    }
+  }
+
+  // reports a failed system call and fails construction
+  void fail(const char* msg) {
+    int err = errno;
+    cpen333::perror(std::string(msg) + filename_);
+    close();
+    throw std::system_error(err, std::generic_category(), std::string(msg) + filename_);
+  }
+
+  bool push_message(const MessageType& msg) {
+    std::lock_guard<embedded_mutex> lock(info_->pmutex);
+    uint64_t pidx = info_->pidx.load(std::memory_order_relaxed);
+    if (pidx - info_->cidx.load(std::memory_order_acquire) >= info_->size) {
+      return false;
+    }
+    std::memcpy(&data_[pidx % info_->size], &msg, sizeof(MessageType));
+    info_->pidx.store(pidx+1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop_message(MessageType* out) {
+    std::lock_guard<embedded_mutex> lock(info_->cmutex);
+    uint64_t ridx = info_->ridx.load(std::memory_order_relaxed);
+    if (ridx == info_->pidx.load(std::memory_order_acquire)) {
+      return false;
+    }
+    if (out != nullptr) {
+      std::memcpy(out, &data_[ridx % info_->size], sizeof(MessageType));
+    }
+    info_->ridx.store(ridx+1, std::memory_order_release);
+    return true;
+  }
+
+  // flushes if this process's policy calls for it after a send or commit
+  void maybe_sync() {
+    if (policy_ == sync_policy::batched) {
+      if (info_->unsynced.fetch_add(1, std::memory_order_relaxed)+1 >= batch_) {
+        info_->unsynced.store(0, std::memory_order_relaxed);
+        sync();
+      }
+    } else if (policy_ == sync_policy::periodic) {
+      int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+      int64_t last = info_->last_sync.load(std::memory_order_relaxed);
+      if (now - last >= std::chrono::duration_cast<std::chrono::nanoseconds>(period_).count()
+          && info_->last_sync.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+        sync();
+      }
+    }
+  }
+
+  struct queue_info {
+    uint32_t magic;                                  // identifies an initialized queue file, written last
+    uint32_t version;                                // layout version
+    uint64_t item_size;                              // sizeof(MessageType) the file was created with
+    uint64_t data_offset;                            // offset of messages from start of file
+    uint64_t size;                                   // capacity (in counts of MessageType)
+    std::atomic<uint64_t> pidx;                      // durable producer position
+    std::atomic<uint64_t> cidx;                      // durable committed consumer position
+    std::atomic<uint64_t> ridx;                      // read position, reset to cidx on restart
+    std::atomic<uint64_t> unsynced;                  // sends and commits since last batched flush
+    std::atomic<int64_t> last_sync;                  // steady clock time of last periodic flush (ns)
+    embedded_mutex pmutex;                           // serializes producers
+    embedded_mutex cmutex;                           // serializes consumers
+    cpen333::impl::futex_eventcount not_full;        // producers waiting for room
+    cpen333::impl::futex_eventcount not_empty;       // consumers waiting for a message
+  };
+
+  std::string filename_;                 // path of backing file
+  int fid_;                              // backing file descriptor, holds our open-file lock
+  void* map_;                            // mapping of whole file
+  size_t map_size_;                      // size of mapping
+  queue_info* info_;                     // queue information, at start of map_
+  MessageType* data_;                    // messages, at info_->data_offset in map_
+  sync_policy policy_;                   // when this process flushes
+  size_t batch_;                         // flush after this many operations, for sync_policy::batched
+  std::chrono::milliseconds period_;     // minimum time between flushes, for sync_policy::periodic
+
+};
+
+} // impl
+} // process
+} // cpen333
+
+// undef local macros
+#undef MESSAGE_QUEUE_FILE_MAGIC
+#undef MESSAGE_QUEUE_FILE_VERSION
+
+#endif // LINUX
+
+#endif //CPEN333_PROCESS_MESSAGE_QUEUE_FILE_H
@@ -0,0 +1,437 @@
+/**
+ * @file
+ * @brief Inter-process message queue with a fixed number of priority lanes
+ */
+#ifndef CPEN333_PROCESS_MESSAGE_QUEUE_PRIORITY_H
+#define CPEN333_PROCESS_MESSAGE_QUEUE_PRIORITY_H
+
+#include "../../os.h"
+
+#ifdef LINUX
+
+/**
+ * @brief Suffix for shared memory to guarantee uniqueness
+ */
+#define MESSAGE_QUEUE_PRIORITY_SUFFIX "_mqp"
+/**
+ * @brief Magic number to test for shared memory initialization
+ */
+#define MESSAGE_QUEUE_PRIORITY_INITIALIZED 0x33198563
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "../../util.h"
+#include "../../impl/futex.h"
+#include "../named_resource.h"
+#include "../shared_memory.h"
+#include "embedded_sync.h"
+#include "shared_layout.h"
+
+namespace cpen333 {
+namespace process {
+namespace impl {
+
+/**
+ * @brief Multi-process message queue with a fixed number of priority lanes
+ *
+ * Each priority level (lane) is its own circular buffer, and all lanes share a single shared memory segment along
+ * with the lock and futex wait queues that protect them.  A bit-mask of non-empty lanes lets a receiver find the
+ * highest non-empty lane with a single bit-scan, so a control message sent at a high priority is received next
+ * no matter how many low-priority messages are queued.  Within a lane, messages are received in the order they were
+ * sent.
+ *
+ * A receiver blocks on a single wait queue that covers all lanes.  A sender only blocks while its own lane is full,
+ * so a flood of bulk messages never stops higher-priority messages from being sent.  Only available on Linux.
+ *
+ * @tparam MessageType fixed type of messages
+ * @tparam Levels number of priority levels, at most 64
+ */
+template<typename MessageType, size_t Levels = 4>
+class message_queue_priority : public virtual named_resource {
+
+  static_assert(Levels > 0 && Levels <= 64, "message_queue_priority supports between 1 and 64 levels");
+
+ public:
+  /**
+   * @brief Message type
+   */
+  typedef MessageType message_type;
+
+  /**
+   * @brief Constructs or connects to a named message queue
+   *
+   * @param name name identifier for creating or connecting to an existing inter-process message queue
+   * @param size if creating, the maximum number of messages in each lane that can be stored without blocking
+   */
+  message_queue_priority(const std::string& name, size_t size = 1024) :
+      memory_(name + std::string(MESSAGE_QUEUE_PRIORITY_SUFFIX), sizeof(queue_info)+Levels*size*sizeof(MessageType)),
+      info_(nullptr), data_(nullptr) {
+
+    // info is at start of memory block, followed by each lane's buffer in turn
+    info_ = (queue_info*)memory_.get();
+    data_ = (MessageType*)memory_.get(sizeof(queue_info));
+
+    bool initialized = initialize_once(info_->initialized, MESSAGE_QUEUE_PRIORITY_INITIALIZED, [&](){
+      info_->layout = CPEN333_PROCESS_LAYOUT_VERSION;
+      info_->size = size;
+      info_->mask.store(0, std::memory_order_relaxed);
+      info_->mutex.init();
+      info_->not_empty.init();
+      for (size_t i=0; i<Levels; ++i) {
+        info_->lanes[i].head = 0;
+        info_->lanes[i].count.store(0, std::memory_order_relaxed);
+        info_->not_full[i].init();
+      }
+    });
+    if (!initialized) {
+      check_layout(info_->layout, name);
+    }
+  }
+
+  /**
+   * @brief Sends a message to the queue
+   *
+   * Blocks while the message's lane is full.
+   *
+   * @param msg message to send
+   * @param priority priority level, in `[0, Levels)`, higher levels are received first.  Larger values are
+   *                 treated as the highest level.
+   */
+  void send(const MessageType& msg, size_t priority = 0) {
+    size_t level = clamp(priority);
+    info_->not_full[level].wait([&](){ return push_message(msg, level); }, true);
+    info_->not_empty.notify_one(true);
+  }
+
+  /**
+   * @brief Tries to send a message without blocking
+   *
+   * @param msg message to send
+   * @param priority priority level, in `[0, Levels)`, higher levels are received first
+   * @return `true` if message sent successfully, `false` if the message's lane is full
+   */
+  bool try_send(const MessageType& msg, size_t priority = 0) {
+    if (!push_message(msg, clamp(priority))) {
+      return false;
+    }
+    info_->not_empty.notify_one(true);
+    return true;
+  }
+
+  /**
+   * @brief Tries to send a message, will wait for a maximum amount of time before aborting
+   *
+   * @tparam Rep timeout duration representation
+   * @tparam Period timeout duration period
+   * @param msg message to send
+   * @param priority priority level, in `[0, Levels)`, higher levels are received first
+   * @param rel_time relative timeout time
+   * @return `true` if the message is sent successfully within the timeout period, `false` if not sent
+   */
+  template <typename Rep, typename Period>
+  bool try_send_for(const MessageType& msg, size_t priority, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_send_until(msg, priority, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @brief Tries to send a message, will wait until a timeout time has been reached before aborting
+   *
+   * @tparam Clock timeout clock type
+   * @tparam Duration timeout duration type
+   * @param msg message to send
+   * @param priority priority level, in `[0, Levels)`, higher levels are received first
+   * @param timeout absolute timeout time
+   * @return `true` if message sent successfully before timeout time has passed, `false` if message not sent
+   */
+  template<typename Clock, typename Duration>
+  bool try_send_until(const MessageType& msg, size_t priority,
+                      const std::chrono::time_point<Clock,Duration>& timeout) {
+    size_t level = clamp(priority);
+    timespec ts = cpen333::impl::monotonic_timespec(timeout);
+    if (!info_->not_full[level].wait_until(ts, [&](){ return push_message(msg, level); }, true)) {
+      return false;
+    }
+    info_->not_empty.notify_one(true);
+    return true;
+  }
+
+  /**
+   * @brief Retrieves and removes the highest-priority message from the queue
+   *
+   * If there are currently no messages in any lane, then the current thread will block until one becomes available.
+   *
+   * @return the next message in the queue
+   */
+  MessageType receive() {
+    MessageType out;
+    receive(&out);
+    return out;
+  }
+
+  /**
+   * @brief Retrieves and removes the highest-priority message from the queue
+   *
+   * If there are currently no messages in any lane, then the current thread will block until one becomes available.
+   *
+   * @param out destination.  If `nullptr`, the message is removed from the queue but not returned
+   * @param priority if not `nullptr`, populated with the priority level the message was sent at
+   */
+  void receive(MessageType* out, size_t* priority = nullptr) {
+    size_t level = 0;
+    info_->not_empty.wait([&](){ return pop_message(out, &level, true); }, true);
+    info_->not_full[level].notify_one(true);
+    if (priority != nullptr) {
+      *priority = level;
+    }
+  }
+
+  /**
+   * @brief Tries to receive the highest-priority message without blocking
+   *
+   * @param out destination.  If `nullptr`, the message is removed but not returned.
+   * @param priority if not `nullptr`, populated with the priority level the message was sent at
+   * @return `true` if a message is returned, `false` if all lanes are empty
+   */
+  bool try_receive(MessageType* out, size_t* priority = nullptr) {
+    size_t level = 0;
+    if (!pop_message(out, &level, true)) {
+      return false;
+    }
+    info_->not_full[level].notify_one(true);
+    if (priority != nullptr) {
+      *priority = level;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Tries to receive the highest-priority message, will wait for a maximum amount of time before aborting
+   *
+   * @tparam Rep duration representation
+   * @tparam Period duration period
+   * @param out destination.  If `nullptr`, the next message is removed but not returned
+   * @param rel_time relative timeout time
+   * @param priority if not `nullptr`, populated with the priority level the message was sent at
+   * @return `true` if message successfully returned, `false` if timeout elapsed
+   */
+  template <typename Rep, typename Period>
+  bool try_receive_for(MessageType* out, const std::chrono::duration<Rep, Period>& rel_time,
+                       size_t* priority = nullptr) {
+    return try_receive_until(out, std::chrono::steady_clock::now()+rel_time, priority);
+  }
+
+  /**
+   * @brief Tries to receive the highest-priority message, will wait until a timeout time before aborting
+   *
+   * @tparam Clock clock type
+   * @tparam Duration clock duration type
+   * @param out destination.  If `nullptr`, the next message is removed but not returned
+   * @param timeout absolute timeout time
+   * @param priority if not `nullptr`, populated with the priority level the message was sent at
+   * @return `true` if message successfully returned, `false` if timeout
+   */
+  template<typename Clock, typename Duration>
+  bool try_receive_until(MessageType* out, const std::chrono::time_point<Clock,Duration>& timeout,
+                         size_t* priority = nullptr) {
+    size_t level = 0;
+    timespec ts = cpen333::impl::monotonic_timespec(timeout);
+    if (!info_->not_empty.wait_until(ts, [&](){ return pop_message(out, &level, true); }, true)) {
+      return false;
+    }
+    info_->not_full[level].notify_one(true);
+    if (priority != nullptr) {
+      *priority = level;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Peeks at the highest-priority message without removing it
+   *
+   * Blocks until a message is available.  The message will remain in the queue for the next `peek` or
+   * `receive` operation.
+   *
+   * @return next message in the queue
+   */
+  MessageType peek() {
+    MessageType out;
+    peek(&out);
+    return out;
+  }
+
+  /**
+   * @brief Peeks at the highest-priority message without removing it
+   *
+   * Blocks until a message is available.  The message will remain in the queue for the next `peek` or
+   * `receive` operation.
+   *
+   * @param out destination.  If `nullptr`, nothing happens.
+   * @param priority if not `nullptr`, populated with the priority level the message was sent at
+   */
+  void peek(MessageType* out, size_t* priority = nullptr) {
+    size_t level = 0;
+    info_->not_empty.wait([&](){ return pop_message(out, &level, false); }, true);
+    info_->not_empty.notify_one(true);  // pass on a wakeup that may have been meant for a receive
+    if (priority != nullptr) {
+      *priority = level;
+    }
+  }
+
+  /**
+   * @brief Tries to peek at the highest-priority message without blocking
+   *
+   * @param out destination.  If `nullptr`, nothing happens.
+   * @param priority if not `nullptr`, populated with the priority level the message was sent at
+   * @return `true` if message was successfully peeked, `false` if all lanes are empty
+   */
+  bool try_peek(MessageType* out, size_t* priority = nullptr) {
+    size_t level = 0;
+    if (!pop_message(out, &level, false)) {
+      return false;
+    }
+    if (priority != nullptr) {
+      *priority = level;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Number of messages currently in the queue, across all lanes
+   *
+   * This method should be used sparingly, since messages could be added/removed during or immediately after the call,
+   * making the result potentially unreliable.
+   *
+   * @return number of messages
+   */
+  size_t size() {
+    size_t total = 0;
+    for (size_t i=0; i<Levels; ++i) {
+      total += info_->lanes[i].count.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  /**
+   * @brief Number of messages currently in one lane
+   * @param priority priority level, in `[0, Levels)`
+   * @return number of messages in the lane
+   */
+  size_t size(size_t priority) {
+    return info_->lanes[clamp(priority)].count.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Check if all lanes are currently empty
+   * @return `true` if empty, `false` otherwise
+   */
+  bool empty() {
+    return info_->mask.load(std::memory_order_acquire) == 0;
+  }
+
+  /**
+   * @brief Number of priority levels
+   * @return `Levels`
+   */
+  static constexpr size_t levels() {
+    return Levels;
+  }
+
+  bool unlink() {
+    return memory_.unlink();
+  }
+
+  /**
+   * @copydoc cpen333::process::named_resource::unlink(const std::string&)
+   */
+  static bool unlink(const std::string& name) {
+    return cpen333::process::shared_memory::unlink(name + std::string(MESSAGE_QUEUE_PRIORITY_SUFFIX));
+  }
+
+ private:
+
+  static size_t clamp(size_t priority) {
+    return priority < Levels ? priority : Levels-1;
+  }
+
+  // index of highest set bit, mask must be non-zero
+  static size_t highest(uint64_t mask) {
+    return 63 - (size_t)__builtin_clzll(mask);
+  }
+
+  bool push_message(const MessageType& msg, size_t level) {
+    std::lock_guard<embedded_mutex> lock(info_->mutex);
+    lane_info& lane = info_->lanes[level];
+    size_t count = lane.count.load(std::memory_order_relaxed);
+    if (count == info_->size) {
+      return false;
+    }
+    data_[level*info_->size + (lane.head+count) % info_->size] = msg;
+    lane.count.store(count+1, std::memory_order_relaxed);
+    info_->mask.fetch_or(uint64_t(1) << level, std::memory_order_release);
+    return true;
+  }
+
+  bool pop_message(MessageType* out, size_t* level, bool remove) {
+    std::lock_guard<embedded_mutex> lock(info_->mutex);
+    uint64_t mask = info_->mask.load(std::memory_order_relaxed);
+    if (mask == 0) {
+      return false;
+    }
+    size_t l = highest(mask);
+    lane_info& lane = info_->lanes[l];
+    if (out != nullptr) {
+      *out = data_[l*info_->size + lane.head];
+    }
+    if (remove) {
+      lane.head = (lane.head+1) % info_->size;
+      size_t count = lane.count.load(std::memory_order_relaxed)-1;
+      lane.count.store(count, std::memory_order_relaxed);
+      if (count == 0) {
+        info_->mask.fetch_and(~(uint64_t(1) << l), std::memory_order_release);
+      }
+    }
+    *level = l;
+    return true;
+  }
+
+  struct lane_info {
+    size_t head;                                         // index of oldest message in lane
+    std::atomic<size_t> count;                           // number of messages in lane
+  };
+
+  struct queue_info {
+    std::atomic<uint32_t> initialized;                   // magic initialized marker
+    uint32_t layout;                                     // layout version
+    size_t size;                                         // size of each lane (in counts of MessageType)
+    char pad0[CPEN333_CACHE_LINE_SIZE];
+    std::atomic<uint64_t> mask;                          // bit i set if lane i is non-empty
+    embedded_mutex mutex;                                // protects lanes
+    lane_info lanes[Levels];
+    char pad1[CPEN333_CACHE_LINE_SIZE];
+    cpen333::impl::futex_eventcount not_empty;           // receivers waiting for a message in any lane
+    char pad2[CPEN333_CACHE_LINE_SIZE];
+    cpen333::impl::futex_eventcount not_full[Levels];    // senders waiting for room in each lane
+    char pad3[CPEN333_CACHE_LINE_SIZE];
+  };
+
+  cpen333::process::shared_memory memory_;   // actual memory
+  queue_info* info_;                         // pointer to queue information, at start of memory_
+  MessageType* data_;                        // pointer to lane buffers, after info_ in memory
+
+};
+
+} // impl
+} // process
+} // cpen333
+
+// undef local macros
+#undef MESSAGE_QUEUE_PRIORITY_SUFFIX
+#undef MESSAGE_QUEUE_PRIORITY_INITIALIZED
+
+#endif // LINUX
+
+#endif //CPEN333_PROCESS_MESSAGE_QUEUE_PRIORITY_H
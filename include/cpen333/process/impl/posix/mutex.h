@@ -20,6 +20,9 @@
 #include "../../../util.h"
 #include "semaphore.h"
 #include "../named_resource_base.h"
+#ifdef CPEN333_PROFILE_LOCKS
+#include "../lock_profile.h"
+#endif
 
 namespace cpen333 {
 namespace process {
@@ -162,6 +165,17 @@ class mutex : public impl::named_resource_base {
 
 } // native implementation
 
+#ifdef CPEN333_PROFILE_LOCKS
+/**
+ * @brief Alias to POSIX implementation of inter-process mutex, recording contention statistics
+ */
+using mutex = impl::profiled_mutex<posix::mutex>;
+
+/**
+ * @brief Alias to POSIX implementation of inter-process mutex allowing timed waits, recording contention statistics
+ */
+using timed_mutex = impl::profiled_mutex<posix::mutex>;
+#else
 /**
  * @brief Alias to POSIX implementation of inter-process mutex
  */
@@ -171,6 +185,7 @@ using mutex = posix::mutex;
  * @brief Alias to POSIX implementation of inter-process mutex allowing timed waits
  */
 using timed_mutex = posix::mutex;
+#endif
 
 } // process
 } // cpen333
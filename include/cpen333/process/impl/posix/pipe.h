@@ -14,7 +14,7 @@
 #include <thread>
 #include <chrono>
 
-#include "mutex.h"
+#include "../../mutex.h"
 #include "../named_resource_base.h"
 #include "../../../util.h"
 
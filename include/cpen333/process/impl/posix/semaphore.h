@@ -14,12 +14,13 @@
 
 #include <string>
 #include <chrono>
-#include <thread>       // for yield
+#include <cerrno>
 #include <fcntl.h>      // for O_* constants
 #include <sys/stat.h>   // for mode constants
 #include <semaphore.h>
 
 #include "../../../util.h"
+#include "../../../impl/deadline.h"
 #include "../named_resource_base.h"
 
 #ifdef APPLE
@@ -114,7 +115,6 @@ class semaphore : public impl::named_resource_base {
     // continuously loop until we have the lock
     do {
       success = sem_wait(handle_);
-      std::this_thread::yield();   // yield to prevent from hogging resources
     } while (success == -1 && errno == EINTR);
     if (success != 0) {
       cpen333::perror(std::string("Failed to wait on semaphore ")+name());
@@ -150,6 +150,24 @@ class semaphore : public impl::named_resource_base {
     }
   }
 
+  /**
+   * @brief Increments the semaphore value by a given count
+   *
+   * Equivalent to calling notify() `count` times, waking up to `count` waiting processes or threads.  POSIX
+   * semaphores have no multi-count post, so this makes one `sem_post` call per count.
+   *
+   * @param count amount to increment the semaphore by
+   */
+  void notify(size_t count) {
+    // POSIX semaphores can only be posted one at a time
+    for (size_t i=0; i<count; ++i) {
+      if (sem_post(handle_) != 0) {
+        cpen333::perror(std::string("Failed to post semaphore ")+name());
+        return;
+      }
+    }
+  }
+
   /**
    * @brief Tries to wait for the semaphore for up to a maximum timeout duration
    *
@@ -170,7 +188,8 @@ class semaphore : public impl::named_resource_base {
    * @brief Tries to wait for the semaphore for up to a maximum absolute time
    *
    * If the semaphore's value is greater than zero, will decrement it and return true immediately.  Otherwise,
-   * will wait (blocking) up to a maximum relative timeout period.
+   * will wait (blocking) until the timeout time has been reached.  Where the C library supports it, the wait is
+   * measured against CLOCK_MONOTONIC, so it is not affected by changes to the system time.
    *
    * @tparam Clock timeout clock type
    * @tparam Duration timeout duration type
@@ -179,16 +198,22 @@ class semaphore : public impl::named_resource_base {
    */
   template< class Clock, class Duration >
   bool wait_until( const std::chrono::time_point<Clock,Duration>& timeout_time ) {
-    auto duration = timeout_time.time_since_epoch();
-    auto sec = std::chrono::duration_cast<std::chrono::seconds>(duration);
-    timespec ts;
-    ts.tv_sec = sec.count();
-    ts.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(duration-sec).count();
-    int success = sem_timedwait(handle_, &ts);
-    if (errno == EINVAL) {
+    int status;
+#ifdef CPEN333_HAS_CLOCKWAIT
+    timespec ts = cpen333::impl::monotonic_timespec(timeout_time);
+    do {
+      status = sem_clockwait(handle_, CLOCK_MONOTONIC, &ts);
+    } while (status != 0 && errno == EINTR);
+#else
+    timespec ts = cpen333::impl::realtime_timespec(timeout_time);
+    do {
+      status = sem_timedwait(handle_, &ts);
+    } while (status != 0 && errno == EINTR);
+#endif
+    if (status != 0 && errno != ETIMEDOUT) {
       cpen333::perror(std::string("Failed to wait on semaphore ")+name());
     }
-    return (success == 0);
+    return (status == 0);
   }
 
   /**
@@ -12,12 +12,13 @@
  */
 #define SHARED_MEMORY_NAME_SUFFIX "_shm"
 
+#include <cerrno>
+#include <chrono>
 #include <string>
-#include <mutex>  // for lock
+#include <thread>
 
 #include "../../../util.h"
 #include "../named_resource_base.h"
-#include "mutex.h"
 
 #include <unistd.h>
 #include <sys/types.h>
@@ -62,32 +63,42 @@ class shared_memory : public impl::named_resource_base {
     int mode = S_IRWXU | S_IRWXG; // user/group +rw permissions
     errno = 0;
 
-    {
-      // protect initialization
-      cpen333::process::mutex mutex(name + std::string(SHARED_MEMORY_NAME_SUFFIX));
-      std::lock_guard<cpen333::process::mutex> lock(mutex);
+    // exclusive create decides who initializes, so no separate named lock is needed to attach
+    fid_ = shm_open(id_ptr(), O_RDWR | O_CREAT | O_EXCL, mode);
+    if (fid_ < 0 && errno == EEXIST) {
+      // create for open
+      initialize = false;
+      fid_ = shm_open(id_ptr(), readonly ? O_RDONLY : O_RDWR, mode);
+    }
 
-      fid_ = shm_open(id_ptr(), O_RDWR | O_CREAT | O_EXCL, mode);
-      if (fid_ < 0 && errno == EEXIST) {
-        // create for open
-        initialize = false;
-        fid_ = shm_open(id_ptr(), readonly ? O_RDONLY : O_RDWR, mode);
-      }
+    if (fid_ < 0) {
+      cpen333::perror(std::string("Cannot create shared memory with id ") + this->name());
+      return;
+    }
 
-      if (fid_ < 0) {
-        cpen333::perror(std::string("Cannot create shared memory with id ") + this->name());
+    // truncate and initialize
+    if (initialize) {
+      int resize = ftruncate(fid_, size_);
+      if (resize < 0) {
+        cpen333::perror(std::string("Cannot allocate shared memory with id ") + this->name());
         return;
       }
-
-      // truncate and initialize
-      if (initialize) {
-        int resize = ftruncate(fid_, size_);
-        if (resize < 0) {
-          cpen333::perror(std::string("Cannot allocate shared memory with id ") + this->name());
+    } else {
+      // creator may not have sized the block yet, wait until it has so we never map past the end
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CPEN333_ATTACH_TIMEOUT_MS);
+      struct stat info;
+      while (fstat(fid_, &info) == 0 && info.st_size == 0) {
+        if (std::chrono::steady_clock::now() > deadline) {
+          errno = ETIMEDOUT;  // creator most likely died before sizing it
+          cpen333::perror(std::string("Timed out waiting for shared memory to be allocated with id ")
+                              + this->name());
+          ::close(fid_);
+          fid_ = -1;
           return;
         }
+        std::this_thread::yield();
       }
-    } // end of critical section
+    }
 
     int flags = readonly ? PROT_READ : PROT_WRITE;
     data_ = mmap(nullptr, size_, flags, MAP_SHARED, fid_, 0);
@@ -212,7 +212,7 @@ class subprocess {
       }
 
       std::this_thread::yield();  // yield to other threads to prevent excessive polling
-    } while (r != pid_ && std::chrono::steady_clock::now() < timeout_time);
+    } while (r != pid_ && Clock::now() < timeout_time);
 
     if ( r == pid_ && WIFEXITED(status) ) {
       terminated_ = true;
@@ -0,0 +1,60 @@
+/**
+ * @file
+ * @brief Layout versioning for control blocks stored in shared memory
+ */
+#ifndef CPEN333_PROCESS_SHARED_LAYOUT_H
+#define CPEN333_PROCESS_SHARED_LAYOUT_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include "../../util.h"
+
+/**
+ * @brief Version of the layout of shared control blocks
+ *
+ * Stored in every versioned control block right after its initialization marker, and bumped whenever a block's
+ * fields are rearranged so that processes built against different layouts do not silently corrupt each other.
+ */
+#define CPEN333_PROCESS_LAYOUT_VERSION 2
+
+namespace cpen333 {
+namespace process {
+
+/**
+ * @brief Thrown when connecting to a named resource whose shared memory or file was laid out by an incompatible build
+ */
+class layout_error : public std::runtime_error {
+ public:
+  /**
+   * @brief Constructs the error
+   * @param msg description of the mismatch
+   */
+  explicit layout_error(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+namespace impl {
+
+/**
+ * @brief Checks that an already-initialized control block uses this build's layout
+ *
+ * The fields of a block with a different layout cannot be interpreted, so connecting to it fails: the error is
+ * printed and a cpen333::process::layout_error is thrown from the resource's constructor.
+ *
+ * @param layout layout version read from the control block
+ * @param name name of the resource, for the error message
+ */
+inline void check_layout(uint32_t layout, const std::string& name) {
+  if (layout != CPEN333_PROCESS_LAYOUT_VERSION) {
+    std::string msg = std::string("Incompatible shared memory layout for ") + name + " (version "
+        + std::to_string(layout) + ", expected " + std::to_string(CPEN333_PROCESS_LAYOUT_VERSION) + ")";
+    cpen333::error(msg);
+    throw layout_error(msg);
+  }
+}
+
+} // impl
+} // process
+} // cpen333
+
+#endif //CPEN333_PROCESS_SHARED_LAYOUT_H
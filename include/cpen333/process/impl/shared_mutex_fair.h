@@ -20,6 +20,7 @@
 #include "../condition_variable.h"
 #include "../shared_memory.h"
 #include "../named_resource.h"
+#include "shared_layout.h"
 
 namespace cpen333 {
 namespace process {
@@ -36,13 +37,18 @@ namespace impl {
 class shared_mutex_fair : public virtual named_resource {
  private:
 
+  // reader and writer state are on separate cache lines
   struct shared_data {
+    uint32_t initialized;
+    uint32_t layout;    // layout version
+    char pad0[CPEN333_CACHE_LINE_SIZE-2*sizeof(uint32_t)];
     size_t shared[2];   // readers or queued
     char this_batch;    // index within shared of current batch sharing access
     char next_batch;    // index within shared of next batch to push, 1-this_batch
+    char pad1[CPEN333_CACHE_LINE_SIZE-2*sizeof(size_t)-2*sizeof(char)];
     char exclusive;     // # exclusive access, 0 or 1
     size_t etotal;      // waiting and exclusive acces
-    size_t initialized;
+    char pad2[CPEN333_CACHE_LINE_SIZE-2*sizeof(size_t)];
   };
 
   cpen333::process::mutex mutex_;               // mutex for state access
@@ -69,7 +75,10 @@ class shared_mutex_fair : public virtual named_resource {
       state_->next_batch = 1;
       state_->exclusive = 0;
       state_->etotal = 0;
+      state_->layout = CPEN333_PROCESS_LAYOUT_VERSION;
       state_->initialized = SHARED_MUTEX_FAIR_INITIALIZED;
+    } else {
+      check_layout(state_->layout, name);
     }
   }
 
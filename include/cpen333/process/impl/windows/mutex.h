@@ -24,6 +24,9 @@
 
 #include "../../../util.h"
 #include "../named_resource_base.h"
+#ifdef CPEN333_PROFILE_LOCKS
+#include "../lock_profile.h"
+#endif
 
 namespace cpen333 {
 namespace process {
@@ -97,7 +100,14 @@ class mutex : public impl::named_resource_base {
    */
   template< class Rep, class Period >
   bool try_lock_for( const std::chrono::duration<Rep,Period>& timeout_duration ) {
-    DWORD time = (DWORD)(std::chrono::duration_cast<std::chrono::milliseconds>(timeout_duration).count());
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(timeout_duration);
+    if (ms < timeout_duration) {
+      ++ms;  // round up so the wait never ends early
+    }
+    if (ms.count() < 0) {
+      ms = std::chrono::milliseconds(0);
+    }
+    DWORD time = (DWORD)ms.count();
     UINT result = WaitForSingleObject(handle_, time) ;
     if (result == WAIT_FAILED) {
       cpen333::perror(std::string("Failed to lock mutex "+name()));
@@ -111,13 +121,7 @@ class mutex : public impl::named_resource_base {
    */
   template< class Clock, class Duration >
   bool try_lock_until( const std::chrono::time_point<Clock,Duration>& timeout_time ) {
-    auto duration = timeout_time - std::chrono::steady_clock::now();
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration);
-
-    if (ms.count() < 0) {
-      ms = std::chrono::milliseconds(0);
-    }
-    return try_lock_for(ms);
+    return try_lock_for(timeout_time - Clock::now());
   }
 
   /**
@@ -161,6 +165,17 @@ class mutex : public impl::named_resource_base {
 
 } // native implementation
 
+#ifdef CPEN333_PROFILE_LOCKS
+/**
+ * @brief Alias to Windows implementation of a named mutex, recording contention statistics
+ */
+typedef impl::profiled_mutex<windows::mutex> mutex;
+
+/**
+ * @brief Alias to Windows implementation of a named mutex allowing timed waits, recording contention statistics
+ */
+typedef impl::profiled_mutex<windows::mutex> timed_mutex;
+#else
 /**
  * @brief Alias to Windows implementation of a named mutex
  */
@@ -171,6 +186,7 @@ typedef windows::mutex mutex;
  * @brief Alias to Windows implementation of a named mutex allowing timed waits
  */
 typedef windows::mutex timed_mutex;
+#endif
 
 } // process
 } // cpen333
@@ -130,10 +130,14 @@ class semaphore : public impl::named_resource_base {
    */
   template< class Rep, class Period >
   bool wait_for( const std::chrono::duration<Rep,Period>& timeout_duration ) {
-    DWORD time = (DWORD)(std::chrono::duration_cast<std::chrono::milliseconds>(timeout_duration).count());
-    if (time < 0) {
-      time = 0;
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(timeout_duration);
+    if (ms < timeout_duration) {
+      ++ms;  // round up so the wait never ends early
     }
+    if (ms.count() < 0) {
+      ms = std::chrono::milliseconds(0);
+    }
+    DWORD time = (DWORD)ms.count();
     UINT result = WaitForSingleObject(handle_, time) ;
     if (result == WAIT_FAILED) {
       cpen333::perror(std::string("Failed to wait for semaphore ")+name());
@@ -147,7 +151,7 @@ class semaphore : public impl::named_resource_base {
    */
   template< class Clock, class Duration >
   bool wait_until( const std::chrono::time_point<Clock,Duration>& timeout_time ) {
-    auto duration = timeout_time - std::chrono::steady_clock::now();
+    auto duration = timeout_time - Clock::now();
     return wait_for(duration);
   }
 
@@ -161,6 +165,19 @@ class semaphore : public impl::named_resource_base {
     }
   }
 
+  /**
+   * @copydoc cpen333::process::posix::semaphore::notify(size_t)
+   */
+  void notify(size_t count) {
+    if (count == 0) {
+      return;
+    }
+    BOOL success = ReleaseSemaphore(handle_, (LONG)count, NULL) ;  // FALSE on failure, TRUE on success
+    if (!success) {
+      cpen333::perror(std::string("Failed to post semaphore ")+name());
+    }
+  }
+
   /**
    * @brief Returns a native handle to the semaphore
    *
@@ -176,11 +176,11 @@ class subprocess {
    */
   template< class Clock, class Duration >
   bool wait_until( const std::chrono::time_point<Clock,Duration>& timeout_time ) {
-    auto now = std::chrono::steady_clock::now();
+    auto now = Clock::now();
     DWORD time = 0;
     if (timeout_time > now) {
       // convert to milliseconds
-      DWORD time = std::chrono::duration_cast<std::chrono::milliseconds>(timeout_time-now).count();
+      time = (DWORD)std::chrono::duration_cast<std::chrono::milliseconds>(timeout_time-now).count();
     }
     return wait_for_internal(time);
   }
@@ -13,8 +13,13 @@
 
 #include <string>
 #include <chrono>
+#include <vector>
+#include "../os.h"
 #include "fifo.h"
 #include "named_resource.h"
+#include "impl/message_queue_bytes.h"
+#include "impl/message_queue_file.h"
+#include "impl/message_queue_priority.h"
 
 namespace cpen333 {
 namespace process {
@@ -26,6 +31,10 @@ namespace process {
  * thread ID of the receiver, but also does not allow filtering on the receiving end.  Unlike a POSIX message queue,
  * does not allow variable length messages or message priorities.
  *
+ * Batches sent or received with send_n() or receive_n() are copied in a single critical section.  Messages are
+ * stored in a cpen333::process::fifo, whose named semaphores are still adjusted once per message; for batches that
+ * wake waiting processes with a single call, use a cpen333::process::compact_fifo directly.
+ *
  * @tparam MessageType fixed type of messages.
  */
 template<typename MessageType>
@@ -79,7 +88,7 @@ class message_queue : public virtual named_resource {
    * @return `true` if the message is sent successfully within the timeout period, `false` if not sent
    */
   template <typename Rep, typename Period>
-  bool try_send_for(const MessageType& msg, std::chrono::duration<Rep, Period>& rel_time) {
+  bool try_send_for(const MessageType& msg, const std::chrono::duration<Rep, Period>& rel_time) {
     return try_send_until(msg, std::chrono::steady_clock::now()+rel_time);
   }
 
@@ -100,6 +109,32 @@ class message_queue : public virtual named_resource {
     return fifo_.try_push_until(msg, timeout);
   }
 
+  /**
+   * @brief Sends a batch of messages to the queue
+   *
+   * Messages are sent in order.  Whenever the queue is full, this will block until room becomes available, then
+   * sends as many of the remaining messages as fit in a single critical section.
+   *
+   * @param msgs pointer to the first message to send
+   * @param n number of messages to send
+   */
+  void send_n(const MessageType* msgs, size_t n) {
+    fifo_.push_n(msgs, n);
+  }
+
+  /**
+   * @brief Tries to send a batch of messages without blocking
+   *
+   * Sends as many messages from the front of the batch as there is currently room for.
+   *
+   * @param msgs pointer to the first message to send
+   * @param n number of messages to send
+   * @return number of messages sent, which may be less than `n`
+   */
+  size_t try_send_n(const MessageType* msgs, size_t n) {
+    return fifo_.try_push_n(msgs, n);
+  }
+
   /**
    * @brief Retrieves and removes the next message from the message queue
    *
@@ -137,6 +172,45 @@ class message_queue : public virtual named_resource {
     return fifo_.try_pop(out);
   }
 
+  /**
+   * @brief Retrieves and removes a batch of messages from the queue
+   *
+   * If there are currently no messages in the queue, then the current thread will block until one becomes
+   * available.  Then removes as many messages as are available, up to `n`, in a single critical section.
+   *
+   * @param out destination array with room for at least `n` messages.  If `nullptr`, messages are removed but not
+   *            returned.
+   * @param n maximum number of messages to receive
+   * @return number of messages received, between 1 and `n`
+   */
+  size_t receive_n(MessageType* out, size_t n) {
+    return fifo_.pop_n(out, n);
+  }
+
+  /**
+   * @brief Tries to receive a batch of messages without blocking
+   *
+   * @param out destination array with room for at least `n` messages.  If `nullptr`, messages are removed but not
+   *            returned.
+   * @param n maximum number of messages to receive
+   * @return number of messages received, 0 if the queue is empty
+   */
+  size_t try_receive_n(MessageType* out, size_t n) {
+    return fifo_.try_pop_n(out, n);
+  }
+
+  /**
+   * @brief Receives all messages currently in the queue without blocking
+   *
+   * Appends the messages to the end of `out` in order.
+   *
+   * @param out destination container
+   * @return number of messages received, 0 if the queue is empty
+   */
+  size_t try_receive_all(std::vector<MessageType>& out) {
+    return fifo_.try_pop_all(out);
+  }
+
   /**
    * @brief Tries to receive a message, will wait for a maximum amount of time before aborting
    *
@@ -150,7 +224,7 @@ class message_queue : public virtual named_resource {
    * @return `true` if message successfully returned, `false` if timeout elapsed
    */
   template <typename Rep, typename Period>
-  bool try_receive_for(MessageType* out, std::chrono::duration<Rep, Period>& rel_time) {
+  bool try_receive_for(MessageType* out, const std::chrono::duration<Rep, Period>& rel_time) {
     return try_receive_until(out, std::chrono::steady_clock::now()+rel_time);
   }
 
@@ -224,7 +298,7 @@ class message_queue : public virtual named_resource {
    * @return `true` if message successfully peeked, `false` if timeout elapsed
    */
   template <typename Rep, typename Period>
-  bool try_peek_for(MessageType* out, std::chrono::duration<Rep, Period>& rel_time) {
+  bool try_peek_for(MessageType* out, const std::chrono::duration<Rep, Period>& rel_time) {
     return try_peek_until(out, std::chrono::steady_clock::now()+rel_time);
   }
 
@@ -286,6 +360,47 @@ class message_queue : public virtual named_resource {
 
 };
 
+#ifdef LINUX
+/**
+ * @brief Message queue for variable-length messages
+ *
+ * Alias to cpen333::process::impl::message_queue_bytes.  Messages are stored as length-prefixed records in a
+ * ring of bytes, so each takes only as much room as it needs rather than a fixed-size slot.  Only available on
+ * Linux.
+ */
+using byte_message_queue = impl::message_queue_bytes;
+
+/**
+ * @brief Message queue with a fixed number of priority lanes
+ *
+ * Alias to cpen333::process::impl::message_queue_priority.  Messages are sent with a priority level, and receivers
+ * always take the oldest message from the highest non-empty level, blocking on a single wait that covers all levels.
+ * All levels live in one shared memory segment.  Only available on Linux.
+ *
+ * @tparam MessageType fixed type of messages
+ * @tparam Levels number of priority levels, at most 64
+ */
+template<typename MessageType, size_t Levels = 4>
+using priority_message_queue = impl::message_queue_priority<MessageType, Levels>;
+
+/**
+ * @brief When a cpen333::process::persistent_message_queue flushes its file to disk
+ */
+using sync_policy = impl::sync_policy;
+
+/**
+ * @brief Message queue stored in a memory-mapped file, so its contents survive a restart
+ *
+ * Alias to cpen333::process::impl::message_queue_file.  Received messages are only consumed for good once
+ * committed, and a consumer restarting after a crash or reboot resumes from its last committed message.  Only
+ * available on Linux.
+ *
+ * @tparam MessageType fixed type of messages, must be trivially copyable
+ */
+template<typename MessageType>
+using persistent_message_queue = impl::message_queue_file<MessageType>;
+#endif
+
 } // process
 } // namespace
 
@@ -11,6 +11,8 @@
 #include "../os.h"
 #ifdef WINDOWS
 #include "impl/windows/mutex.h"
+#elif defined(LINUX)
+#include "impl/futex/mutex.h"
 #else
 #include "impl/posix/mutex.h"
 #endif
@@ -19,8 +21,9 @@
  * @class cpen333::process::mutex
  * @brief An inter-process mutual exclusion synchronization primitive
  *
- * Used to protect access to a resource shared by multiple processes.  This is an alias to either
- * cpen333::process::posix::mutex or cpen333::process::windows::mutex depending on your platform.
+ * Used to protect access to a resource shared by multiple processes.  This is an alias to
+ * cpen333::process::futex::mutex on Linux, cpen333::process::windows::mutex on Windows, or
+ * cpen333::process::posix::mutex otherwise.
  */
 
 #endif //CPEN333_PROCESS_MUTEX_H
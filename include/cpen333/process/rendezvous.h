@@ -5,6 +5,12 @@
 #ifndef CPEN333_PROCESS_RENDEZVOUS_H
 #define CPEN333_PROCESS_RENDEZVOUS_H
 
+#include "../os.h"
+
+#ifdef LINUX
+#include "impl/futex/rendezvous.h"
+#else
+
 /**
  * @brief Suffix to add to the rendezvous' name for uniqueness
  */
@@ -12,12 +18,14 @@
 /**
  * @brief Magic number to ensure rendezvous is initialized
  */
-#define RENDEZVOUS_INITIALIZED 0x38973823
+#define RENDEZVOUS_INITIALIZED 0x38973825
+
+#include <chrono>
 
 #include "named_resource.h"
 #include "shared_memory.h"
-#include "semaphore.h"
 #include "mutex.h"
+#include "impl/condition_base.h"
 
 namespace cpen333 {
 namespace process {
@@ -26,19 +34,27 @@ namespace process {
  * @brief Inter-process rendezvous implementation
  *
  * A synchronization primitive that allows a certain number of threads/processes to wait for others to arrive, then
- * proceed together.
+ * proceed together.  The rendezvous can be reused for any number of rounds: each round has a generation number,
+ * and waiters wait for the generation they arrived in to end, so a fast process cannot run ahead into the next
+ * round.  Arriving and waiting can be separated (see arrive() and wait(arrival_token)) so that a process can do
+ * useful work while the others catch up.
  */
-class rendezvous : public virtual named_resource {
+class rendezvous : private condition_base, public virtual named_resource {
 
  public:
+  /**
+   * @brief Identifies the round a process arrived in, for waiting for that round to end
+   */
+  using arrival_token = size_t;
+
   /**
    * @brief Creates or connects to a named rendezvous primitive
    * @param name  identifier for creating or connecting to an existing inter-process rendezvous
    * @param size  number of processes in group
    */
   rendezvous(const std::string &name, size_t size) :
+      condition_base(name + std::string(RENDEZVOUS_NAME_SUFFIX)),
       shared_(name + std::string(RENDEZVOUS_NAME_SUFFIX)),
-      semaphore_(name + std::string(RENDEZVOUS_NAME_SUFFIX), 0),
       mutex_(name + std::string(RENDEZVOUS_NAME_SUFFIX)){
 
     // initialize data
@@ -46,6 +62,7 @@ class rendezvous : public virtual named_resource {
     if (shared_->initialized != RENDEZVOUS_INITIALIZED) {
       shared_->size = size;
       shared_->count = size;
+      shared_->generation = 0;
       shared_->initialized = RENDEZVOUS_INITIALIZED;
     }
 
@@ -55,33 +72,118 @@ class rendezvous : public virtual named_resource {
    * @brief Waits until all other processes are also waiting
    *
    * Will cause the current process to block until all (# size) processes are waiting, then will release so that
-   * the processes are synchronized.
+   * the processes are synchronized.  Equivalent to `wait(arrive())`.
    */
   void wait() {
-    // lock shared data to prevent concurrent modification
+    wait(arrive());
+  }
+
+  /**
+   * @brief Arrives at the rendezvous without waiting for the others
+   *
+   * If this is the last process to arrive, releases all those waiting and starts the next round.
+   *
+   * @return token to pass to wait(arrival_token) to wait for the others
+   */
+  arrival_token arrive() {
+    arrival_token token;
+    {
+      std::lock_guard<decltype(mutex_)> lock(mutex_);
+      token = shared_->generation;
+      if (shared_->count == 0) {
+        return token-1;  // empty group, no-one to wait for
+      }
+      if (--(shared_->count) > 0) {
+        return token;
+      }
+      // last to arrive, start the next round
+      shared_->count = shared_->size;
+      ++(shared_->generation);
+    }
+    condition_base::notify_all();
+    return token;
+  }
+
+  /**
+   * @brief Waits for the round identified by a token to end
+   *
+   * Returns immediately if all processes have already arrived.
+   *
+   * @param token token returned by arrive()
+   */
+  void wait(arrival_token token) {
     std::unique_lock<decltype(mutex_)> lock(mutex_);
-    if (shared_->count == 0) {
-      return;  // no need to wait
+    while (shared_->generation == token) {
+      condition_base::wait(lock, false, std::chrono::steady_clock::now());
     }
+  }
 
-    if (--(shared_->count) == 0) {
-      // reset count
-      shared_->count = shared_->size;
-      // release size-1 (since we are the last to arrive)
-      auto release = (shared_->size)-1;
-      for (size_t i=0; i<release; ++i) {
-        semaphore_.notify();
+  /**
+   * @brief Waits for the round identified by a token to end, or for a timeout period to elapse
+   *
+   * A process that times out has still arrived, so the round can still end without it; wait again with the
+   * same token to continue waiting.
+   *
+   * @tparam Rep duration representation
+   * @tparam Period duration period
+   * @param token token returned by arrive()
+   * @param rel_time maximum relative time to wait
+   * @return `true` if the round has ended, `false` on timeout
+   */
+  template<class Rep, class Period>
+  bool wait_for(arrival_token token, const std::chrono::duration<Rep, Period>& rel_time) {
+    return wait_until(token, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @brief Waits for the round identified by a token to end, or for a timeout time to be reached
+   *
+   * A process that times out has still arrived; wait again with the same token to continue waiting.
+   *
+   * @tparam Clock clock type
+   * @tparam Duration clock duration type
+   * @param token token returned by arrive()
+   * @param timeout_time absolute timeout time
+   * @return `true` if the round has ended, `false` on timeout
+   */
+  template<class Clock, class Duration>
+  bool wait_until(arrival_token token, const std::chrono::time_point<Clock, Duration>& timeout_time) {
+    std::unique_lock<decltype(mutex_)> lock(mutex_, std::defer_lock);
+    if (!lock.try_lock_until(timeout_time)) {
+      return false;
+    }
+    while (shared_->generation == token) {
+      if (!condition_base::wait(lock, true, timeout_time)) {
+        return shared_->generation != token;
       }
-    } else {
-      // unlock shared data and wait
-      lock.unlock();
-      semaphore_.wait();
     }
+    return true;
+  }
+
+  /**
+   * @brief Arrives at the rendezvous and leaves the group
+   *
+   * Counts as an arrival for the current round, but the group is one process smaller in all later rounds.
+   */
+  void arrive_and_drop() {
+    {
+      std::lock_guard<decltype(mutex_)> lock(mutex_);
+      if (shared_->count == 0) {
+        return;
+      }
+      --(shared_->size);
+      if (--(shared_->count) > 0) {
+        return;
+      }
+      shared_->count = shared_->size;
+      ++(shared_->generation);
+    }
+    condition_base::notify_all();
   }
 
   bool unlink() {
     bool b1 = shared_.unlink();
-    bool b2 = semaphore_.unlink();
+    bool b2 = condition_base::unlink();
     bool b3 = mutex_.unlink();
     return b1 && b2 && b3;
   }
@@ -92,7 +194,7 @@ class rendezvous : public virtual named_resource {
   static bool unlink(const std::string& name) {
 
     bool b1 = cpen333::process::shared_object<shared_data>::unlink(name + std::string(RENDEZVOUS_NAME_SUFFIX));
-    bool b2 = cpen333::process::semaphore::unlink(name + std::string(RENDEZVOUS_NAME_SUFFIX));
+    bool b2 = cpen333::process::condition_base::unlink(name + std::string(RENDEZVOUS_NAME_SUFFIX));
     bool b3 = cpen333::process::mutex::unlink(name + std::string(RENDEZVOUS_NAME_SUFFIX));
 
     return b1 && b2 && b3;
@@ -104,9 +206,9 @@ class rendezvous : public virtual named_resource {
     size_t size;
     size_t count;
     int initialized;
+    size_t generation;
   };
   cpen333::process::shared_object<shared_data> shared_;
-  cpen333::process::semaphore semaphore_;
   cpen333::process::mutex mutex_;
 
 };
@@ -118,4 +220,6 @@ class rendezvous : public virtual named_resource {
 #undef RENDEZVOUS_NAME_SUFFIX
 #undef RENDEZVOUS_INITIALIZED
 
+#endif // LINUX
+
 #endif //CPEN333_PROCESS_RENDEZVOUS_H
@@ -7,20 +7,35 @@
 
 #include <string>
 #include <chrono>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "../util.h"
 
 #include <mutex>
 #include "semaphore.h"
+#include "impl/fifo_lockfree.h"
+#include "impl/fifo_spsc.h"
+#include "impl/fifo_unbounded.h"
+#include "impl/select_registry.h"
 
 namespace cpen333 {
 namespace thread {
 
+// forward declaration for friendship
+class selector;
+
 /**
  * @brief Simple thread-safe first-in-first-out queue using a circular buffer.
  *
  * The buffer can only contain a single type of object.  Push will block until space is available
  * in the queue.  Pop will block until there is an item in the queue.
  *
+ * Slots are raw storage: an item is only constructed when it is pushed (or emplaced), and is destroyed
+ * when it is popped.  The value type therefore does not need to be default-constructible, and may be move-only
+ * if only the move/emplace and returning pop methods are used.
+ *
  * @tparam ValueType type of data to store in the queue
  */
 template<typename ValueType = unsigned long>
@@ -38,11 +53,12 @@ class fifo {
    * @param size the maximum number of elements that can be stored in the queue without blocking
    */
   fifo(size_t size = 1024) :
-      info_{0, 0, size}, data_{nullptr}, // will initialize later
+      info_{0, 0, size, 0}, data_{nullptr}, // will initialize later
       pmutex_{}, cmutex_{},
       psem_{size},  // start at size of fifo
-      csem_{0} {    // start at zero
-    data_ = new ValueType[size];
+      csem_{0},     // start at zero
+      selectors_{} {
+    data_ = new storage_type[size];  // uninitialized, items are constructed in place when pushed
   }
 
  private:
@@ -59,8 +75,11 @@ class fifo {
    * Invalidates and frees any data in the queue
    */
   ~fifo() {
-    // free data
-    delete [] data;
+    // destroy remaining items, then free storage
+    while (csem_.try_wait()) {
+      pop_item(nullptr);
+    }
+    delete [] data_;
   }
 
   /**
@@ -71,6 +90,7 @@ class fifo {
     psem_.wait();   // wait until room to push
     push_item(val);
     csem_.notify(); // let consumer know a item is available
+    selectors_.notify();
   }
 
   /**
@@ -81,6 +101,41 @@ class fifo {
     psem_.wait();   // wait until room to push
     push_item(std::move(val));
     csem_.notify(); // let consumer know a item is available
+    selectors_.notify();
+  }
+
+  /**
+   * @brief Constructs an item in place at the end of the fifo
+   *
+   * Blocks until there is room in the fifo, then constructs the item directly in its slot.
+   *
+   * @tparam Args constructor argument types
+   * @param args arguments forwarded to the constructor of ValueType
+   */
+  template<typename... Args>
+  void emplace(Args&&... args) {
+    psem_.wait();   // wait until room to push
+    push_item(std::forward<Args>(args)...);
+    csem_.notify(); // let consumer know a item is available
+    selectors_.notify();
+  }
+
+  /**
+   * @brief Tries to construct an item in place at the end of the fifo without blocking
+   *
+   * @tparam Args constructor argument types
+   * @param args arguments forwarded to the constructor of ValueType
+   * @return `true` if item is added, `false` if would cause the current thread to block
+   */
+  template<typename... Args>
+  bool try_emplace(Args&&... args) {
+    if (!psem_.try_wait()) {
+      return false;
+    }
+    push_item(std::forward<Args>(args)...);
+    csem_.notify(); // let consumer know a item is available
+    selectors_.notify();
+    return true;
   }
 
   /**
@@ -99,6 +154,7 @@ class fifo {
     }
     push_item(val);
     csem_.notify();  // let consumer know a item is available
+    selectors_.notify();
     return true;
   }
 
@@ -115,9 +171,9 @@ class fifo {
    * @return `true` if item added within the timeout time, `false` if not added
    */
   template <typename Rep, typename Period>
-  bool try_push_for(const ValueType& val, std::chrono::duration<Rep, Period>& rel_time) {
+  bool try_push_for(const ValueType& val, const std::chrono::duration<Rep, Period>& rel_time) {
     return try_push_until(val, std::chrono::steady_clock::now()+rel_time);
-  };
+  }
 
   /**
    * @brief Tries to add an item to the fifo, will wait until a timeout time is reached before aborting
@@ -139,8 +195,9 @@ class fifo {
     }
     push_item(val);
     csem_.notify();  // let consumer know a item is available
+    selectors_.notify();
     return true;
-  };
+  }
 
   /**
    * @brief Removes the next item in the fifo
@@ -164,8 +221,9 @@ class fifo {
    * @return next item in the fifo
    */
   ValueType pop() {
-    ValueType out;
-    pop(&out);
+    csem_.wait();      // wait until item available
+    ValueType out(take_item());
+    psem_.notify();    // let producer know that we are done with the slot
     return out;
   }
 
@@ -201,9 +259,9 @@ class fifo {
    * @return `true` if item successfully popped, `false` if timeout elapsed
    */
   template <typename Rep, typename Period>
-  bool try_pop_for(ValueType* out, std::chrono::duration<Rep, Period>& rel_time) {
+  bool try_pop_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
     return try_pop_until(out, std::chrono::steady_clock::now()+rel_time);
-  };
+  }
 
   /**
    * @brief Tries to remove an item from the fifo, will wait for a maximum timeout time to be reached before aborting
@@ -226,7 +284,7 @@ class fifo {
     pop_item(out);
     psem_.notify();  // let consumer know a item is available
     return true;
-  };
+  }
 
   /**
    * @brief Peeks at the next item in the fifo without removing it.
@@ -240,6 +298,7 @@ class fifo {
   void peek(ValueType* out) {
     csem_.wait();      // wait until item available
     peek_item(out);
+    csem_.notify();    // item is still available
   }
 
   /**
@@ -251,8 +310,9 @@ class fifo {
    * @return next item in the fifo.
    */
   ValueType peek() {
-    ValueType out;
-    peek(&out);
+    csem_.wait();      // wait until item available
+    ValueType out(copy_item());
+    csem_.notify();    // item is still available
     return out;
   }
 
@@ -272,6 +332,7 @@ class fifo {
       return false;
     }
     peek_item(out);
+    csem_.notify();    // item is still available
     return true;
   }
 
@@ -289,9 +350,9 @@ class fifo {
    * @return `true` if item successfully peeked, `false` if timeout elapsed
    */
   template <typename Rep, typename Period>
-  bool try_peek_for(ValueType* out, std::chrono::duration<Rep, Period>& rel_time) {
+  bool try_peek_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
     return try_peek_until(out, std::chrono::steady_clock::now()+rel_time);
-  };
+  }
 
   /**
    * @brief Tries to peek at the next item in the fifo, will wait for a maximum timeout time before aborting
@@ -313,8 +374,99 @@ class fifo {
       return false;
     }
     peek_item(out);
+    csem_.notify();    // item is still available
     return true;
-  };
+  }
+
+  /**
+   * @brief Adds a batch of items to the fifo
+   *
+   * Items are added in order.  Whenever the fifo is full, this will block until room becomes available,
+   * then claims as many free slots as possible (up to the remainder of the batch) in a single step.
+   *
+   * @param vals pointer to first item to add
+   * @param n number of items to add
+   */
+  void push_n(const ValueType* vals, size_t n) {
+    while (n > 0) {
+      size_t count = psem_.wait_some(n);  // wait until room, claim as many slots as possible
+      push_items(vals, count);
+      csem_.notify(count);                // let consumers know items are available
+      selectors_.notify();
+      vals += count;
+      n -= count;
+    }
+  }
+
+  /**
+   * @brief Tries to add a batch of items to the fifo without blocking
+   *
+   * Adds as many items from the front of the batch as there is currently room for.
+   *
+   * @param vals pointer to first item to add
+   * @param n number of items to add
+   * @return number of items added, which may be less than `n`
+   */
+  size_t try_push_n(const ValueType* vals, size_t n) {
+    size_t count = psem_.try_wait_some(n);
+    if (count > 0) {
+      push_items(vals, count);
+      csem_.notify(count);
+      selectors_.notify();
+    }
+    return count;
+  }
+
+  /**
+   * @brief Removes a batch of items from the fifo
+   *
+   * If there are no items in the fifo, then this will block until one is available.  Then removes as many
+   * items as are available, up to `n`, in a single step.
+   *
+   * @param out destination array with room for at least `n` items.  If `nullptr`, items are removed but not returned.
+   * @param n maximum number of items to remove
+   * @return number of items removed, between 1 and `n`
+   */
+  size_t pop_n(ValueType* out, size_t n) {
+    size_t count = csem_.wait_some(n);  // wait until item available, claim as many as possible
+    pop_items(out, count);
+    psem_.notify(count);                // let producers know slots are free
+    return count;
+  }
+
+  /**
+   * @brief Tries to remove a batch of items from the fifo without blocking
+   *
+   * @param out destination array with room for at least `n` items.  If `nullptr`, items are removed but not returned.
+   * @param n maximum number of items to remove
+   * @return number of items removed, 0 if the fifo is empty
+   */
+  size_t try_pop_n(ValueType* out, size_t n) {
+    size_t count = csem_.try_wait_some(n);
+    if (count > 0) {
+      pop_items(out, count);
+      psem_.notify(count);
+    }
+    return count;
+  }
+
+  /**
+   * @brief Removes all items currently in the fifo without blocking
+   *
+   * Appends the items to the end of `out` in order.
+   *
+   * @param out destination container
+   * @return number of items removed, 0 if the fifo is empty
+   */
+  size_t try_pop_all(std::vector<ValueType>& out) {
+    size_t count = csem_.try_wait_some(info_.size);
+    if (count > 0) {
+      out.reserve(out.size()+count);
+      append_items(out, count);
+      psem_.notify(count);
+    }
+    return count;
+  }
 
   /**
    * @brief Number of items currently in the fifo
@@ -328,9 +480,6 @@ class fifo {
     std::lock_guard<std::mutex> lock1(pmutex_);
     std::lock_guard<std::mutex> lock2(cmutex_);
 
-    if (info_.pidx < info_.cidx) {
-      return info_.size - info_.cidx+info_.pidx;
-    }
     return info_.pidx-info_.cidx;
   }
 
@@ -345,102 +494,149 @@ class fifo {
   bool empty() {
     std::lock_guard<std::mutex> lock1(pmutex_);
     std::lock_guard<std::mutex> lock2(cmutex_);
-    return info_->pidx == info_->cidx;
+    return info_.pidx == info_.cidx;
   }
 
  private:
 
+  // pointer to item stored in the slot for a given producer/consumer index
+  ValueType* item(size_t idx) {
+    return reinterpret_cast<ValueType*>(&data_[idx % info_.size]);
+  }
+
   // only to be called internally, does not wait for semaphore
-  void push_item(const ValueType &val) {
-    // lock is fast (only index increment), so will not trigger wait
-    int loc = 0;
-    {
-      // look at index, protect memory from multiple simultaneous pushes
-      std::lock_guard<std::mutex> lock(pmutex_);
-      loc = info_.pidx;
-      // increment producer index for next item, wrap around if at end
-      if ((++info_.pidx) == info_.size) {
-        info_.pidx = 0;
-      }
-      // lock will unlock here as guard runs out of scope
-    }
+  template<typename... Args>
+  void push_item(Args&&... args) {
+    // construct under the lock so consumers never see a claimed but unwritten slot
+    std::lock_guard<std::mutex> lock(pmutex_);
+    new (item(info_.pidx)) ValueType(std::forward<Args>(args)...);
+    ++info_.pidx;  // increment producer index for next item
+  }
 
-    // copy data to correct location
-    data_[loc] = val;  // add item to fifo
+  // only to be called internally, does not wait for semaphore
+  void push_items(const ValueType* vals, size_t n) {
+    // claim and fill the whole range under a single lock
+    std::lock_guard<std::mutex> lock(pmutex_);
+    for (size_t i=0; i<n; ++i) {
+      new (item(info_.pidx+i)) ValueType(vals[i]);
+    }
+    info_.pidx += n;
   }
 
   // only to be called internally, does not wait for semaphore
-  void push_item(ValueType &&val) {
-    // lock is fast (only index increment), so will not trigger wait
-    int loc = 0;
-    {
-      // look at index, protect memory from multiple simultaneous pushes
-      std::lock_guard<std::mutex> lock(pmutex_);
-      loc = info_.pidx;
-      // increment producer index for next item, wrap around if at end
-      if ((++info_.pidx) == info_.size) {
-        info_.pidx = 0;
+  void pop_items(ValueType* vals, size_t n) {
+    // claim and drain the whole range under a single lock
+    std::lock_guard<std::mutex> lock(cmutex_);
+    for (size_t i=0; i<n; ++i) {
+      ValueType* ptr = item(info_.cidx+i);
+      if (vals != nullptr) {
+        vals[i] = std::move(*ptr);
       }
-      // lock will unlock here as guard runs out of scope
+      ptr->~ValueType();
     }
-
-    // copy data to correct location
-    data_[loc] = std::move(val);  // add item to fifo
+    info_.cidx += n;
   }
 
-  void peek_item(ValueType* val) {
-    // lock is fast (only index increment), so will not trigger wait
-    int loc = 0;  // will store location of item to take
-    {
-      // look at index, protect memory from multiple simultaneous pops
-      std::lock_guard<std::mutex> lock(cmutex_);
-      loc = info_.cidx;
-      // lock will unlock here as guard runs out of scope
+  // only to be called internally, does not wait for semaphore
+  void append_items(std::vector<ValueType>& vals, size_t n) {
+    std::lock_guard<std::mutex> lock(cmutex_);
+    for (size_t i=0; i<n; ++i) {
+      ValueType* ptr = item(info_.cidx+i);
+      vals.push_back(std::move(*ptr));
+      ptr->~ValueType();
     }
+    info_.cidx += n;
+  }
 
-    // copy data to output
+  void peek_item(ValueType* val) {
+    // copy under the lock so the slot cannot be popped from underneath us
+    std::lock_guard<std::mutex> lock(cmutex_);
     if (val != nullptr) {
-      *val = data_[loc];  // copy item out
+      *val = *item(info_.cidx);  // copy item out
     }
   }
 
-  void pop_item(ValueType* val) {
-    // lock is fast (only index increment), so will not trigger wait
-    int loc = 0;  // will store location of item to take
-    {
-      // look at index, protect memory from multiple simultaneous pops
-      std::lock_guard<std::mutex> lock(cmutex_);
-      loc = info_.cidx;
-
-      // increment consumer index for next item, wrap around if at end
-      if ( (++info_.cidx) == info_.size) {
-        info_.cidx = 0;
-      }
-      // lock will unlock here as guard runs out of scope
-    }
+  ValueType copy_item() {
+    std::lock_guard<std::mutex> lock(cmutex_);
+    return ValueType(*item(info_.cidx));
+  }
 
-    // copy data to output
+  void pop_item(ValueType* val) {
+    // move out and destroy under the lock so producers never overwrite a slot still being read
+    std::lock_guard<std::mutex> lock(cmutex_);
+    ValueType* ptr = item(info_.cidx);
     if (val != nullptr) {
-      *val = std::move(data_[loc]);  // move item out
+      *val = std::move(*ptr);  // move item out
     }
+    ptr->~ValueType();
+    ++info_.cidx;  // increment consumer index for next item
+  }
+
+  ValueType take_item() {
+    std::lock_guard<std::mutex> lock(cmutex_);
+    ValueType* ptr = item(info_.cidx);
+    ValueType out(std::move(*ptr));  // move item out
+    ptr->~ValueType();
+    ++info_.cidx;
+    return out;
   }
 
   struct fifo_info {
-    size_t pidx;      // producer index
-    size_t cidx;      // consumer index
+    size_t pidx;      // producer index, total number of items pushed
+    size_t cidx;      // consumer index, total number of items popped
     size_t size;      // size (in counts of ValueType)
     int initialized;  // magic initialized marker
   };
 
-  fifo_info info_;                          // pointer to fifo information, will be at start of memory_
-  ValueType* data_;                         // pointer to data in fifo, after info_ in memory
+  typedef typename std::aligned_storage<sizeof(ValueType), alignof(ValueType)>::type storage_type;
+
+  fifo_info info_;                          // fifo information
+  storage_type* data_;                      // raw slot storage, items constructed in place
   std::mutex pmutex_;                       // mutex for protecting memory modified by producers
   std::mutex cmutex_;                       // mutex for protecting memory modified by consumers
   cpen333::thread::semaphore psem_;         // semaphore controlling when producer can add an item
   cpen333::thread::semaphore csem_;         //     "            "         consumer can remove an item
+  cpen333::thread::impl::select_registry selectors_;  // selectors waiting for an item
+
+  friend class cpen333::thread::selector;
 
 };
 
+/**
+ * @brief Lock-free bounded multi-producer multi-consumer fifo with the same interface as cpen333::thread::fifo
+ *
+ * Alias to cpen333::thread::impl::fifo_lockfree.  Producers and consumers only block when the queue
+ * is full or empty, respectively.  Peeking is only available for trivially copyable types.
+ *
+ * @tparam ValueType type of data to store in the queue
+ */
+template<typename ValueType = unsigned long>
+using lockfree_fifo = impl::fifo_lockfree<ValueType>;
+
+/**
+ * @brief Single-producer single-consumer fifo with a compile-time capacity and the same interface as
+ * cpen333::thread::fifo
+ *
+ * Alias to cpen333::thread::impl::fifo_spsc.  Only one thread may push and one thread may pop at a time.
+ *
+ * @tparam ValueType type of data to store in the queue
+ * @tparam Capacity maximum number of items in the queue, must be a power of two
+ */
+template<typename ValueType = unsigned long, size_t Capacity = 1024>
+using spsc_fifo = impl::fifo_spsc<ValueType, Capacity>;
+
+/**
+ * @brief Unbounded fifo with the same interface as cpen333::thread::fifo
+ *
+ * Alias to cpen333::thread::impl::fifo_unbounded.  Push never blocks: the queue grows by linking in
+ * fixed-size segments, which are recycled once drained.
+ *
+ * @tparam ValueType type of data to store in the queue
+ * @tparam SegmentSize number of items per segment
+ */
+template<typename ValueType = unsigned long, size_t SegmentSize = 256>
+using unbounded_fifo = impl::fifo_unbounded<ValueType, SegmentSize>;
+
 } // thread
 } // cpen333
 
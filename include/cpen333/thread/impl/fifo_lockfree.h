@@ -0,0 +1,355 @@
+/**
+ * @file
+ * @brief Lock-free bounded first-in-first-out shared buffer
+ */
+#ifndef CPEN333_THREAD_FIFO_LOCKFREE_H
+#define CPEN333_THREAD_FIFO_LOCKFREE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "../../util.h"
+#include "wait_queue.h"
+
+namespace cpen333 {
+namespace thread {
+namespace impl {
+
+/**
+ * @brief Lock-free thread-safe multi-producer multi-consumer first-in-first-out queue
+ *
+ * Bounded circular buffer where each slot carries a sequence number that tells producers and consumers
+ * whether the slot is free or full for the current lap around the ring (D. Vyukov's bounded MPMC queue).
+ * A push or pop claims a slot with a single compare-and-swap on the producer or consumer index, so threads
+ * never block each other while there is room/data in the queue.  Threads are only parked when the queue is
+ * truly full (push) or empty (pop).
+ *
+ * The interface mirrors cpen333::thread::fifo, with one restriction: since a consumer may be moving an item out
+ * while another thread is copying it, the peek methods are only available for trivially copyable types, and fail to
+ * compile for any other.  Use cpen333::thread::fifo to peek at other types.  As with cpen333::thread::fifo, the
+ * pop() and peek() overloads that return by value also require a default-constructible type.  The capacity is
+ * rounded up to the next power of two.
+ *
+ * Note: with multiple consumers, `peek` is only a hint: the peeked item may be popped by another consumer
+ * immediately afterwards.
+ *
+ * @tparam ValueType type of data to store in the queue
+ */
+template<typename ValueType = unsigned long>
+class fifo_lockfree {
+
+ public:
+
+  /**
+   * @brief data type stored in buffer
+   */
+  using value_type = ValueType;
+
+  /**
+   * @brief Creates a fifo
+   * @param size the minimum number of elements that can be stored in the queue without blocking,
+   *        rounded up to the next power of two
+   */
+  fifo_lockfree(size_t size = 1024) :
+      cells_{nullptr}, mask_{0}, pidx_{0}, cidx_{0}, pwait_{}, cwait_{} {
+    size_t capacity = 1;
+    while (capacity < size) {
+      capacity <<= 1;
+    }
+    mask_ = capacity-1;
+    cells_ = new cell[capacity];
+    for (size_t i=0; i<capacity; ++i) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  fifo_lockfree(const fifo_lockfree &) DELETE_METHOD;
+  fifo_lockfree(fifo_lockfree &&) DELETE_METHOD;
+  fifo_lockfree &operator=(const fifo_lockfree &) DELETE_METHOD;
+  fifo_lockfree &operator=(fifo_lockfree &&) DELETE_METHOD;
+
+ public:
+
+  /**
+   * @brief Destructor
+   *
+   * Invalidates and frees any data in the queue
+   */
+  ~fifo_lockfree() {
+    // destroy any remaining items
+    while (try_pop_item(nullptr)) {}
+    delete [] cells_;
+  }
+
+  /**
+   * @brief Add a item to the fifo
+   * @param val value to add
+   */
+  void push(const ValueType &val) {
+    pwait_.wait([&](){ return try_push_item(val); });
+    cwait_.notify_one();
+  }
+
+  /**
+   * @brief Add a item to the fifo
+   * @param val value to add
+   */
+  void push(ValueType &&val) {
+    pwait_.wait([&](){ return try_push_item(std::move(val)); });
+    cwait_.notify_one();
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_push()
+   */
+  bool try_push(const ValueType &val) {
+    if (!try_push_item(val)) {
+      return false;
+    }
+    cwait_.notify_one();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_push_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_push_for(const ValueType& val, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_push_until(val, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_push_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_push_until(const ValueType& val, const std::chrono::time_point<Clock,Duration>& timeout) {
+    if (!pwait_.wait_until(timeout, [&](){ return try_push_item(val); })) {
+      return false;
+    }
+    cwait_.notify_one();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::pop(ValueType*)
+   */
+  void pop(ValueType* out) {
+    cwait_.wait([&](){ return try_pop_item(out); });
+    pwait_.notify_one();
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::pop()
+   */
+  ValueType pop() {
+    ValueType out;
+    pop(&out);
+    return out;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop()
+   */
+  bool try_pop(ValueType* out) {
+    if (!try_pop_item(out)) {
+      return false;
+    }
+    pwait_.notify_one();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_pop_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_pop_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_pop_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    if (!cwait_.wait_until(timeout, [&](){ return try_pop_item(out); })) {
+      return false;
+    }
+    pwait_.notify_one();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::peek(ValueType*)
+   */
+  void peek(ValueType* out) {
+    cwait_.wait([&](){ return try_peek_item(out); });
+    cwait_.notify_one();  // we may have taken the wakeup meant for a pop, and the item is still there
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::peek()
+   */
+  ValueType peek() {
+    ValueType out;
+    peek(&out);
+    return out;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_peek()
+   */
+  bool try_peek(ValueType* out) {
+    return try_peek_item(out);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_peek_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_peek_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_peek_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_peek_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_peek_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    if (!cwait_.wait_until(timeout, [&](){ return try_peek_item(out); })) {
+      return false;
+    }
+    cwait_.notify_one();  // pass on a wakeup that may have been meant for a pop
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::size()
+   */
+  size_t size() {
+    size_t cidx = cidx_.load(std::memory_order_acquire);
+    size_t pidx = pidx_.load(std::memory_order_acquire);
+    if (pidx < cidx) {
+      return 0;  // consumer index moved in between loads
+    }
+    return pidx - cidx;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::empty()
+   */
+  bool empty() {
+    return size() == 0;
+  }
+
+  /**
+   * @brief Maximum number of items that can be stored in the fifo without blocking
+   * @return capacity of fifo
+   */
+  size_t capacity() const {
+    return mask_+1;
+  }
+
+ private:
+
+  // claims the next free slot and constructs the item in-place, returns false if the fifo is full
+  template<typename... Args>
+  bool try_push_item(Args&&... args) {
+    size_t pos = pidx_.load(std::memory_order_relaxed);
+    for (;;) {
+      cell& c = cells_[pos & mask_];
+      size_t seq = c.seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        // slot is free on this lap, try to claim it
+        if (pidx_.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+          new (&c.storage) ValueType(std::forward<Args>(args)...);
+          c.seq.store(pos+1, std::memory_order_release);  // publish to consumers
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // slot still holds item from previous lap: full
+      } else {
+        pos = pidx_.load(std::memory_order_relaxed);  // another producer got here first
+      }
+    }
+  }
+
+  // claims the next full slot and moves the item out, returns false if the fifo is empty
+  bool try_pop_item(ValueType* val) {
+    size_t pos = cidx_.load(std::memory_order_relaxed);
+    for (;;) {
+      cell& c = cells_[pos & mask_];
+      size_t seq = c.seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)(pos+1);
+      if (diff == 0) {
+        // slot is full on this lap, try to claim it
+        if (cidx_.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+          ValueType* item = reinterpret_cast<ValueType*>(&c.storage);
+          if (val != nullptr) {
+            *val = std::move(*item);
+          }
+          item->~ValueType();
+          c.seq.store(pos+mask_+1, std::memory_order_release);  // free for producers on next lap
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // slot not yet filled: empty
+      } else {
+        pos = cidx_.load(std::memory_order_relaxed);  // another consumer got here first
+      }
+    }
+  }
+
+  // copies the item at the head without claiming it, returns false if the fifo is empty
+  bool try_peek_item(ValueType* val) {
+    static_assert(std::is_trivially_copyable<ValueType>::value,
+                  "fifo_lockfree can only peek trivially copyable types");
+    for (;;) {
+      size_t pos = cidx_.load(std::memory_order_acquire);
+      cell& c = cells_[pos & mask_];
+      if (c.seq.load(std::memory_order_acquire) != pos+1) {
+        if (cidx_.load(std::memory_order_acquire) != pos) {
+          continue;  // popped in between, look at the new head
+        }
+        return false;
+      }
+      // copy, then check the slot was not popped (and possibly refilled) while we were copying it
+      typename std::aligned_storage<sizeof(ValueType), alignof(ValueType)>::type copy;
+      std::memcpy(&copy, &c.storage, sizeof(ValueType));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (c.seq.load(std::memory_order_relaxed) == pos+1) {
+        if (val != nullptr) {
+          std::memcpy(val, &copy, sizeof(ValueType));
+        }
+        return true;
+      }
+    }
+  }
+
+  struct cell {
+    std::atomic<size_t> seq;  // lap sequence number
+    typename std::aligned_storage<sizeof(ValueType), alignof(ValueType)>::type storage;
+  };
+
+  cell* cells_;                               // ring of slots
+  size_t mask_;                               // capacity-1, for wrapping indices
+  char pad0_[CPEN333_CACHE_LINE_SIZE];
+  std::atomic<size_t> pidx_;                  // producer index, only ever increases
+  char pad1_[CPEN333_CACHE_LINE_SIZE];
+  std::atomic<size_t> cidx_;                  // consumer index, only ever increases
+  char pad2_[CPEN333_CACHE_LINE_SIZE];
+  cpen333::thread::impl::wait_queue pwait_;   // producers waiting for a free slot
+  cpen333::thread::impl::wait_queue cwait_;   // consumers waiting for an item
+
+};
+
+} // impl
+} // thread
+} // cpen333
+
+#endif //CPEN333_THREAD_FIFO_LOCKFREE_H
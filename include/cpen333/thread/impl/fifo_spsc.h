@@ -0,0 +1,311 @@
+/**
+ * @file
+ * @brief Single-producer single-consumer first-in-first-out shared buffer
+ */
+#ifndef CPEN333_THREAD_FIFO_SPSC_H
+#define CPEN333_THREAD_FIFO_SPSC_H
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "../../util.h"
+#include "wait_queue.h"
+
+namespace cpen333 {
+namespace thread {
+namespace impl {
+
+/**
+ * @brief Single-producer single-consumer first-in-first-out queue with a fixed compile-time capacity
+ *
+ * Only ONE thread may push and only ONE thread may pop/peek at any given time.  In exchange, a push or pop
+ * is a plain load and store of the producer/consumer index: no locks and no read-modify-write atomics.  The
+ * producer and consumer indices live on separate cache lines, alongside each side's cached copy of the other's
+ * index so the shared line is only re-read when the queue appears full or empty.  Threads are only parked when
+ * the queue is actually full (push) or empty (pop).
+ *
+ * The interface mirrors cpen333::thread::fifo.
+ *
+ * @tparam ValueType type of data to store in the queue
+ * @tparam Capacity maximum number of items in the queue, must be a power of two
+ */
+template<typename ValueType = unsigned long, size_t Capacity = 1024>
+class fifo_spsc {
+
+  static_assert(Capacity > 0 && (Capacity & (Capacity-1)) == 0, "fifo_spsc capacity must be a power of two");
+
+ public:
+
+  /**
+   * @brief data type stored in buffer
+   */
+  using value_type = ValueType;
+
+  /**
+   * @brief Creates a fifo
+   */
+  fifo_spsc() :
+      data_{nullptr}, pidx_{0}, ccache_{0}, cidx_{0}, pcache_{0}, pwait_{}, cwait_{} {
+    data_ = new storage_type[Capacity];
+  }
+
+ private:
+  fifo_spsc(const fifo_spsc &) DELETE_METHOD;
+  fifo_spsc(fifo_spsc &&) DELETE_METHOD;
+  fifo_spsc &operator=(const fifo_spsc &) DELETE_METHOD;
+  fifo_spsc &operator=(fifo_spsc &&) DELETE_METHOD;
+
+ public:
+
+  /**
+   * @brief Destructor
+   *
+   * Invalidates and frees any data in the queue
+   */
+  ~fifo_spsc() {
+    while (try_pop_item(nullptr)) {}
+    delete [] data_;
+  }
+
+  /**
+   * @brief Add a item to the fifo
+   * @param val value to add
+   */
+  void push(const ValueType &val) {
+    pwait_.wait([&](){ return try_push_item(val); });
+    cwait_.notify_one();
+  }
+
+  /**
+   * @brief Add a item to the fifo
+   * @param val value to add
+   */
+  void push(ValueType &&val) {
+    pwait_.wait([&](){ return try_push_item(std::move(val)); });
+    cwait_.notify_one();
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_push()
+   */
+  bool try_push(const ValueType &val) {
+    if (!try_push_item(val)) {
+      return false;
+    }
+    cwait_.notify_one();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_push_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_push_for(const ValueType& val, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_push_until(val, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_push_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_push_until(const ValueType& val, const std::chrono::time_point<Clock,Duration>& timeout) {
+    if (!pwait_.wait_until(timeout, [&](){ return try_push_item(val); })) {
+      return false;
+    }
+    cwait_.notify_one();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::pop(ValueType*)
+   */
+  void pop(ValueType* out) {
+    cwait_.wait([&](){ return try_pop_item(out); });
+    pwait_.notify_one();
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::pop()
+   */
+  ValueType pop() {
+    ValueType out;
+    pop(&out);
+    return out;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop()
+   */
+  bool try_pop(ValueType* out) {
+    if (!try_pop_item(out)) {
+      return false;
+    }
+    pwait_.notify_one();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_pop_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_pop_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_pop_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    if (!cwait_.wait_until(timeout, [&](){ return try_pop_item(out); })) {
+      return false;
+    }
+    pwait_.notify_one();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::peek(ValueType*)
+   */
+  void peek(ValueType* out) {
+    cwait_.wait([&](){ return try_peek_item(out); });
+    cwait_.notify_one();  // we may have taken the wakeup meant for a pop, and the item is still there
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::peek()
+   */
+  ValueType peek() {
+    ValueType out;
+    peek(&out);
+    return out;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_peek()
+   */
+  bool try_peek(ValueType* out) {
+    return try_peek_item(out);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_peek_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_peek_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_peek_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_peek_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_peek_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    if (!cwait_.wait_until(timeout, [&](){ return try_peek_item(out); })) {
+      return false;
+    }
+    cwait_.notify_one();  // pass on a wakeup that may have been meant for a pop
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::size()
+   */
+  size_t size() {
+    size_t cidx = cidx_.load(std::memory_order_acquire);
+    size_t pidx = pidx_.load(std::memory_order_acquire);
+    if (pidx < cidx) {
+      return 0;  // consumer index moved in between loads
+    }
+    return pidx - cidx;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::empty()
+   */
+  bool empty() {
+    return size() == 0;
+  }
+
+  /**
+   * @brief Maximum number of items that can be stored in the fifo without blocking
+   * @return capacity of fifo
+   */
+  static constexpr size_t capacity() {
+    return Capacity;
+  }
+
+ private:
+
+  // producer only
+  template<typename... Args>
+  bool try_push_item(Args&&... args) {
+    size_t pidx = pidx_.load(std::memory_order_relaxed);
+    if (pidx - ccache_ == Capacity) {
+      // looks full, refresh our copy of the consumer index
+      ccache_ = cidx_.load(std::memory_order_acquire);
+      if (pidx - ccache_ == Capacity) {
+        return false;
+      }
+    }
+    new (&data_[pidx & (Capacity-1)]) ValueType(std::forward<Args>(args)...);
+    pidx_.store(pidx+1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer only
+  bool try_pop_item(ValueType* val) {
+    size_t cidx = cidx_.load(std::memory_order_relaxed);
+    if (cidx == pcache_) {
+      // looks empty, refresh our copy of the producer index
+      pcache_ = pidx_.load(std::memory_order_acquire);
+      if (cidx == pcache_) {
+        return false;
+      }
+    }
+    ValueType* item = reinterpret_cast<ValueType*>(&data_[cidx & (Capacity-1)]);
+    if (val != nullptr) {
+      *val = std::move(*item);
+    }
+    item->~ValueType();
+    cidx_.store(cidx+1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer only
+  bool try_peek_item(ValueType* val) {
+    size_t cidx = cidx_.load(std::memory_order_relaxed);
+    if (cidx == pcache_) {
+      pcache_ = pidx_.load(std::memory_order_acquire);
+      if (cidx == pcache_) {
+        return false;
+      }
+    }
+    if (val != nullptr) {
+      *val = *reinterpret_cast<ValueType*>(&data_[cidx & (Capacity-1)]);
+    }
+    return true;
+  }
+
+  typedef typename std::aligned_storage<sizeof(ValueType), alignof(ValueType)>::type storage_type;
+
+  storage_type* data_;                        // ring of slots
+  char pad0_[CPEN333_CACHE_LINE_SIZE];
+  std::atomic<size_t> pidx_;                  // producer index, written only by producer
+  size_t ccache_;                             // producer's cached copy of cidx_
+  char pad1_[CPEN333_CACHE_LINE_SIZE];
+  std::atomic<size_t> cidx_;                  // consumer index, written only by consumer
+  size_t pcache_;                             // consumer's cached copy of pidx_
+  char pad2_[CPEN333_CACHE_LINE_SIZE];
+  cpen333::thread::impl::wait_queue pwait_;   // producer waiting for a free slot
+  cpen333::thread::impl::wait_queue cwait_;   // consumer waiting for an item
+
+};
+
+} // impl
+} // thread
+} // cpen333
+
+#endif //CPEN333_THREAD_FIFO_SPSC_H
@@ -0,0 +1,508 @@
+/**
+ * @file
+ * @brief Unbounded first-in-first-out shared buffer built from linked segments
+ */
+#ifndef CPEN333_THREAD_FIFO_UNBOUNDED_H
+#define CPEN333_THREAD_FIFO_UNBOUNDED_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../../util.h"
+#include "../semaphore.h"
+
+namespace cpen333 {
+namespace thread {
+namespace impl {
+
+/**
+ * @brief Thread-safe first-in-first-out queue with no fixed capacity
+ *
+ * Items are stored in fixed-size segments linked into a list.  Producers append to the tail segment and
+ * consumers drain the head segment, each side under its own lock.  When the tail segment fills up, producers
+ * take a fresh segment from a free-list, and consumers return segments to the free-list once drained, so
+ * a queue that has reached its working size allocates nothing further.
+ *
+ * Push never blocks.  To apply back-pressure, register a watermark callback with set_high_water_mark(),
+ * which is called (outside of the queue's locks) when the queue grows to the high-water mark, and again when it
+ * drains back down to the low-water mark.
+ *
+ * The interface otherwise mirrors cpen333::thread::fifo.
+ *
+ * @tparam ValueType type of data to store in the queue
+ * @tparam SegmentSize number of items per segment
+ */
+template<typename ValueType = unsigned long, size_t SegmentSize = 256>
+class fifo_unbounded {
+
+  static_assert(SegmentSize > 0, "fifo_unbounded segment size must be positive");
+
+ public:
+
+  /**
+   * @brief data type stored in buffer
+   */
+  using value_type = ValueType;
+
+  /**
+   * @brief Watermark callback type, called with `true` when the high-water mark is reached, and with `false`
+   *        when the queue then drains to the low-water mark
+   */
+  using watermark_callback = std::function<void(bool)>;
+
+  /**
+   * @brief Creates a fifo
+   * @param segments number of segments to allocate up front, at least one
+   */
+  fifo_unbounded(size_t segments = 1) :
+      head_{nullptr}, cidx_{0}, tail_{nullptr}, pidx_{0}, free_{nullptr},
+      pmutex_{}, cmutex_{}, fmutex_{}, csem_{0}, size_{0},
+      high_{0}, low_{0}, above_{false}, wmutex_{}, callback_{} {
+    head_ = tail_ = new segment();
+    for (size_t i=1; i<segments; ++i) {
+      recycle(new segment());
+    }
+  }
+
+ private:
+  fifo_unbounded(const fifo_unbounded &) DELETE_METHOD;
+  fifo_unbounded(fifo_unbounded &&) DELETE_METHOD;
+  fifo_unbounded &operator=(const fifo_unbounded &) DELETE_METHOD;
+  fifo_unbounded &operator=(fifo_unbounded &&) DELETE_METHOD;
+
+ public:
+
+  /**
+   * @brief Destructor
+   *
+   * Invalidates and frees any data in the queue, and releases all segments
+   */
+  ~fifo_unbounded() {
+    while (csem_.try_wait()) {
+      pop_item(nullptr);
+    }
+    delete head_;
+    while (free_ != nullptr) {
+      segment* next = free_->next;
+      delete free_;
+      free_ = next;
+    }
+  }
+
+  /**
+   * @brief Sets the high- and low-water marks for back-pressure
+   *
+   * The callback is called with `true` by the producer whose push brings the queue size up to `high`, and
+   * with `false` by the consumer whose pop then brings it back down to `low`.  Calls alternate, and are
+   * serialized by a watermark lock separate from the queue's own locks, so the callback may signal other threads,
+   * but must not use the queue itself or wait for the opposite call (e.g. hold back producers by setting a flag
+   * that they check before pushing, rather than by sleeping inside the callback).  Should be set before the queue is
+   * shared between threads.
+   *
+   * @param high size at which to signal that the queue is filling up, 0 to disable
+   * @param low size at which to signal that the queue has drained, should be less than `high`
+   * @param callback function to call on crossing a watermark
+   */
+  void set_high_water_mark(size_t high, size_t low, watermark_callback callback) {
+    high_ = high;
+    low_ = low;
+    callback_ = std::move(callback);
+    above_.store(false);
+  }
+
+  /**
+   * @brief Add a item to the fifo, never blocks
+   * @param val value to add
+   */
+  void push(const ValueType &val) {
+    push_item(val);
+    notify_push(1);
+  }
+
+  /**
+   * @brief Add a item to the fifo, never blocks
+   * @param val value to add
+   */
+  void push(ValueType &&val) {
+    push_item(std::move(val));
+    notify_push(1);
+  }
+
+  /**
+   * @brief Constructs an item in place at the end of the fifo, never blocks
+   *
+   * @tparam Args constructor argument types
+   * @param args arguments forwarded to the constructor of ValueType
+   */
+  template<typename... Args>
+  void emplace(Args&&... args) {
+    push_item(std::forward<Args>(args)...);
+    notify_push(1);
+  }
+
+  /**
+   * @brief Add a item to the fifo
+   *
+   * Provided for compatibility with cpen333::thread::fifo, always succeeds.
+   *
+   * @param val value to add
+   * @return `true`
+   */
+  bool try_push(const ValueType &val) {
+    push(val);
+    return true;
+  }
+
+  /**
+   * @brief Adds a batch of items to the fifo under a single lock, never blocks
+   * @param vals pointer to first item to add
+   * @param n number of items to add
+   */
+  void push_n(const ValueType* vals, size_t n) {
+    if (n == 0) {
+      return;
+    }
+    push_items(vals, n);
+    notify_push(n);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::pop(ValueType*)
+   */
+  void pop(ValueType* out) {
+    csem_.wait();      // wait until item available
+    pop_item(out);
+    notify_pop(1);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::pop()
+   */
+  ValueType pop() {
+    csem_.wait();      // wait until item available
+    ValueType out = take_item();
+    notify_pop(1);
+    return out;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop()
+   */
+  bool try_pop(ValueType* out) {
+    if (!csem_.try_wait()) {
+      return false;
+    }
+    pop_item(out);
+    notify_pop(1);
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_pop_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_pop_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_pop_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    if (!csem_.wait_until(timeout)) {
+      return false;
+    }
+    pop_item(out);
+    notify_pop(1);
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::pop_n()
+   */
+  size_t pop_n(ValueType* out, size_t n) {
+    size_t count = csem_.wait_some(n);  // wait until item available, claim as many as possible
+    pop_items(out, count);
+    notify_pop(count);
+    return count;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop_n()
+   */
+  size_t try_pop_n(ValueType* out, size_t n) {
+    size_t count = csem_.try_wait_some(n);
+    if (count > 0) {
+      pop_items(out, count);
+      notify_pop(count);
+    }
+    return count;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop_all()
+   */
+  size_t try_pop_all(std::vector<ValueType>& out) {
+    size_t count = csem_.try_wait_some(size_.load(std::memory_order_acquire));
+    if (count > 0) {
+      out.reserve(out.size()+count);
+      append_items(out, count);
+      notify_pop(count);
+    }
+    return count;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::peek(ValueType*)
+   */
+  void peek(ValueType* out) {
+    csem_.wait();      // wait until item available
+    peek_item(out);
+    csem_.notify();    // item is still available
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::peek()
+   */
+  ValueType peek() {
+    csem_.wait();      // wait until item available
+    ValueType out = copy_item();
+    csem_.notify();    // item is still available
+    return out;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_peek()
+   */
+  bool try_peek(ValueType* out) {
+    if (!csem_.try_wait()) {
+      return false;
+    }
+    peek_item(out);
+    csem_.notify();    // item is still available
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_peek_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_peek_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_peek_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_peek_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_peek_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    if (!csem_.wait_until(timeout)) {
+      return false;
+    }
+    peek_item(out);
+    csem_.notify();    // item is still available
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::size()
+   */
+  size_t size() {
+    return size_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::empty()
+   */
+  bool empty() {
+    return size() == 0;
+  }
+
+ private:
+
+  typedef typename std::aligned_storage<sizeof(ValueType), alignof(ValueType)>::type storage_type;
+
+  struct segment {
+    storage_type data[SegmentSize];  // raw slots, items constructed in place
+    segment* next;                   // next segment towards the tail
+
+    segment() : next{nullptr} {}
+  };
+
+  // returns a drained segment to the free-list
+  void recycle(segment* seg) {
+    std::lock_guard<std::mutex> lock(fmutex_);
+    seg->next = free_;
+    free_ = seg;
+  }
+
+  // takes a segment from the free-list, allocating one if empty
+  segment* acquire() {
+    {
+      std::lock_guard<std::mutex> lock(fmutex_);
+      if (free_ != nullptr) {
+        segment* seg = free_;
+        free_ = seg->next;
+        seg->next = nullptr;
+        return seg;
+      }
+    }
+    return new segment();
+  }
+
+  // slot for the next item to push, linking in a new segment if the tail is full (producer lock held)
+  ValueType* push_slot() {
+    if (pidx_ == SegmentSize) {
+      segment* seg = acquire();
+      tail_->next = seg;
+      tail_ = seg;
+      pidx_ = 0;
+    }
+    return reinterpret_cast<ValueType*>(&tail_->data[pidx_]);
+  }
+
+  // slot of the next item to pop, moving to the next segment if the head is drained (consumer lock held)
+  ValueType* pop_slot() {
+    if (cidx_ == SegmentSize) {
+      segment* seg = head_;
+      head_ = head_->next;  // producer has already moved on, since an item is available
+      cidx_ = 0;
+      recycle(seg);
+    }
+    return reinterpret_cast<ValueType*>(&head_->data[cidx_]);
+  }
+
+  template<typename... Args>
+  void push_item(Args&&... args) {
+    std::lock_guard<std::mutex> lock(pmutex_);
+    new (push_slot()) ValueType(std::forward<Args>(args)...);
+    ++pidx_;
+  }
+
+  void push_items(const ValueType* vals, size_t n) {
+    std::lock_guard<std::mutex> lock(pmutex_);
+    for (size_t i=0; i<n; ++i) {
+      new (push_slot()) ValueType(vals[i]);
+      ++pidx_;
+    }
+  }
+
+  void pop_item(ValueType* val) {
+    std::lock_guard<std::mutex> lock(cmutex_);
+    ValueType* ptr = pop_slot();
+    if (val != nullptr) {
+      *val = std::move(*ptr);
+    }
+    ptr->~ValueType();
+    ++cidx_;
+  }
+
+  ValueType take_item() {
+    std::lock_guard<std::mutex> lock(cmutex_);
+    ValueType* ptr = pop_slot();
+    ValueType out(std::move(*ptr));
+    ptr->~ValueType();
+    ++cidx_;
+    return out;
+  }
+
+  void pop_items(ValueType* vals, size_t n) {
+    std::lock_guard<std::mutex> lock(cmutex_);
+    for (size_t i=0; i<n; ++i) {
+      ValueType* ptr = pop_slot();
+      if (vals != nullptr) {
+        vals[i] = std::move(*ptr);
+      }
+      ptr->~ValueType();
+      ++cidx_;
+    }
+  }
+
+  void append_items(std::vector<ValueType>& vals, size_t n) {
+    std::lock_guard<std::mutex> lock(cmutex_);
+    for (size_t i=0; i<n; ++i) {
+      ValueType* ptr = pop_slot();
+      vals.push_back(std::move(*ptr));
+      ptr->~ValueType();
+      ++cidx_;
+    }
+  }
+
+  void peek_item(ValueType* val) {
+    std::lock_guard<std::mutex> lock(cmutex_);
+    if (val != nullptr) {
+      *val = *pop_slot();
+    }
+  }
+
+  ValueType copy_item() {
+    std::lock_guard<std::mutex> lock(cmutex_);
+    return ValueType(*pop_slot());
+  }
+
+  // updates size, signals the high-water mark and lets consumers know items are available
+  void notify_push(size_t count) {
+    size_t size = size_.fetch_add(count) + count;
+    csem_.notify(count);
+    if (high_ > 0 && size >= high_ && !above_.load()) {
+      update_watermark();
+    }
+  }
+
+  // updates size and signals the low-water mark
+  void notify_pop(size_t count) {
+    size_t size = size_.fetch_sub(count) - count;
+    if (high_ > 0 && size <= low_ && above_.load()) {
+      update_watermark();
+    }
+  }
+
+  // brings the watermark flag in line with the current size, calling the callback on each change; the size is
+  // re-read after every change, since a push or pop racing with it may have seen the old flag and skipped this
+  void update_watermark() {
+    std::lock_guard<std::mutex> lock(wmutex_);
+    for (;;) {
+      size_t size = size_.load();
+      bool above = above_.load(std::memory_order_relaxed);
+      if (!above && size >= high_) {
+        above_.store(true);
+      } else if (above && size <= low_) {
+        above_.store(false);
+      } else {
+        return;
+      }
+      callback_(!above);
+    }
+  }
+
+  segment* head_;                      // segment consumers are draining
+  size_t cidx_;                        // next slot to pop in head segment
+  char pad0_[CPEN333_CACHE_LINE_SIZE];
+  segment* tail_;                      // segment producers are filling
+  size_t pidx_;                        // next slot to push in tail segment
+  char pad1_[CPEN333_CACHE_LINE_SIZE];
+  segment* free_;                      // drained segments ready for reuse
+  std::mutex pmutex_;                  // protects tail segment
+  std::mutex cmutex_;                  // protects head segment
+  std::mutex fmutex_;                  // protects free-list
+  cpen333::thread::semaphore csem_;    // number of items available to consumers
+  std::atomic<size_t> size_;           // number of items in queue, for watermarks
+  size_t high_;                        // high-water mark, 0 if disabled
+  size_t low_;                         // low-water mark
+  std::atomic<bool> above_;            // whether the high-water mark has been signalled
+  std::mutex wmutex_;                  // serializes watermark changes and callbacks
+  watermark_callback callback_;        // watermark callback
+
+};
+
+} // impl
+} // thread
+} // cpen333
+
+#endif //CPEN333_THREAD_FIFO_UNBOUNDED_H
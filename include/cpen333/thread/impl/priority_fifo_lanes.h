@@ -0,0 +1,420 @@
+/**
+ * @file
+ * @brief Priority-ordered shared buffer with a fixed number of priority levels
+ */
+#ifndef CPEN333_THREAD_PRIORITY_FIFO_LANES_H
+#define CPEN333_THREAD_PRIORITY_FIFO_LANES_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "../../util.h"
+
+namespace cpen333 {
+namespace thread {
+namespace impl {
+
+/**
+ * @brief Thread-safe bounded priority queue with a fixed number of priority levels
+ *
+ * Each priority level (lane) is its own circular buffer.  A bit-mask of non-empty lanes lets pop find the
+ * highest non-empty level with a single bit-scan, so push and pop are both O(1).  Items within a level are
+ * popped in the order they were pushed.
+ *
+ * Items are pushed with an explicit level in `[0, Levels)`, and higher levels are popped first.  Levels past the
+ * last are clamped to `Levels-1`.  Push blocks while the item's level is full, and pop blocks while all levels
+ * are empty.
+ *
+ * The interface otherwise mirrors cpen333::thread::fifo.
+ *
+ * @tparam ValueType type of data to store in the queue
+ * @tparam Levels number of priority levels, at most 64
+ */
+template<typename ValueType = unsigned long, size_t Levels = 4>
+class priority_fifo_lanes {
+
+  static_assert(Levels > 0 && Levels <= 64, "priority_fifo_lanes supports between 1 and 64 levels");
+
+ public:
+
+  /**
+   * @brief data type stored in buffer
+   */
+  using value_type = ValueType;
+
+  /**
+   * @brief Creates a fifo
+   * @param size the maximum number of elements in each level that can be stored without blocking
+   */
+  priority_fifo_lanes(size_t size = 1024) :
+      data_{nullptr}, lane_size_{size}, lanes_{}, mask_{0}, size_{0},
+      mutex_{}, not_full_{}, not_empty_{} {
+    data_ = new storage_type[Levels*size];  // uninitialized, items are constructed in place when pushed
+    for (size_t i=0; i<Levels; ++i) {
+      lanes_[i].head = 0;
+      lanes_[i].count = 0;
+    }
+  }
+
+ private:
+  priority_fifo_lanes(const priority_fifo_lanes &) DELETE_METHOD;
+  priority_fifo_lanes(priority_fifo_lanes &&) DELETE_METHOD;
+  priority_fifo_lanes &operator=(const priority_fifo_lanes &) DELETE_METHOD;
+  priority_fifo_lanes &operator=(priority_fifo_lanes &&) DELETE_METHOD;
+
+ public:
+
+  /**
+   * @brief Destructor
+   *
+   * Invalidates and frees any data in the queue
+   */
+  ~priority_fifo_lanes() {
+    while (size_ > 0) {
+      pop_item(nullptr);
+    }
+    delete [] data_;
+  }
+
+  /**
+   * @brief Add a item to the fifo at a given priority level
+   * @param val value to add
+   * @param level priority level, in `[0, Levels)`, higher levels are popped first
+   */
+  void push(const ValueType &val, size_t level) {
+    emplace(level, val);
+  }
+
+  /**
+   * @brief Add a item to the fifo at a given priority level
+   * @param val value to add
+   * @param level priority level, in `[0, Levels)`, higher levels are popped first
+   */
+  void push(ValueType &&val, size_t level) {
+    emplace(level, std::move(val));
+  }
+
+  /**
+   * @brief Constructs an item in place at the end of a priority level
+   *
+   * Blocks until there is room in the level, then constructs the item directly in its slot.
+   *
+   * @tparam Args constructor argument types
+   * @param level priority level, in `[0, Levels)`, higher levels are popped first
+   * @param args arguments forwarded to the constructor of ValueType
+   */
+  template<typename... Args>
+  void emplace(size_t level, Args&&... args) {
+    level = clamp(level);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      not_full_[level].wait(lock, [&](){ return lanes_[level].count < lane_size_; });
+      push_item(level, std::forward<Args>(args)...);
+    }
+    not_empty_.notify_one();
+  }
+
+  /**
+   * @brief Tries to add an item to a priority level without blocking
+   * @param val item to add
+   * @param level priority level, in `[0, Levels)`, higher levels are popped first
+   * @return `true` if item is added, `false` if would cause the current thread to block
+   */
+  bool try_push(const ValueType &val, size_t level) {
+    level = clamp(level);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (lanes_[level].count == lane_size_) {
+        return false;
+      }
+      push_item(level, val);
+    }
+    not_empty_.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Tries to add an item to a priority level, will wait for a maximum amount of time before aborting
+   *
+   * @tparam Rep duration representation
+   * @tparam Period duration period
+   * @param val value to add to the fifo
+   * @param level priority level, in `[0, Levels)`, higher levels are popped first
+   * @param rel_time relative timeout time
+   * @return `true` if item added within the timeout time, `false` if not added
+   */
+  template <typename Rep, typename Period>
+  bool try_push_for(const ValueType& val, size_t level, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_push_until(val, level, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @brief Tries to add an item to a priority level, will wait until a timeout time is reached before aborting
+   *
+   * @tparam Clock clock type
+   * @tparam Duration clock duration type
+   * @param val value to add to the fifo
+   * @param level priority level, in `[0, Levels)`, higher levels are popped first
+   * @param timeout absolute timeout time
+   * @return `true` if item added before the timeout time, `false` if not added
+   */
+  template<typename Clock, typename Duration>
+  bool try_push_until(const ValueType& val, size_t level, const std::chrono::time_point<Clock,Duration>& timeout) {
+    level = clamp(level);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (!not_full_[level].wait_until(lock, timeout, [&](){ return lanes_[level].count < lane_size_; })) {
+        return false;
+      }
+      push_item(level, val);
+    }
+    not_empty_.notify_one();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::priority_fifo::pop(ValueType*)
+   */
+  void pop(ValueType* out) {
+    size_t level;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      not_empty_.wait(lock, [&](){ return size_ > 0; });
+      level = pop_item(out);
+    }
+    not_full_[level].notify_one();
+  }
+
+  /**
+   * @copydoc cpen333::thread::priority_fifo::pop()
+   */
+  ValueType pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [&](){ return size_ > 0; });
+    size_t level = top_level();
+    ValueType out(std::move(*front(level)));
+    pop_item(nullptr);
+    lock.unlock();
+    not_full_[level].notify_one();
+    return out;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop()
+   */
+  bool try_pop(ValueType* out) {
+    size_t level;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (size_ == 0) {
+        return false;
+      }
+      level = pop_item(out);
+    }
+    not_full_[level].notify_one();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_pop_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_pop_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_pop_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    size_t level;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (!not_empty_.wait_until(lock, timeout, [&](){ return size_ > 0; })) {
+        return false;
+      }
+      level = pop_item(out);
+    }
+    not_full_[level].notify_one();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::priority_fifo::peek(ValueType*)
+   */
+  void peek(ValueType* out) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [&](){ return size_ > 0; });
+    if (out != nullptr) {
+      *out = *front(top_level());
+    }
+  }
+
+  /**
+   * @copydoc cpen333::thread::priority_fifo::peek()
+   */
+  ValueType peek() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [&](){ return size_ > 0; });
+    return ValueType(*front(top_level()));
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_peek()
+   */
+  bool try_peek(ValueType* out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (size_ == 0) {
+      return false;
+    }
+    if (out != nullptr) {
+      *out = *front(top_level());
+    }
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_peek_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_peek_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_peek_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_peek_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_peek_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!not_empty_.wait_until(lock, timeout, [&](){ return size_ > 0; })) {
+      return false;
+    }
+    if (out != nullptr) {
+      *out = *front(top_level());
+    }
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::size()
+   */
+  size_t size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+  }
+
+  /**
+   * @brief Number of items currently in a given priority level
+   * @param level priority level
+   * @return number of items
+   */
+  size_t size(size_t level) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lanes_[level].count;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::empty()
+   */
+  bool empty() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_ == 0;
+  }
+
+  /**
+   * @brief Number of priority levels
+   * @return number of levels
+   */
+  static constexpr size_t levels() {
+    return Levels;
+  }
+
+ private:
+
+  typedef typename std::aligned_storage<sizeof(ValueType), alignof(ValueType)>::type storage_type;
+
+  struct lane {
+    size_t head;   // slot of oldest item
+    size_t count;  // number of items
+  };
+
+  static size_t clamp(size_t level) {
+    return level < Levels ? level : Levels-1;
+  }
+
+  ValueType* slot(size_t level, size_t idx) {
+    return reinterpret_cast<ValueType*>(&data_[level*lane_size_ + idx]);
+  }
+
+  ValueType* front(size_t level) {
+    return slot(level, lanes_[level].head);
+  }
+
+  // highest non-empty level, mutex held and queue not empty
+  size_t top_level() const {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(mask_);
+#else
+    size_t level = Levels-1;
+    while ((mask_ & (uint64_t(1) << level)) == 0) {
+      --level;
+    }
+    return level;
+#endif
+  }
+
+  // constructs an item at the end of a level, mutex held and level not full
+  template<typename... Args>
+  void push_item(size_t level, Args&&... args) {
+    lane& l = lanes_[level];
+    size_t idx = l.head + l.count;
+    if (idx >= lane_size_) {
+      idx -= lane_size_;
+    }
+    new (slot(level, idx)) ValueType(std::forward<Args>(args)...);
+    ++l.count;
+    ++size_;
+    mask_ |= (uint64_t(1) << level);
+  }
+
+  // removes the front item of the highest non-empty level, mutex held and queue not empty
+  size_t pop_item(ValueType* val) {
+    size_t level = top_level();
+    lane& l = lanes_[level];
+    ValueType* ptr = slot(level, l.head);
+    if (val != nullptr) {
+      *val = std::move(*ptr);
+    }
+    ptr->~ValueType();
+    if (++l.head == lane_size_) {
+      l.head = 0;
+    }
+    --size_;
+    if (--l.count == 0) {
+      mask_ &= ~(uint64_t(1) << level);
+    }
+    return level;
+  }
+
+  storage_type* data_;                           // slots for all levels, level-major
+  size_t lane_size_;                             // capacity of each level
+  lane lanes_[Levels];                           // ring buffer state per level
+  uint64_t mask_;                                // bit i set if level i is non-empty
+  size_t size_;                                  // total number of items
+  std::mutex mutex_;                             // protects all levels
+  std::condition_variable not_full_[Levels];     // producers waiting for room in a level
+  std::condition_variable not_empty_;            // consumers waiting for an item
+
+};
+
+} // impl
+} // thread
+} // cpen333
+
+#endif //CPEN333_THREAD_PRIORITY_FIFO_LANES_H
@@ -0,0 +1,88 @@
+/**
+ * @file
+ * @brief List of selectors waiting on a shared buffer
+ */
+#ifndef CPEN333_THREAD_IMPL_SELECT_REGISTRY_H
+#define CPEN333_THREAD_IMPL_SELECT_REGISTRY_H
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "../../util.h"
+#include "wait_queue.h"
+
+namespace cpen333 {
+namespace thread {
+namespace impl {
+
+/**
+ * @brief Keeps track of the selectors attached to a buffer so they can be woken when data arrives
+ *
+ * Producers call notify() after publishing new data.  When no selector is attached, this is a single relaxed
+ * atomic load.  Selectors attach before checking the buffer's state under the buffer's own locks, which orders
+ * the attachment before any later producer's check.
+ */
+class select_registry {
+ public:
+  /**
+   * @brief Creates an empty registry
+   */
+  select_registry() : count_(0), mutex_(), waiters_() {}
+
+ private:
+  select_registry(const select_registry &) DELETE_METHOD;
+  select_registry(select_registry &&) DELETE_METHOD;
+  select_registry &operator=(const select_registry &) DELETE_METHOD;
+  select_registry &operator=(select_registry &&) DELETE_METHOD;
+
+ public:
+
+  /**
+   * @brief Adds a selector's wait queue to the list of queues to notify
+   * @param waiter selector wait queue
+   */
+  void attach(wait_queue* waiter) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    waiters_.push_back(waiter);
+    count_.store(waiters_.size(), std::memory_order_seq_cst);
+  }
+
+  /**
+   * @brief Removes a selector's wait queue from the list of queues to notify
+   * @param waiter selector wait queue
+   */
+  void detach(wait_queue* waiter) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find(waiters_.begin(), waiters_.end(), waiter);
+    if (it != waiters_.end()) {
+      waiters_.erase(it);
+    }
+    count_.store(waiters_.size(), std::memory_order_seq_cst);
+  }
+
+  /**
+   * @brief Wakes all attached selectors that are currently waiting
+   */
+  void notify() {
+    if (count_.load(std::memory_order_relaxed) == 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (wait_queue* waiter : waiters_) {
+      waiter->notify_all();
+    }
+  }
+
+ private:
+  std::atomic<size_t> count_;         // number of attached selectors, checked without locking
+  std::mutex mutex_;                  // protects list of selectors
+  std::vector<wait_queue*> waiters_;  // attached selectors
+
+};
+
+} // impl
+} // thread
+} // cpen333
+
+#endif //CPEN333_THREAD_IMPL_SELECT_REGISTRY_H
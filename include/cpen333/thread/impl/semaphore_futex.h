@@ -0,0 +1,243 @@
+/**
+ * @file
+ * @brief Futex-based semaphore implementation for Linux
+ */
+#ifndef CPEN333_THREAD_SEMAPHORE_FUTEX_H
+#define CPEN333_THREAD_SEMAPHORE_FUTEX_H
+
+#include "../../os.h"
+
+#ifdef LINUX
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include "../../util.h"
+#include "../../impl/futex.h"
+
+namespace cpen333 {
+namespace thread {
+namespace impl {
+
+/**
+ * @brief A local semaphore synchronization primitive built directly on a Linux futex
+ *
+ * The semaphore value is a single atomic word, and a separate count keeps track of threads sleeping in the
+ * kernel.  wait() and notify() are a single atomic operation when no thread needs to sleep, so the system
+ * is only entered when a waiter actually has to park, or when a notifier has a parked waiter to wake.
+ *
+ * Before parking, wait() spins for a short, adaptive number of iterations: the spin limit tracks a running
+ * average of how long recent successful spins took and decays when spinning fails, so the semaphore spins when
+ * notifications tend to arrive quickly and stops wasting cycles when they do not.
+ *
+ * The interface mirrors cpen333::thread::basic_semaphore.  The semaphore value is limited to 32 bits.
+ */
+class futex_semaphore {
+ public:
+  /**
+   * @brief Alias to native handle type, a pointer to the futex word holding the semaphore value
+   */
+  typedef cpen333::impl::futex_word* native_handle_type;
+
+  /**
+   * @brief Simple constructor that allows setting the initial count
+   * @param count resource count (default 1)
+   */
+  explicit futex_semaphore(size_t count = 1) :
+      count_{(uint32_t)count}, waiters_{0}, spin_{FUTEX_SEMAPHORE_INITIAL_SPIN} {}
+
+ private:
+  // do not allow copying or moving
+  futex_semaphore(const futex_semaphore&) DELETE_METHOD;
+  futex_semaphore(futex_semaphore&&) DELETE_METHOD;
+  futex_semaphore& operator=(const futex_semaphore&) DELETE_METHOD;
+  futex_semaphore& operator=(futex_semaphore&&) DELETE_METHOD;
+
+ public:
+
+  /**
+   * @copydoc cpen333::thread::basic_semaphore::notify()
+   */
+  void notify() {
+    notify(1);
+  }
+
+  /**
+   * @copydoc cpen333::thread::basic_semaphore::notify(size_t)
+   */
+  void notify(size_t count) {
+    if (count == 0) {
+      return;
+    }
+    // parked threads only sleep while the value is zero, so only the transition from zero needs a wake-up,
+    // later increments are passed along by the woken threads themselves (see take_parked())
+    uint32_t prev = count_.fetch_add((uint32_t)count, std::memory_order_seq_cst);
+    if (prev == 0 && waiters_.load(std::memory_order_seq_cst) != 0) {
+      cpen333::impl::futex_wake(&count_, count > INT_MAX ? INT_MAX : (int)count, false);
+    }
+  }
+
+  /**
+   * @copydoc cpen333::thread::basic_semaphore::wait()
+   */
+  void wait() {
+    wait_some(1);
+  }
+
+  /**
+   * @copydoc cpen333::thread::basic_semaphore::try_wait()
+   */
+  bool try_wait() {
+    return try_take(1) != 0;
+  }
+
+  /**
+   * @copydoc cpen333::thread::basic_semaphore::wait_some()
+   */
+  size_t wait_some(size_t max) {
+    if (max == 0) {
+      return 0;
+    }
+    size_t taken = spin_take(max);
+    if (taken != 0) {
+      return taken;
+    }
+
+    // park in the kernel until the value is non-zero
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    while ((taken = take_parked(max)) == 0) {
+      cpen333::impl::futex_wait(&count_, 0, false);
+    }
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+    return taken;
+  }
+
+  /**
+   * @copydoc cpen333::thread::basic_semaphore::try_wait_some()
+   */
+  size_t try_wait_some(size_t max) {
+    return try_take(max);
+  }
+
+  /**
+   * @copydoc cpen333::thread::basic_semaphore::wait_for()
+   */
+  template<class Rep, class Period>
+  bool wait_for(const std::chrono::duration<Rep, Period>& timeout_duration) {
+    return wait_until(std::chrono::steady_clock::now()+timeout_duration);
+  }
+
+  /**
+   * @copydoc cpen333::thread::basic_semaphore::wait_until()
+   */
+  template<class Clock, class Duration>
+  bool wait_until(const std::chrono::time_point<Clock, Duration>& timeout_time) {
+    if (spin_take(1) != 0) {
+      return true;
+    }
+
+    timespec timeout = cpen333::impl::monotonic_timespec(timeout_time);
+    bool success = false;
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    for (;;) {
+      if (take_parked(1) != 0) {
+        success = true;
+        break;
+      }
+      if (!cpen333::impl::futex_wait_until(&count_, 0, timeout, false)) {
+        success = (take_parked(1) != 0);  // last chance, value may have changed as we timed out
+        break;
+      }
+    }
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+    return success;
+  }
+
+  /**
+   * @brief Returns a native handle to the semaphore
+   *
+   * The native handle has a type aliased to futex_semaphore::native_handle_type.
+   *
+   * @return native semaphore handle
+   */
+  native_handle_type native_handle() {
+    return &count_;
+  }
+
+ private:
+
+  // decrements the value by up to max without blocking
+  size_t try_take(size_t max) {
+    uint32_t count = count_.load(std::memory_order_relaxed);
+    while (count != 0) {
+      uint32_t taken = (count < max) ? count : (uint32_t)max;
+      if (count_.compare_exchange_weak(count, count-taken, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed)) {
+        return taken;
+      }
+    }
+    return 0;
+  }
+
+  // decrements the value on behalf of a registered waiter, waking the next parked thread if some value is left
+  size_t take_parked(size_t max) {
+    uint32_t count = count_.load(std::memory_order_relaxed);
+    while (count != 0) {
+      uint32_t taken = (count < max) ? count : (uint32_t)max;
+      if (count_.compare_exchange_weak(count, count-taken, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed)) {
+        if (count != taken && waiters_.load(std::memory_order_seq_cst) > 1) {
+          cpen333::impl::futex_wake(&count_, 1, false);
+        }
+        return taken;
+      }
+    }
+    return 0;
+  }
+
+  // spins for a bounded number of iterations trying to decrement the value, adapting the bound
+  size_t spin_take(size_t max) {
+    size_t taken = try_take(max);
+    if (taken != 0 || max == 0) {
+      return taken;
+    }
+
+    int spin = spin_.load(std::memory_order_relaxed);
+    int limit = 2*spin + 10;
+    if (limit > FUTEX_SEMAPHORE_MAX_SPIN) {
+      limit = FUTEX_SEMAPHORE_MAX_SPIN;
+    }
+    int i = 0;
+    for (; i < limit; ++i) {
+      cpen333::impl::cpu_relax();
+      if (count_.load(std::memory_order_relaxed) != 0 && (taken = try_take(max)) != 0) {
+        break;
+      }
+    }
+    // running average of spins needed to succeed, similar to glibc's adaptive mutexes; back off if spinning
+    // did not help so that slow producers do not cost every waiter a full spin
+    if (taken != 0) {
+      spin_.store(spin + (i - spin)/8, std::memory_order_relaxed);
+    } else {
+      spin_.store(spin - spin/8 - (spin > 0 ? 1 : 0), std::memory_order_relaxed);
+    }
+    return taken;
+  }
+
+  static const int FUTEX_SEMAPHORE_INITIAL_SPIN = 50;
+  static const int FUTEX_SEMAPHORE_MAX_SPIN = 1000;
+
+  cpen333::impl::futex_word count_;   // semaphore value, also the futex word waiters sleep on
+  std::atomic<uint32_t> waiters_;     // number of threads parked (or about to park) in the kernel
+  std::atomic<int> spin_;             // average spin iterations before a successful decrement
+
+};
+
+} // impl
+} // thread
+} // cpen333
+
+#endif // LINUX
+
+#endif //CPEN333_THREAD_SEMAPHORE_FUTEX_H
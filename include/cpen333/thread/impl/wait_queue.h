@@ -0,0 +1,134 @@
+/**
+ * @file
+ * @brief Queue for parking threads until a lock-free condition is satisfied
+ */
+#ifndef CPEN333_THREAD_IMPL_WAIT_QUEUE_H
+#define CPEN333_THREAD_IMPL_WAIT_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include "../../util.h"
+
+namespace cpen333 {
+namespace thread {
+namespace impl {
+
+/**
+ * @brief Parks threads until a lock-free condition becomes `true`
+ *
+ * Waiters register themselves before re-checking the condition under an internal lock, and notifiers only
+ * touch that lock if a waiter is registered.  This makes notification a single fence and atomic load
+ * when nobody is waiting, so lock-free structures only pay for blocking when they actually block.
+ *
+ * The predicate passed to wait() is allowed to perform the operation being waited on (e.g. try to pop an
+ * item), in which case the operation is guaranteed to have completed when wait() returns.
+ */
+class wait_queue {
+ public:
+  /**
+   * @brief Creates an empty wait queue
+   */
+  wait_queue() : waiters_(0), mutex_(), cv_() {}
+
+ private:
+  wait_queue(const wait_queue &) DELETE_METHOD;
+  wait_queue(wait_queue &&) DELETE_METHOD;
+  wait_queue &operator=(const wait_queue &) DELETE_METHOD;
+  wait_queue &operator=(wait_queue &&) DELETE_METHOD;
+
+ public:
+
+  /**
+   * @brief Blocks the current thread until `pred()` returns `true`
+   *
+   * @tparam Predicate predicate type, with signature `bool operator()`
+   * @param pred condition to wait for, re-evaluated whenever the queue is notified
+   */
+  template<typename Predicate>
+  void wait(Predicate pred) {
+    if (pred()) {
+      return;
+    }
+    register_waiter();
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, pred);
+    }
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Blocks the current thread until `pred()` returns `true` or a timeout time has been reached
+   *
+   * @tparam Clock clock type
+   * @tparam Duration clock duration type
+   * @tparam Predicate predicate type, with signature `bool operator()`
+   * @param timeout absolute timeout time
+   * @param pred condition to wait for, re-evaluated whenever the queue is notified
+   * @return the final value of `pred()`
+   */
+  template<typename Clock, typename Duration, typename Predicate>
+  bool wait_until(const std::chrono::time_point<Clock, Duration>& timeout, Predicate pred) {
+    if (pred()) {
+      return true;
+    }
+    register_waiter();
+    bool success = false;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      success = cv_.wait_until(lock, timeout, pred);
+    }
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+    return success;
+  }
+
+  /**
+   * @brief Wakes a single waiting thread, if any
+   *
+   * Must be called after the state checked by waiters' predicates has been published.
+   */
+  void notify_one() {
+    if (has_waiters()) {
+      { std::lock_guard<std::mutex> lock(mutex_); }  // waiter is either before its check, or inside wait
+      cv_.notify_one();
+    }
+  }
+
+  /**
+   * @brief Wakes all waiting threads, if any
+   *
+   * Must be called after the state checked by waiters' predicates has been published.
+   */
+  void notify_all() {
+    if (has_waiters()) {
+      { std::lock_guard<std::mutex> lock(mutex_); }
+      cv_.notify_all();
+    }
+  }
+
+ private:
+
+  void register_waiter() {
+    waiters_.fetch_add(1, std::memory_order_relaxed);
+    // pairs with the fence in has_waiters(): either we see the notifier's update, or it sees us
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  bool has_waiters() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return waiters_.load(std::memory_order_relaxed) != 0;
+  }
+
+  std::atomic<size_t> waiters_;     // number of threads registered to wait
+  std::mutex mutex_;                // protects predicate check/sleep against notification
+  std::condition_variable cv_;      // parked threads
+
+};
+
+} // impl
+} // thread
+} // cpen333
+
+#endif //CPEN333_THREAD_IMPL_WAIT_QUEUE_H
@@ -0,0 +1,434 @@
+/**
+ * @file
+ * @brief Priority-ordered shared buffer
+ */
+#ifndef CPEN333_THREAD_PRIORITY_FIFO_H
+#define CPEN333_THREAD_PRIORITY_FIFO_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "../util.h"
+#include "impl/priority_fifo_lanes.h"
+
+namespace cpen333 {
+namespace thread {
+
+/**
+ * @brief Thread-safe bounded priority queue with the same interface as cpen333::thread::fifo
+ *
+ * Items are popped highest-priority first, where, as for std::priority_queue, an item `a` has lower priority than
+ * `b` if `Compare()(a, b)` is true.  Items of equal priority are popped in the order they were pushed.
+ *
+ * Items are kept in a 4-ary heap in a single array allocated at construction, so push and pop are O(log n)
+ * and never allocate.  Push blocks while the queue is full, and pop blocks while it is empty.
+ *
+ * For a small, fixed number of priority levels, see cpen333::thread::lane_priority_fifo, which has O(1) push and pop.
+ *
+ * @tparam ValueType type of data to store in the queue
+ * @tparam Compare comparison function object type, providing a strict weak ordering
+ */
+template<typename ValueType = unsigned long, typename Compare = std::less<ValueType>>
+class priority_fifo {
+
+ public:
+
+  /**
+   * @brief data type stored in buffer
+   */
+  using value_type = ValueType;
+
+  /**
+   * @brief Creates a priority fifo
+   * @param size the maximum number of elements that can be stored in the queue without blocking
+   * @param comp comparison function object
+   */
+  priority_fifo(size_t size = 1024, const Compare& comp = Compare()) :
+      heap_{nullptr}, size_{0}, capacity_{size}, seq_{0}, comp_(comp),
+      mutex_{}, not_full_{}, not_empty_{} {
+    heap_ = new node[size];  // uninitialized, items are constructed in place when pushed
+  }
+
+ private:
+  priority_fifo(const priority_fifo &) DELETE_METHOD;
+  priority_fifo(priority_fifo &&) DELETE_METHOD;
+  priority_fifo &operator=(const priority_fifo &) DELETE_METHOD;
+  priority_fifo &operator=(priority_fifo &&) DELETE_METHOD;
+
+ public:
+
+  /**
+   * @brief Destructor
+   *
+   * Invalidates and frees any data in the queue
+   */
+  ~priority_fifo() {
+    for (size_t i=0; i<size_; ++i) {
+      item(i)->~ValueType();
+    }
+    delete [] heap_;
+  }
+
+  /**
+   * @brief Add a item to the fifo
+   * @param val value to add
+   */
+  void push(const ValueType &val) {
+    emplace(val);
+  }
+
+  /**
+   * @brief Add a item to the fifo
+   * @param val value to add
+   */
+  void push(ValueType &&val) {
+    emplace(std::move(val));
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::emplace()
+   */
+  template<typename... Args>
+  void emplace(Args&&... args) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      not_full_.wait(lock, [&](){ return size_ < capacity_; });
+      push_item(ValueType(std::forward<Args>(args)...));
+    }
+    not_empty_.notify_one();
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_emplace()
+   */
+  template<typename... Args>
+  bool try_emplace(Args&&... args) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (size_ == capacity_) {
+        return false;
+      }
+      push_item(ValueType(std::forward<Args>(args)...));
+    }
+    not_empty_.notify_one();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_push()
+   */
+  bool try_push(const ValueType &val) {
+    return try_emplace(val);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_push_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_push_for(const ValueType& val, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_push_until(val, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_push_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_push_until(const ValueType& val, const std::chrono::time_point<Clock,Duration>& timeout) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (!not_full_.wait_until(lock, timeout, [&](){ return size_ < capacity_; })) {
+        return false;
+      }
+      push_item(ValueType(val));
+    }
+    not_empty_.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Removes the highest-priority item in the fifo
+   *
+   * Populates memory pointed to by `out` with the highest-priority item.  If there are no items in the fifo,
+   * then this will block until one is available.
+   *
+   * @param out destination.  If `nullptr`, item is removed but not returned.
+   */
+  void pop(ValueType* out) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      not_empty_.wait(lock, [&](){ return size_ > 0; });
+      pop_item(out);
+    }
+    not_full_.notify_one();
+  }
+
+  /**
+   * @brief Removes and returns the highest-priority item in the fifo
+   *
+   * If there are no items in the fifo, then this will block until one is available.
+   *
+   * @return highest-priority item
+   */
+  ValueType pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [&](){ return size_ > 0; });
+    ValueType out = take_item();
+    lock.unlock();
+    not_full_.notify_one();
+    return out;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop()
+   */
+  bool try_pop(ValueType* out) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (size_ == 0) {
+        return false;
+      }
+      pop_item(out);
+    }
+    not_full_.notify_one();
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_pop_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_pop_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_pop_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_pop_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (!not_empty_.wait_until(lock, timeout, [&](){ return size_ > 0; })) {
+        return false;
+      }
+      pop_item(out);
+    }
+    not_full_.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Looks at the highest-priority item in the fifo without removing it
+   *
+   * If there are no items in the fifo, then this will block until one is available.
+   *
+   * @param out destination
+   */
+  void peek(ValueType* out) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [&](){ return size_ > 0; });
+    if (out != nullptr) {
+      *out = *item(0);
+    }
+  }
+
+  /**
+   * @brief Returns a copy of the highest-priority item in the fifo without removing it
+   *
+   * If there are no items in the fifo, then this will block until one is available.
+   *
+   * @return copy of highest-priority item
+   */
+  ValueType peek() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [&](){ return size_ > 0; });
+    return ValueType(*item(0));
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_peek()
+   */
+  bool try_peek(ValueType* out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (size_ == 0) {
+      return false;
+    }
+    if (out != nullptr) {
+      *out = *item(0);
+    }
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_peek_for()
+   */
+  template <typename Rep, typename Period>
+  bool try_peek_for(ValueType* out, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_peek_until(out, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::try_peek_until()
+   */
+  template<typename Clock, typename Duration>
+  bool try_peek_until(ValueType* out, const std::chrono::time_point<Clock,Duration>& timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!not_empty_.wait_until(lock, timeout, [&](){ return size_ > 0; })) {
+      return false;
+    }
+    if (out != nullptr) {
+      *out = *item(0);
+    }
+    return true;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::size()
+   */
+  size_t size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+  }
+
+  /**
+   * @copydoc cpen333::thread::fifo::empty()
+   */
+  bool empty() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_ == 0;
+  }
+
+  /**
+   * @brief Maximum number of items that can be stored in the fifo without blocking
+   * @return capacity of fifo
+   */
+  size_t capacity() const {
+    return capacity_;
+  }
+
+ private:
+
+  static const size_t ARITY = 4;  // children per heap node, keeps the heap shallow and children on one cache line
+
+  typedef typename std::aligned_storage<sizeof(ValueType), alignof(ValueType)>::type storage_type;
+
+  struct node {
+    uint64_t seq;          // insertion order, breaks ties between equal priorities
+    storage_type storage;  // raw storage for item
+  };
+
+  ValueType* item(size_t idx) {
+    return reinterpret_cast<ValueType*>(&heap_[idx].storage);
+  }
+
+  // whether item a (pushed at sequence sa) should be popped before item b (pushed at sequence sb)
+  bool before(const ValueType& a, uint64_t sa, const ValueType& b, uint64_t sb) {
+    if (comp_(b, a)) {
+      return true;
+    } else if (comp_(a, b)) {
+      return false;
+    }
+    return sa < sb;
+  }
+
+  // moves the item in slot `from` into the empty slot `to`, leaving `from` empty
+  void move_node(size_t from, size_t to) {
+    new (item(to)) ValueType(std::move(*item(from)));
+    item(from)->~ValueType();
+    heap_[to].seq = heap_[from].seq;
+  }
+
+  // inserts an item, mutex held and queue not full
+  void push_item(ValueType&& val) {
+    uint64_t seq = seq_++;
+    // sift the hole up from the end until the parent comes before the new item
+    size_t hole = size_++;
+    while (hole > 0) {
+      size_t parent = (hole-1)/ARITY;
+      if (!before(val, seq, *item(parent), heap_[parent].seq)) {
+        break;
+      }
+      move_node(parent, hole);
+      hole = parent;
+    }
+    new (item(hole)) ValueType(std::move(val));
+    heap_[hole].seq = seq;
+  }
+
+  // removes the top item, leaving the root slot empty, mutex held and queue not empty
+  void remove_top() {
+    item(0)->~ValueType();
+    size_t last = --size_;
+    if (last == 0) {
+      return;
+    }
+    // sift the hole down from the root until the last item fits
+    ValueType& val = *item(last);
+    uint64_t seq = heap_[last].seq;
+    size_t hole = 0;
+    for (;;) {
+      size_t child = hole*ARITY+1;
+      if (child >= last) {
+        break;
+      }
+      size_t end = (child+ARITY < last) ? child+ARITY : last;
+      size_t best = child;
+      for (size_t c = child+1; c < end; ++c) {
+        if (before(*item(c), heap_[c].seq, *item(best), heap_[best].seq)) {
+          best = c;
+        }
+      }
+      if (!before(*item(best), heap_[best].seq, val, seq)) {
+        break;
+      }
+      move_node(best, hole);
+      hole = best;
+    }
+    move_node(last, hole);
+  }
+
+  void pop_item(ValueType* val) {
+    if (val != nullptr) {
+      *val = std::move(*item(0));
+    }
+    remove_top();
+  }
+
+  ValueType take_item() {
+    ValueType out(std::move(*item(0)));
+    remove_top();
+    return out;
+  }
+
+  node* heap_;                          // heap of items, root at index 0
+  size_t size_;                         // number of items in heap
+  size_t capacity_;                     // maximum number of items
+  uint64_t seq_;                        // next insertion sequence number
+  Compare comp_;                        // priority comparison
+  std::mutex mutex_;                    // protects heap
+  std::condition_variable not_full_;    // producers waiting for room
+  std::condition_variable not_empty_;   // consumers waiting for an item
+
+};
+
+/**
+ * @brief Priority fifo with a fixed number of priority levels and the same interface as cpen333::thread::fifo
+ *
+ * Alias to cpen333::thread::impl::priority_fifo_lanes.  Each level is its own ring buffer, so push and pop are O(1).
+ * Items are pushed with an explicit level, and higher levels are popped first.
+ *
+ * @tparam ValueType type of data to store in the queue
+ * @tparam Levels number of priority levels, at most 64
+ */
+template<typename ValueType = unsigned long, size_t Levels = 4>
+using lane_priority_fifo = impl::priority_fifo_lanes<ValueType, Levels>;
+
+} // thread
+} // cpen333
+
+#endif //CPEN333_THREAD_PRIORITY_FIFO_H
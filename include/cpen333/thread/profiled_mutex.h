@@ -0,0 +1,68 @@
+/**
+ * @file
+ * @brief Named thread lock that can record its contention statistics
+ */
+#ifndef CPEN333_THREAD_PROFILED_MUTEX_H
+#define CPEN333_THREAD_PROFILED_MUTEX_H
+
+#include <mutex>
+#include <string>
+#include "../util.h"
+
+#ifdef CPEN333_PROFILE_LOCKS
+#include "../process/impl/lock_profile.h"
+#endif
+
+namespace cpen333 {
+namespace thread {
+
+#ifdef CPEN333_PROFILE_LOCKS
+
+/**
+ * @brief A thread lock with a name, under which its contention statistics are recorded
+ *
+ * Records the acquisition count, contended count, and wait-time and hold-time histograms of the wrapped lock in a
+ * shared memory block named after the lock, so that they can be printed or reset with the `lock_stats` tool while
+ * the program runs.  Locks in different processes with the same name share their statistics.
+ *
+ * @tparam Mutex lock type, such as std::mutex or std::timed_mutex
+ */
+template<typename Mutex = std::mutex>
+class profiled_mutex : public cpen333::process::impl::profiled_mutex<Mutex> {
+ public:
+  /**
+   * @brief Constructs the lock
+   * @param name name under which to record the lock's statistics
+   */
+  explicit profiled_mutex(const std::string& name) :
+      cpen333::process::impl::profiled_mutex<Mutex>(name) {}
+};
+
+#else
+
+/**
+ * @brief A thread lock with a name, under which its contention statistics are recorded
+ *
+ * Statistics are only recorded if CPEN333_PROFILE_LOCKS is defined.  Otherwise this is the wrapped lock itself,
+ * and the name is ignored.
+ *
+ * @tparam Mutex lock type, such as std::mutex or std::timed_mutex
+ */
+template<typename Mutex = std::mutex>
+class profiled_mutex : public Mutex {
+ public:
+  /**
+   * @brief Constructs the lock
+   * @param name name under which to record the lock's statistics
+   */
+  explicit profiled_mutex(const std::string& name) : Mutex() {
+    UNUSED(name);
+  }
+};
+
+#endif
+
+} // thread
+} // cpen333
+
+#endif //CPEN333_THREAD_PROFILED_MUTEX_H
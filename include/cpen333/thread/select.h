@@ -0,0 +1,190 @@
+/**
+ * @file
+ * @brief Waiting on multiple first-in-first-out buffers at once
+ */
+#ifndef CPEN333_THREAD_SELECT_H
+#define CPEN333_THREAD_SELECT_H
+
+#include <chrono>
+#include <vector>
+#include "../util.h"
+#include "fifo.h"
+#include "impl/wait_queue.h"
+#include "impl/select_registry.h"
+
+namespace cpen333 {
+namespace thread {
+
+/**
+ * @brief Blocks until any one of a set of fifos has an item available
+ *
+ * Fifos are added to the selector, and are identified by the index returned by add().  A call to select()
+ * blocks until at least one of the fifos is non-empty, then returns its index so the item can be popped.
+ * This allows a single thread to consume from many fifos without polling or dedicating a thread per fifo.
+ *
+ * By default, the lowest-index ready fifo is selected, so fifos added earlier take priority.  If constructed
+ * in round-robin mode, the search for a ready fifo starts just after the previously selected one, so a busy fifo
+ * cannot starve the others.
+ *
+ * A fifo only pays for notifying a selector while one is attached.  Fifos must outlive any selector they are
+ * added to.  If other threads also consume from the fifos, the selected fifo may be empty again by the time it
+ * is popped, in which case try_pop() should be used.
+ *
+ * Example:
+ * @code
+ * cpen333::thread::fifo<int> a, b;
+ * cpen333::thread::selector sel;
+ * sel.add(a);
+ * sel.add(b);
+ * size_t idx = sel.select();
+ * int val = (idx == 0) ? a.pop() : b.pop();
+ * @endcode
+ */
+class selector {
+ public:
+  /**
+   * @brief Creates an empty selector
+   * @param round_robin if `true`, searches for a ready fifo starting after the one last selected,
+   *        otherwise always starts at the first fifo added
+   */
+  explicit selector(bool round_robin = false) :
+      entries_{}, waitq_{}, round_robin_{round_robin}, next_{0} {}
+
+ private:
+  selector(const selector &) DELETE_METHOD;
+  selector(selector &&) DELETE_METHOD;
+  selector &operator=(const selector &) DELETE_METHOD;
+  selector &operator=(selector &&) DELETE_METHOD;
+
+ public:
+
+  /**
+   * @brief Destructor, detaches from all fifos
+   */
+  ~selector() {
+    for (entry& e : entries_) {
+      e.registry->detach(&waitq_);
+    }
+  }
+
+  /**
+   * @brief Adds a fifo to the set being waited on
+   *
+   * Must not be called while another thread is blocked in select() on this selector.
+   *
+   * @tparam ValueType fifo value type
+   * @param fifo fifo to add, must outlive the selector
+   * @return index identifying the fifo in results of select()
+   */
+  template<typename ValueType>
+  size_t add(cpen333::thread::fifo<ValueType>& fifo) {
+    entry e;
+    e.fifo = &fifo;
+    e.registry = &fifo.selectors_;
+    e.ready = &fifo_ready<ValueType>;
+    e.registry->attach(&waitq_);
+    entries_.push_back(e);
+    return entries_.size()-1;
+  }
+
+  /**
+   * @brief Number of fifos added to the selector
+   * @return number of fifos
+   */
+  size_t size() const {
+    return entries_.size();
+  }
+
+  /**
+   * @brief Waits until one of the fifos has an item available
+   *
+   * Blocks until at least one fifo is non-empty.  Should not be called if no fifos have been added.
+   *
+   * @return index of a non-empty fifo
+   */
+  size_t select() {
+    size_t idx = 0;
+    waitq_.wait([&](){ return find_ready(&idx); });
+    return idx;
+  }
+
+  /**
+   * @brief Checks if one of the fifos has an item available without blocking
+   *
+   * @param idx destination for the index of a non-empty fifo
+   * @return `true` if a fifo is non-empty, `false` otherwise
+   */
+  bool try_select(size_t* idx) {
+    return find_ready(idx);
+  }
+
+  /**
+   * @brief Waits until one of the fifos has an item available, or until a timeout period has elapsed
+   *
+   * @tparam Rep duration representation
+   * @tparam Period duration period
+   * @param idx destination for the index of a non-empty fifo
+   * @param rel_time relative timeout time
+   * @return `true` if a fifo became non-empty within the timeout time, `false` otherwise
+   */
+  template <typename Rep, typename Period>
+  bool try_select_for(size_t* idx, const std::chrono::duration<Rep, Period>& rel_time) {
+    return try_select_until(idx, std::chrono::steady_clock::now()+rel_time);
+  }
+
+  /**
+   * @brief Waits until one of the fifos has an item available, or until a timeout time is reached
+   *
+   * @tparam Clock clock type
+   * @tparam Duration clock duration type
+   * @param idx destination for the index of a non-empty fifo
+   * @param timeout absolute timeout time
+   * @return `true` if a fifo became non-empty before the timeout time, `false` otherwise
+   */
+  template<typename Clock, typename Duration>
+  bool try_select_until(size_t* idx, const std::chrono::time_point<Clock,Duration>& timeout) {
+    return waitq_.wait_until(timeout, [&](){ return find_ready(idx); });
+  }
+
+ private:
+
+  template<typename ValueType>
+  static bool fifo_ready(void* fifo) {
+    return !static_cast<cpen333::thread::fifo<ValueType>*>(fifo)->empty();
+  }
+
+  // scans fifos for one with an item, starting at the first or after the last selected
+  bool find_ready(size_t* idx) {
+    size_t n = entries_.size();
+    size_t start = round_robin_ ? next_ : 0;
+    for (size_t i=0; i<n; ++i) {
+      size_t j = start + i;
+      if (j >= n) {
+        j -= n;
+      }
+      if (entries_[j].ready(entries_[j].fifo)) {
+        next_ = (j+1 == n) ? 0 : j+1;
+        *idx = j;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  struct entry {
+    void* fifo;                                       // fifo being waited on
+    cpen333::thread::impl::select_registry* registry; // fifo's list of selectors
+    bool (*ready)(void*);                             // checks if fifo is non-empty
+  };
+
+  std::vector<entry> entries_;                 // fifos, in order added
+  cpen333::thread::impl::wait_queue waitq_;    // woken by fifos when items are pushed
+  bool round_robin_;                           // start search after last selected fifo
+  size_t next_;                                // where to start next round-robin search
+
+};
+
+} // thread
+} // cpen333
+
+#endif //CPEN333_THREAD_SELECT_H
@@ -9,6 +9,8 @@
 #include <condition_variable>
 #include <chrono>
 #include "../util.h"
+#include "../os.h"
+#include "impl/semaphore_futex.h"
 
 namespace cpen333 {
 namespace thread {
@@ -65,6 +67,26 @@ class basic_semaphore {
     cv_.notify_one();
   }
 
+  /**
+   * @brief Increments the semaphore value by a given count
+   *
+   * Equivalent to calling notify() `count` times, but only locks the semaphore once.
+   *
+   * @param count amount to increment the semaphore by
+   */
+  void notify(size_t count) {
+    if (count == 0) {
+      return;
+    }
+    std::lock_guard<Mutex> lock(mutex_);
+    count_ += count;
+    if (count == 1) {
+      cv_.notify_one();
+    } else {
+      cv_.notify_all();
+    }
+  }
+
   /**
    * @brief Waits for and decrements the semaphore value
    *
@@ -93,6 +115,38 @@ class basic_semaphore {
     return false;
   }
 
+  /**
+   * @brief Waits for the semaphore, then decrements it by as much as possible up to a maximum
+   *
+   * Blocks until the value is greater than zero, then decrements it by up to `max` in a single step.
+   *
+   * @param max maximum amount to decrement the semaphore by
+   * @return amount the semaphore was decremented by, between 1 and `max` (0 only if `max` is 0)
+   */
+  size_t wait_some(size_t max) {
+    if (max == 0) {
+      return 0;
+    }
+    std::unique_lock<Mutex> lock(mutex_);
+    cv_.wait(lock, [&]{ return count_ > 0; });
+    size_t taken = (count_ < max) ? count_ : max;
+    count_ -= taken;
+    return taken;
+  }
+
+  /**
+   * @brief Decrements the semaphore by as much as possible up to a maximum, returning immediately
+   *
+   * @param max maximum amount to decrement the semaphore by
+   * @return amount the semaphore was decremented by, 0 if the value was zero
+   */
+  size_t try_wait_some(size_t max) {
+    std::lock_guard<Mutex> lock(mutex_);
+    size_t taken = (count_ < max) ? count_ : max;
+    count_ -= taken;
+    return taken;
+  }
+
   /**
    * @brief Tries to wait for the semaphore for up to a maximum timeout duration
    *
@@ -153,10 +207,20 @@ class basic_semaphore {
   size_t  count_;
 };
 
+#ifdef LINUX
+/**
+ * @brief Alias to default semaphore implementation, a futex-based semaphore on Linux
+ *
+ * Avoids locking and system calls when the semaphore is not contended.  Falls back to basic_semaphore
+ * with std::mutex and std::condition_variable on other platforms.
+ */
+typedef impl::futex_semaphore semaphore;
+#else
 /**
  * @brief Alias to default semaphore implementation with std::mutex and std::condition_variable
  */
 typedef basic_semaphore<std::mutex, std::condition_variable> semaphore;
+#endif
 
 /**
  * @brief Semaphore guard, similar to std::lock_guard
@@ -0,0 +1,261 @@
+/**
+ * @file
+ * @brief Work-stealing pool of worker threads
+ */
+#ifndef CPEN333_THREAD_THREAD_POOL_H
+#define CPEN333_THREAD_THREAD_POOL_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../util.h"
+#include "thread_object.h"
+#include "impl/wait_queue.h"
+
+namespace cpen333 {
+namespace thread {
+
+/**
+ * @brief Fixed-size pool of worker threads that execute submitted tasks
+ *
+ * Each worker owns a double-ended task queue.  Tasks submitted from inside a worker (e.g. a task that splits
+ * itself into sub-tasks) go onto that worker's own queue, which it processes newest-first for cache locality.
+ * Tasks submitted from any other thread go onto a shared injection queue.  A worker that runs out of work
+ * first checks the injection queue, then steals the oldest task from another worker's queue, so load balances
+ * itself without a single contended queue.  Workers with nothing to do park until new work is submitted,
+ * and submitting only wakes a worker if one is actually parked.
+ *
+ * Tasks are any callable with arguments, and submit() returns a std::future for the task's result.
+ * Exceptions thrown by a task are stored in its future.
+ *
+ * Example:
+ * @code
+ * cpen333::thread::thread_pool pool;
+ * std::future<int> result = pool.submit([](int a, int b) { return a + b; }, 1, 2);
+ * std::cout << result.get() << std::endl;
+ * @endcode
+ */
+class thread_pool {
+ public:
+  /**
+   * @brief Creates a pool and starts its worker threads
+   * @param nthreads number of worker threads, defaults to the number of hardware threads
+   */
+  explicit thread_pool(size_t nthreads = 0) :
+      workers_{}, queues_{}, global_{}, gmutex_{}, waitq_{}, stop_{false} {
+    if (nthreads == 0) {
+      nthreads = std::thread::hardware_concurrency();
+      if (nthreads == 0) {
+        nthreads = 1;
+      }
+    }
+    for (size_t i=0; i<nthreads; ++i) {
+      queues_.push_back(std::unique_ptr<task_queue>(new task_queue()));
+    }
+    for (size_t i=0; i<nthreads; ++i) {
+      workers_.push_back(std::unique_ptr<worker>(new worker(*this, i)));
+    }
+    for (auto& w : workers_) {
+      w->start();
+    }
+  }
+
+ private:
+  thread_pool(const thread_pool &) DELETE_METHOD;
+  thread_pool(thread_pool &&) DELETE_METHOD;
+  thread_pool &operator=(const thread_pool &) DELETE_METHOD;
+  thread_pool &operator=(thread_pool &&) DELETE_METHOD;
+
+ public:
+
+  /**
+   * @brief Destructor, runs all tasks already submitted and then stops the worker threads
+   */
+  ~thread_pool() {
+    stop_.store(true);
+    waitq_.notify_all();
+    for (auto& w : workers_) {
+      w->join();
+    }
+  }
+
+  /**
+   * @brief Submits a task to be run by one of the workers
+   *
+   * @tparam Func callable type
+   * @tparam Args argument types
+   * @param func callable to run
+   * @param args arguments to pass to the callable, copied or moved into the task
+   * @return future holding the result of the task
+   */
+  template<typename Func, typename... Args>
+  std::future<typename std::result_of<Func(Args...)>::type> submit(Func&& func, Args&&... args) {
+    typedef typename std::result_of<Func(Args...)>::type result_type;
+    std::packaged_task<result_type()> ptask(std::bind(std::forward<Func>(func), std::forward<Args>(args)...));
+    std::future<result_type> future = ptask.get_future();
+    enqueue(task(std::move(ptask)));
+    return future;
+  }
+
+  /**
+   * @brief Number of worker threads
+   * @return number of workers
+   */
+  size_t size() const {
+    return workers_.size();
+  }
+
+ private:
+
+  // move-only type-erased callable, since std::function requires copyable targets such as std::packaged_task
+  class task {
+    struct callable {
+      virtual ~callable() {}
+      virtual void operator()() = 0;
+    };
+
+    template<typename Func>
+    struct callable_impl : public callable {
+      Func func;
+      callable_impl(Func f) : func(std::move(f)) {}
+      void operator()() {
+        func();
+      }
+    };
+
+    std::unique_ptr<callable> impl_;
+
+   public:
+    task() : impl_() {}
+
+    template<typename Func>
+    explicit task(Func func) : impl_(new callable_impl<Func>(std::move(func))) {}
+
+    task(task&& other) : impl_(std::move(other.impl_)) {}
+
+    task& operator=(task&& other) {
+      impl_ = std::move(other.impl_);
+      return *this;
+    }
+
+    void operator()() {
+      (*impl_)();
+    }
+  };
+
+  // a worker's own queue, the owner uses the back and thieves take from the front
+  struct task_queue {
+    std::mutex mutex;
+    std::deque<task> tasks;
+    char pad[CPEN333_CACHE_LINE_SIZE];  // keep neighbouring queues' locks off the same cache line
+  };
+
+  class worker final : public cpen333::thread::thread_object {
+    thread_pool& pool_;
+    size_t idx_;
+   public:
+    worker(thread_pool& pool, size_t idx) : pool_(pool), idx_(idx) {}
+   protected:
+    int main() {
+      pool_.run(idx_);
+      return 0;
+    }
+  };
+
+  // worker of this thread, if the current thread is a worker of any pool
+  static std::pair<thread_pool*, size_t>& current_worker() {
+    static thread_local std::pair<thread_pool*, size_t> current(nullptr, 0);
+    return current;
+  }
+
+  void enqueue(task&& t) {
+    std::pair<thread_pool*, size_t>& current = current_worker();
+    if (current.first == this) {
+      task_queue& q = *queues_[current.second];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      q.tasks.push_back(std::move(t));
+    } else {
+      std::lock_guard<std::mutex> lock(gmutex_);
+      global_.push_back(std::move(t));
+    }
+    waitq_.notify_one();  // only touches a lock if a worker is parked
+  }
+
+  // finds the next task for worker idx: own queue (newest), then injection queue, then steal (oldest)
+  // if `block` is false, victims whose queues are locked are skipped rather than waited on
+  bool next_task(size_t idx, task* out, bool block) {
+    {
+      task_queue& q = *queues_[idx];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      if (!q.tasks.empty()) {
+        *out = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        return true;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(gmutex_);
+      if (!global_.empty()) {
+        *out = std::move(global_.front());
+        global_.pop_front();
+        return true;
+      }
+    }
+    size_t n = queues_.size();
+    for (size_t i=1; i<n; ++i) {
+      task_queue& q = *queues_[(idx+i) % n];
+      std::unique_lock<std::mutex> lock(q.mutex, std::defer_lock);
+      if (block) {
+        lock.lock();
+      } else if (!lock.try_lock()) {
+        continue;
+      }
+      if (!q.tasks.empty()) {
+        *out = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void run(size_t idx) {
+    current_worker() = std::make_pair(this, idx);
+    task t;
+    for (;;) {
+      if (!next_task(idx, &t, false)) {
+        // park until there is work, or until stopped with nothing left to do
+        bool found = false;
+        waitq_.wait([&](){
+          found = next_task(idx, &t, true);
+          return found || stop_.load();
+        });
+        if (!found) {
+          break;
+        }
+      }
+      t();
+    }
+    current_worker() = std::make_pair(nullptr, 0);
+  }
+
+  std::vector<std::unique_ptr<worker>> workers_;          // worker threads
+  std::vector<std::unique_ptr<task_queue>> queues_;       // per-worker queues
+  std::deque<task> global_;                               // injection queue for tasks from outside the pool
+  std::mutex gmutex_;                                     // protects injection queue
+  cpen333::thread::impl::wait_queue waitq_;               // parked idle workers
+  std::atomic<bool> stop_;                                // no more tasks will be submitted from outside
+
+};
+
+} // thread
+} // cpen333
+
+#endif //CPEN333_THREAD_THREAD_POOL_H
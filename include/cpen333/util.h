@@ -47,6 +47,21 @@
  */
 #define UNUSED(X) (void)(X)
 
+/**
+ * @brief Assumed size of a cache line, used to keep data written by different threads/processes apart
+ */
+#define CPEN333_CACHE_LINE_SIZE 64
+
+#ifndef CPEN333_ATTACH_TIMEOUT_MS
+/**
+ * @brief Maximum time in milliseconds to wait for another process to finish creating a shared resource
+ *
+ * Creating a resource only takes a moment, so a creator that has not finished by then has most likely died part
+ * way through.  May be defined before including any library header to change it.
+ */
+#define CPEN333_ATTACH_TIMEOUT_MS 5000
+#endif
+
 namespace cpen333 {
 
 #if !defined(WINDOWS)
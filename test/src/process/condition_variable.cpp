@@ -0,0 +1,99 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <cpen333/process/condition_variable.h>
+#include <cpen333/process/mutex.h>
+
+#include "../test.h"
+
+//
+//  Checks that notify_all() wakes every waiter, including those requeued onto the mutex, over repeated rounds,
+//  and that notify_one() hands each notification to exactly one waiter.
+//
+
+static const int waiters = 4;
+
+void test_notify_all(const std::string& name) {
+  cpen333::process::mutex mutex(name);
+  cpen333::process::condition_variable cv(name);
+  long round = 0;  // only touched under the mutex, all threads share this process
+  std::atomic<int> timeouts{0};
+  std::atomic<int> ready{0};
+
+  std::vector<std::thread> threads;
+  for (int i=0; i<waiters; ++i) {
+    threads.emplace_back([&](){
+      for (long r=0; r<100; ++r) {
+        std::unique_lock<cpen333::process::mutex> lock(mutex);
+        ++ready;
+        if (!cv.wait_for(lock, std::chrono::seconds(2), [&](){ return round > r; })) {
+          ++timeouts;
+          return;
+        }
+      }
+    });
+  }
+
+  for (long r=0; r<100; ++r) {
+    // wait until everyone is waiting for this round, so that notify_all must wake them all at once
+    while (ready < waiters*(r+1) && timeouts == 0) {
+      std::this_thread::yield();
+    }
+    std::lock_guard<cpen333::process::mutex> lock(mutex);
+    ++round;
+    cv.notify_all();
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  CHECK(timeouts == 0);
+  cv.unlink();
+  mutex.unlink();
+}
+
+void test_notify_one(const std::string& name) {
+  cpen333::process::mutex mutex(name);
+  cpen333::process::condition_variable cv(name);
+  int tokens = 0;
+  std::atomic<int> consumed{0};
+  std::atomic<int> timeouts{0};
+  const int per_waiter = 50;
+
+  std::vector<std::thread> threads;
+  for (int i=0; i<waiters; ++i) {
+    threads.emplace_back([&](){
+      for (int j=0; j<per_waiter; ++j) {
+        std::unique_lock<cpen333::process::mutex> lock(mutex);
+        if (!cv.wait_for(lock, std::chrono::seconds(2), [&](){ return tokens > 0; })) {
+          ++timeouts;
+          return;
+        }
+        --tokens;
+        ++consumed;
+      }
+    });
+  }
+
+  for (int i=0; i<waiters*per_waiter; ++i) {
+    {
+      std::lock_guard<cpen333::process::mutex> lock(mutex);
+      ++tokens;
+    }
+    cv.notify_one();
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  CHECK(timeouts == 0);
+  CHECK(consumed == waiters*per_waiter);
+  cv.unlink();
+  mutex.unlink();
+}
+
+int main() {
+  test_notify_all(cpen333::test::unique_name("cv_all"));
+  test_notify_one(cpen333::test::unique_name("cv_one"));
+  return cpen333::test::report("process_condition_variable");
+}
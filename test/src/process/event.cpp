@@ -0,0 +1,109 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <cpen333/process/event.h>
+
+#include "../test.h"
+
+//
+//  Checks the two event modes:  a manual-reset set() latches until reset(), an auto-reset set() lets exactly one
+//  waiter through, and notify_one()/notify_all() never latch.
+//
+
+static const int waiters = 4;
+
+// starts waiters that each wait once, returns once they have had time to block
+void start_waiters(cpen333::process::event& ev, std::vector<std::thread>& threads, std::atomic<int>& woken) {
+  for (int i=0; i<waiters; ++i) {
+    threads.emplace_back([&](){
+      if (ev.wait_for(std::chrono::milliseconds(500))) {
+        ++woken;
+      }
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+}
+
+void join(std::vector<std::thread>& threads) {
+  for (auto& t : threads) {
+    t.join();
+  }
+  threads.clear();
+}
+
+void test_manual_reset(const std::string& name) {
+  cpen333::process::event ev(name, cpen333::process::event_mode::manual_reset);
+  CHECK(ev.mode() == cpen333::process::event_mode::manual_reset);
+  CHECK(!ev.wait_for(std::chrono::milliseconds(1)));
+
+  std::vector<std::thread> threads;
+  std::atomic<int> woken{0};
+  start_waiters(ev, threads, woken);
+  ev.set();
+  join(threads);
+  CHECK(woken == waiters);
+
+  // latched until reset
+  CHECK(ev.wait_for(std::chrono::milliseconds(1)));
+  CHECK(ev.wait_for(std::chrono::milliseconds(1)));
+  ev.reset();
+  CHECK(!ev.wait_for(std::chrono::milliseconds(1)));
+  ev.unlink();
+}
+
+void test_auto_reset(const std::string& name) {
+  cpen333::process::event ev(name, cpen333::process::event_mode::auto_reset);
+  CHECK(ev.mode() == cpen333::process::event_mode::auto_reset);
+
+  // latches for the next waiter only
+  ev.set();
+  CHECK(ev.wait_for(std::chrono::milliseconds(1)));
+  CHECK(!ev.wait_for(std::chrono::milliseconds(1)));
+
+  // releases exactly one of several waiters
+  std::vector<std::thread> threads;
+  std::atomic<int> woken{0};
+  start_waiters(ev, threads, woken);
+  ev.set();
+  join(threads);
+  CHECK(woken == 1);
+  CHECK(!ev.wait_for(std::chrono::milliseconds(1)));
+
+  // reset clears a pending latch
+  ev.set();
+  ev.reset();
+  CHECK(!ev.wait_for(std::chrono::milliseconds(1)));
+  ev.unlink();
+}
+
+void test_notify(const std::string& name) {
+  cpen333::process::event ev(name);
+
+  std::vector<std::thread> threads;
+  std::atomic<int> woken{0};
+  start_waiters(ev, threads, woken);
+  ev.notify_one();
+  join(threads);
+  CHECK(woken == 1);
+
+  woken = 0;
+  start_waiters(ev, threads, woken);
+  ev.notify_all();
+  join(threads);
+  CHECK(woken == waiters);
+
+  // nothing latched by either
+  ev.notify_one();
+  ev.notify_all();
+  CHECK(!ev.wait_for(std::chrono::milliseconds(1)));
+  ev.unlink();
+}
+
+int main() {
+  test_manual_reset(cpen333::test::unique_name("event_manual"));
+  test_auto_reset(cpen333::test::unique_name("event_auto"));
+  test_notify(cpen333::test::unique_name("event_notify"));
+  return cpen333::test::report("process_event");
+}
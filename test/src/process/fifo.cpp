@@ -0,0 +1,151 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <cpen333/process/fifo.h>
+#include <cpen333/process/message_queue.h>
+
+#include "../test.h"
+
+//
+//  Checks the shared-memory fifos:  a full fifo reports its capacity as its size, batches keep their order,
+//  a second handle to the same name sees the same items, and lock-free peeks are never torn.
+//
+
+template<typename Fifo>
+void test_basics(const std::string& name) {
+  Fifo fifo(name, 4);
+  Fifo other(name, 4);  // attaches to the existing fifo
+
+  for (int i=0; i<4; ++i) {
+    fifo.push(i);
+  }
+  CHECK(other.size() == 4);
+  CHECK(!other.empty());
+  CHECK(!other.try_push(4));
+  CHECK(other.peek() == 0);
+  CHECK(other.pop() == 0);
+  CHECK(fifo.size() == 3);
+
+  int out[4];
+  CHECK(other.try_pop_n(out, 4) == 3);
+  CHECK(out[0] == 1 && out[2] == 3);
+  CHECK(fifo.empty());
+  CHECK(!fifo.try_pop_for(out, std::chrono::milliseconds(1)));
+
+  int in[3] = {5, 6, 7};
+  fifo.push_n(in, 3);
+  std::vector<int> rest;
+  CHECK(other.try_pop_all(rest) == 3);
+  CHECK(rest.size() == 3 && rest[0] == 5 && rest[2] == 7);
+
+  fifo.unlink();
+}
+
+// a consumer blocked in pop must be woken even when a peeker is waiting for the same push
+template<typename Fifo>
+void test_pop_wakeup(const std::string& name) {
+  Fifo fifo(name, 4);
+  int stranded = 0;
+  for (int r=0; r<50; ++r) {
+    std::atomic<bool> popped{false};
+    std::thread popper([&](){
+      int val;
+      popped = fifo.try_pop_for(&val, std::chrono::seconds(1));
+    });
+    std::thread peeker([&](){
+      int val;
+      fifo.try_peek_for(&val, std::chrono::seconds(1));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    fifo.push(r);
+    popper.join();
+    fifo.push(-1);
+    peeker.join();
+    int val;
+    while (fifo.try_pop(&val)) {}
+    if (!popped) {
+      ++stranded;
+    }
+  }
+  CHECK(stranded == 0);
+  fifo.unlink();
+}
+
+struct frame {
+  long words[16];
+};
+
+void test_lockfree_peek_not_torn(const std::string& name) {
+  cpen333::process::lockfree_fifo<frame> fifo(name, 4);
+  const long count = 100000;
+  std::atomic<bool> done{false};
+  std::atomic<long> torn{0};
+
+  std::thread producer([&](){
+    frame f;
+    for (long i=0; i<count; ++i) {
+      for (auto& w : f.words) {
+        w = i;
+      }
+      fifo.push(f);
+    }
+  });
+  std::thread consumer([&](){
+    frame f;
+    for (long i=0; i<count; ++i) {
+      fifo.pop(&f);
+    }
+    done = true;
+  });
+  std::thread peeker([&](){
+    frame f;
+    while (!done) {
+      if (fifo.try_peek(&f)) {
+        for (auto& w : f.words) {
+          if (w != f.words[0]) {
+            ++torn;
+            break;
+          }
+        }
+      }
+    }
+  });
+  producer.join();
+  consumer.join();
+  peeker.join();
+  CHECK(torn == 0);
+  fifo.unlink();
+}
+
+void test_message_queue_batches(const std::string& name) {
+  cpen333::process::message_queue<int> queue(name, 8);
+  int in[5] = {0, 1, 2, 3, 4};
+  queue.send_n(in, 5);
+  CHECK(queue.size() == 5);
+  int out[8];
+  CHECK(queue.receive_n(out, 8) == 5);
+  CHECK(out[0] == 0 && out[4] == 4);
+  CHECK(queue.empty());
+  queue.unlink();
+}
+
+int main() {
+  using namespace cpen333::process;
+  using cpen333::test::unique_name;
+
+  test_basics<fifo<int>>(unique_name("fifo"));
+  test_basics<compact_fifo<int>>(unique_name("compact_fifo"));
+  test_basics<lockfree_fifo<int>>(unique_name("lockfree_fifo"));
+  test_basics<robust_fifo<int>>(unique_name("robust_fifo"));
+
+  test_pop_wakeup<fifo<int>>(unique_name("fifo_wakeup"));
+  test_pop_wakeup<compact_fifo<int>>(unique_name("compact_fifo_wakeup"));
+  test_pop_wakeup<lockfree_fifo<int>>(unique_name("lockfree_fifo_wakeup"));
+
+  test_lockfree_peek_not_torn(unique_name("lockfree_fifo_torn"));
+  test_message_queue_batches(unique_name("message_queue"));
+
+  return cpen333::test::report("process_fifo");
+}
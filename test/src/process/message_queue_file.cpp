@@ -0,0 +1,90 @@
+#include <cstdint>
+#include <string>
+
+#include <cpen333/process/message_queue.h>
+
+#include "../test.h"
+
+//
+//  Checks that the file-backed message queue replays uncommitted messages when reopened, only rewinds a restarted
+//  consumer on request while the queue stays open elsewhere, and refuses a file made for another message type.
+//
+
+using queue = cpen333::process::persistent_message_queue<int>;
+
+void test_replay(const std::string& filename) {
+  {
+    queue q(filename, 8);
+    for (int i=0; i<5; ++i) {
+      q.send(i);
+    }
+    CHECK(q.receive() == 0);
+    CHECK(q.receive() == 1);
+    q.commit();
+    CHECK(q.receive() == 2);  // never committed
+    CHECK(q.uncommitted() == 1);
+  }
+
+  // no-one else has it open, so reading resumes from the last commit
+  queue q(filename, 8);
+  CHECK(q.uncommitted() == 0);
+  CHECK(q.size() == 3);
+  CHECK(q.receive() == 2);
+  CHECK(q.receive() == 3);
+  q.commit();
+  CHECK(q.size() == 1);
+  q.unlink();
+}
+
+void test_rewind(const std::string& filename) {
+  queue producer(filename, 8);
+  for (int i=0; i<4; ++i) {
+    producer.send(i);
+  }
+  {
+    queue consumer(filename, 8);
+    CHECK(consumer.receive() == 0);
+    consumer.commit();
+    CHECK(consumer.receive() == 1);  // lost with the consumer, unless rewound
+  }
+
+  // still open in the producer, so the restarted consumer resumes after what was received
+  queue consumer(filename, 8);
+  CHECK(consumer.uncommitted() == 1);
+  consumer.rewind();
+  CHECK(consumer.uncommitted() == 0);
+  CHECK(consumer.receive() == 1);
+  CHECK(consumer.receive() == 2);
+  consumer.commit();
+  consumer.unlink();
+}
+
+struct wide_message {
+  int64_t id;
+  double values[4];
+};
+
+void test_wrong_type(const std::string& filename) {
+  queue q(filename, 8);
+  q.send(42);
+
+  bool thrown = false;
+  try {
+    cpen333::process::persistent_message_queue<wide_message> other(filename, 8);
+  } catch (const cpen333::process::layout_error&) {
+    thrown = true;
+  }
+  CHECK(thrown);
+
+  // left untouched
+  CHECK(q.receive() == 42);
+  q.unlink();
+}
+
+int main() {
+  using cpen333::test::unique_name;
+  test_replay("/tmp/" + unique_name("mq_replay"));
+  test_rewind("/tmp/" + unique_name("mq_rewind"));
+  test_wrong_type("/tmp/" + unique_name("mq_type"));
+  return cpen333::test::report("process_message_queue_file");
+}
@@ -0,0 +1,93 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <cpen333/process/rendezvous.h>
+
+#include "../test.h"
+
+//
+//  Checks that each rendezvous round only ends once the whole group has arrived, that no-one runs ahead into
+//  a later round, and that split arrivals and dropping out of the group keep the rounds going.
+//
+
+static const int group = 4;
+static const int rounds = 200;
+
+void test_generations(const std::string& name) {
+  cpen333::process::rendezvous rv(name, group);
+  std::atomic<int> arrived[rounds];
+  for (auto& a : arrived) {
+    a = 0;
+  }
+  std::atomic<int> early{0};
+
+  std::vector<std::thread> threads;
+  for (int i=0; i<group; ++i) {
+    threads.emplace_back([&](){
+      for (int r=0; r<rounds; ++r) {
+        ++arrived[r];
+        rv.wait();
+        // everyone must have arrived for this round, and no-one can be two rounds ahead
+        if (arrived[r] != group || (r+2 < rounds && arrived[r+2] != 0)) {
+          ++early;
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  CHECK(early == 0);
+  rv.unlink();
+}
+
+void test_split_arrival(const std::string& name) {
+  cpen333::process::rendezvous rv(name, 2);
+
+  auto token = rv.arrive();
+  CHECK(!rv.wait_for(token, std::chrono::milliseconds(10)));  // other member not here yet
+
+  std::thread other([&](){
+    rv.wait();
+  });
+  CHECK(rv.wait_for(token, std::chrono::seconds(2)));
+  other.join();
+
+  // the round is over, so waiting on the old token returns immediately
+  rv.wait(token);
+  rv.unlink();
+}
+
+void test_drop(const std::string& name) {
+  cpen333::process::rendezvous rv(name, 3);
+  std::atomic<int> passed{0};
+
+  std::vector<std::thread> threads;
+  threads.emplace_back([&](){
+    rv.arrive_and_drop();
+  });
+  for (int i=0; i<2; ++i) {
+    threads.emplace_back([&](){
+      for (int r=0; r<10; ++r) {
+        if (!rv.wait_for(rv.arrive(), std::chrono::seconds(2))) {
+          return;
+        }
+        ++passed;
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  CHECK(passed == 20);
+  rv.unlink();
+}
+
+int main() {
+  test_generations(cpen333::test::unique_name("rendezvous"));
+  test_split_arrival(cpen333::test::unique_name("rendezvous_split"));
+  test_drop(cpen333::test::unique_name("rendezvous_drop"));
+  return cpen333::test::report("process_rendezvous");
+}
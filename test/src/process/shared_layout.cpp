@@ -0,0 +1,61 @@
+#include <cstdint>
+#include <string>
+
+#include <cpen333/process/broadcast_queue.h>
+#include <cpen333/process/condition.h>
+#include <cpen333/process/fifo.h>
+#include <cpen333/process/message_queue.h>
+#include <cpen333/process/shared_memory.h>
+
+#include "../test.h"
+
+//
+//  Checks that connecting to a control block laid out by a different build throws a layout_error instead of
+//  misreading it.  Every versioned block starts with its 32-bit initialized marker followed by the layout word.
+//
+
+// creates a resource, overwrites its layout word, and checks a second handle refuses to connect
+template<typename Resource, typename... Args>
+void check_rejects_stale(const std::string& name, const std::string& suffix, Args... args) {
+  Resource resource(name, args...);
+  {
+    cpen333::process::shared_memory memory(name + suffix, 2*sizeof(uint32_t));
+    CHECK(memory.get() != nullptr);
+    if (memory.get() != nullptr) {
+      ((uint32_t*)memory.get())[1] = CPEN333_PROCESS_LAYOUT_VERSION + 1;
+    }
+  }
+
+  bool thrown = false;
+  try {
+    Resource other(name, args...);
+  } catch (const cpen333::process::layout_error&) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  Resource::unlink(name);
+}
+
+int main() {
+  using namespace cpen333::process;
+  using cpen333::test::unique_name;
+
+  // a matching layout connects fine
+  {
+    std::string name = unique_name("layout_ok");
+    lockfree_fifo<int> fifo(name, 4);
+    lockfree_fifo<int> other(name, 4);
+    fifo.push(1);
+    CHECK(other.pop() == 1);
+    fifo.unlink();
+  }
+
+  // suffixes are private to each resource's header, so are repeated here
+  check_rejects_stale<lockfree_fifo<int>>(unique_name("layout_fflf"), "_fflf", 4);
+  check_rejects_stale<robust_fifo<int>>(unique_name("layout_ffr"), "_ffr", 4);
+  check_rejects_stale<byte_message_queue>(unique_name("layout_mqb"), "_mqb", 256);
+  check_rejects_stale<broadcast_queue<int>>(unique_name("layout_bq"), "_bq", 4);
+  check_rejects_stale<compact_condition>(unique_name("layout_cons"), "_cons");
+
+  return cpen333::test::report("process_shared_layout");
+}
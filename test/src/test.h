@@ -0,0 +1,48 @@
+/**
+ * @file
+ * @brief Minimal checks shared by the library's tests
+ */
+#ifndef CPEN333_TEST_TEST_H
+#define CPEN333_TEST_TEST_H
+
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+namespace cpen333 {
+namespace test {
+
+// number of failed checks so far
+inline int& failures() {
+  static int count = 0;
+  return count;
+}
+
+// unique resource name, so tests running at the same time do not share shared memory
+inline std::string unique_name(const std::string& name) {
+  return std::string("cpen333_test_") + name + "_" + std::to_string(getpid());
+}
+
+// prints the result and returns the exit code for main
+inline int report(const char* test) {
+  if (failures() > 0) {
+    std::cerr << test << ": " << failures() << " check(s) failed" << std::endl;
+    return 1;
+  }
+  std::cout << test << ": passed" << std::endl;
+  return 0;
+}
+
+} // test
+} // cpen333
+
+// records a failure if a condition does not hold, without stopping the test
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #cond << std::endl; \
+      ++cpen333::test::failures(); \
+    } \
+  } while (0)
+
+#endif //CPEN333_TEST_TEST_H
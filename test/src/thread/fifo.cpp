@@ -0,0 +1,213 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <cpen333/thread/fifo.h>
+#include <cpen333/thread/priority_fifo.h>
+
+#include "../test.h"
+
+//
+//  Checks the thread fifos, and the races fixed in them:  a blocked pop must still be woken when a peeker takes
+//  its wakeup, lock-free peeks must never return a half-overwritten item, and watermark callbacks must alternate.
+//
+
+// pushes one item while a popper and a peeker are both blocked, returns the number of rounds the pop was stranded
+template<typename Fifo>
+int stranded_pops(Fifo& fifo, int rounds) {
+  int stranded = 0;
+  for (int r=0; r<rounds; ++r) {
+    std::atomic<bool> popped{false};
+    std::thread popper([&](){
+      int val;
+      popped = fifo.try_pop_for(&val, std::chrono::seconds(1));
+    });
+    std::thread peeker([&](){
+      int val;
+      fifo.try_peek_for(&val, std::chrono::seconds(1));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));  // let both block
+    fifo.push(r);
+    popper.join();
+    fifo.push(-1);  // release the peeker if it is still waiting
+    peeker.join();
+    int val;
+    while (fifo.try_pop(&val)) {}
+    if (!popped) {
+      ++stranded;
+    }
+  }
+  return stranded;
+}
+
+// item spanning several cache lines, so a torn copy shows as differing words
+struct frame {
+  long words[16];
+};
+
+void test_lockfree_peek_not_torn() {
+  cpen333::thread::lockfree_fifo<frame> fifo(4);
+  const long count = 100000;
+  std::atomic<bool> done{false};
+  std::atomic<long> torn{0};
+
+  std::thread producer([&](){
+    frame f;
+    for (long i=0; i<count; ++i) {
+      for (auto& w : f.words) {
+        w = i;
+      }
+      fifo.push(f);
+    }
+  });
+  std::thread consumer([&](){
+    frame f;
+    for (long i=0; i<count; ++i) {
+      fifo.pop(&f);
+    }
+    done = true;
+  });
+  std::thread peeker([&](){
+    frame f;
+    while (!done) {
+      if (fifo.try_peek(&f)) {
+        for (auto& w : f.words) {
+          if (w != f.words[0]) {
+            ++torn;
+            break;
+          }
+        }
+      }
+    }
+  });
+  producer.join();
+  consumer.join();
+  peeker.join();
+  CHECK(torn == 0);
+}
+
+void test_spsc_order() {
+  cpen333::thread::spsc_fifo<int, 4> fifo;
+  const int count = 100000;
+  int bad = 0;
+  std::thread producer([&](){
+    for (int i=0; i<count; ++i) {
+      fifo.push(i);
+    }
+  });
+  for (int i=0; i<count; ++i) {
+    if (fifo.pop() != i) {
+      ++bad;
+    }
+  }
+  producer.join();
+  CHECK(bad == 0);
+}
+
+void test_size_when_full() {
+  cpen333::thread::fifo<int> fifo(4);
+  for (int i=0; i<4; ++i) {
+    fifo.push(i);
+  }
+  CHECK(fifo.size() == 4);
+  CHECK(!fifo.empty());
+  CHECK(fifo.pop() == 0);
+  CHECK(fifo.size() == 3);
+}
+
+void test_batches() {
+  cpen333::thread::fifo<int> fifo(8);
+  int in[6] = {0, 1, 2, 3, 4, 5};
+  fifo.push_n(in, 6);
+  int out[8];
+  CHECK(fifo.try_pop_n(out, 4) == 4);
+  CHECK(out[0] == 0 && out[3] == 3);
+  std::vector<int> rest;
+  CHECK(fifo.try_pop_all(rest) == 2);
+  CHECK(rest.size() == 2 && rest[1] == 5);
+  CHECK(fifo.empty());
+}
+
+void test_unbounded_watermarks() {
+  for (int round=0; round<50; ++round) {
+    cpen333::thread::unbounded_fifo<int> fifo;
+    std::atomic<int> above{0};
+    std::atomic<int> out_of_order{0};
+    fifo.set_high_water_mark(8, 2, [&](bool high){
+      if (above.exchange(high ? 1 : 0) != (high ? 0 : 1)) {
+        ++out_of_order;
+      }
+    });
+
+    std::vector<std::thread> threads;
+    for (int p=0; p<2; ++p) {
+      threads.emplace_back([&](){
+        for (int i=0; i<2000; ++i) {
+          fifo.push(i);
+        }
+      });
+    }
+    for (int c=0; c<2; ++c) {
+      threads.emplace_back([&](){
+        int val;
+        for (int i=0; i<2000; ++i) {
+          fifo.pop(&val);
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    CHECK(out_of_order == 0);
+    CHECK(above == 0);  // drained, so the low-water mark must have been signalled last
+  }
+}
+
+void test_priority_peek_null() {
+  cpen333::thread::priority_fifo<int> fifo(4);
+  fifo.push(1);
+  fifo.push(3);
+  fifo.peek(nullptr);
+  CHECK(fifo.try_peek(nullptr));
+  CHECK(fifo.try_peek_for(nullptr, std::chrono::milliseconds(1)));
+  CHECK(fifo.pop() == 3);
+
+  cpen333::thread::lane_priority_fifo<int, 4> lanes(4);
+  lanes.push(7, 1);
+  lanes.peek(nullptr);
+  CHECK(lanes.try_peek(nullptr));
+  CHECK(lanes.try_peek_for(nullptr, std::chrono::milliseconds(1)));
+  CHECK(lanes.pop() == 7);
+}
+
+void test_lanes_clamp_level() {
+  cpen333::thread::lane_priority_fifo<int, 4> lanes(2);
+  lanes.push(1, 1);
+  lanes.push(2, 100);  // clamped to the highest level
+  CHECK(lanes.try_push(3, 1000));
+  CHECK(!lanes.try_push(4, 3));  // highest level now full
+  CHECK(lanes.pop() == 2);
+  CHECK(lanes.pop() == 3);
+  CHECK(lanes.pop() == 1);
+}
+
+int main() {
+  {
+    cpen333::thread::fifo<int> fifo(4);
+    CHECK(stranded_pops(fifo, 50) == 0);
+  }
+  {
+    cpen333::thread::lockfree_fifo<int> fifo(4);
+    CHECK(stranded_pops(fifo, 50) == 0);
+  }
+  test_lockfree_peek_not_torn();
+  test_spsc_order();
+  test_size_when_full();
+  test_batches();
+  test_unbounded_watermarks();
+  test_priority_peek_null();
+  test_lanes_clamp_level();
+
+  return cpen333::test::report("thread_fifo");
+}
@@ -0,0 +1,51 @@
+#define CPEN333_PROFILE_LOCKS
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <cpen333/thread/profiled_mutex.h>
+
+#include "../test.h"
+
+//
+//  Checks that two locks sharing a statistics block, used from different threads, count every acquisition.
+//
+
+static const int iterations = 100000;
+
+// reads a counter back from the printed statistics
+uint64_t printed(cpen333::thread::profiled_mutex<>& mutex, const std::string& label) {
+  std::ostringstream os;
+  mutex.profile().print(os);
+  std::string text = os.str();
+  size_t pos = text.find(label);
+  if (pos == std::string::npos) {
+    return 0;
+  }
+  return std::stoull(text.substr(pos + label.size()));
+}
+
+void lock_many(cpen333::thread::profiled_mutex<>& mutex) {
+  for (int i=0; i<iterations; ++i) {
+    mutex.lock();
+    mutex.unlock();
+  }
+}
+
+int main() {
+  std::string name = cpen333::test::unique_name("profiled_mutex");
+  cpen333::thread::profiled_mutex<> a(name);
+  cpen333::thread::profiled_mutex<> b(name);  // different lock, same statistics
+  a.profile().reset();
+
+  std::thread t1(lock_many, std::ref(a));
+  std::thread t2(lock_many, std::ref(b));
+  t1.join();
+  t2.join();
+
+  CHECK(printed(a, "acquisitions:") == 2*iterations);
+
+  a.profile().unlink();
+  return cpen333::test::report("thread_profiled_mutex");
+}
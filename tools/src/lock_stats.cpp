@@ -0,0 +1,78 @@
+#include "cpen333/os.h"
+#include "cpen333/process/impl/lock_profile.h"
+#include <iostream>
+#include <string>
+#include <cstring>
+
+#ifdef POSIX
+#include <unistd.h>
+#else
+#include <io.h>
+#define isatty _isatty
+#define fileno _fileno
+#endif
+
+struct __options {
+  bool reset;
+  bool unlink;
+};
+
+void __lock_stats(const std::string& name, const __options& options) {
+  if (options.unlink) {
+    if (!cpen333::process::impl::lock_profile::unlink(name)) {
+      std::cerr << "Failed to unlink statistics of lock " << name << std::endl;
+    }
+    return;
+  }
+
+  cpen333::process::impl::lock_profile profile(name);
+  std::cout << name << std::endl;
+  profile.print(std::cout);
+  if (options.reset) {
+    profile.reset();
+  }
+}
+
+int main(int argc, char* argv[]) {
+
+  __options options = {false, false};
+  int first = 1;
+  while (first < argc && argv[first][0] == '-') {
+    if (std::strcmp(argv[first], "-r") == 0) {
+      options.reset = true;
+    } else if (std::strcmp(argv[first], "-u") == 0) {
+      options.unlink = true;
+    } else {
+      std::cerr << "Unknown option " << argv[first] << std::endl;
+      return 1;
+    }
+    ++first;
+  }
+
+  // command-line arguments
+  if (first < argc) {
+    for (int i=first; i<argc; ++i) {
+      __lock_stats(argv[i], options);
+    }
+  }
+  // read from pipe
+  else if (!isatty(fileno(stdin))) {
+    std::string name;
+    while (std::cin >> name) {
+      __lock_stats(name, options);
+    }
+  }
+  // print usage
+  else {
+    std::cout << "Usage:" << std::endl;
+    std::cout << argv[0] << " [-r | -u] <list of lock names...>" << std::endl;
+    std::cout << "\tPrints the contention statistics of locks, by the name they were created with." << std::endl;
+    std::cout << "\tStatistics are only recorded by programs compiled with CPEN333_PROFILE_LOCKS defined." << std::endl;
+    std::cout << "\t\t-r\treset the statistics after printing them" << std::endl;
+    std::cout << "\t\t-u\tunlink the statistics instead of printing them" << std::endl;
+    std::cout << "\tNames can also be piped in directly, i.e." << std::endl;
+    std::cout << "\t\tcat lock_names.txt | " << argv[0] << std::endl;
+  }
+
+  return 0;
+}